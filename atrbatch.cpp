@@ -0,0 +1,320 @@
+#include "atrbatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ATR_BATCH_AVX2 1
+#define ATR_BATCH_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ATR_BATCH_SIMD 1
+#endif
+
+namespace atr {
+
+namespace {
+
+enum class Shape : uint8_t {
+    Irregular,
+    PcscPart3,
+    Contactless
+};
+
+// Шаблоны первых 16 байтов записи: (байт & маска) == значение
+alignas(16) constexpr uint8_t kPcscValue[16] = {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0,
+                                                0x00, 0x00, 0x03, 0x06, 0x00, 0x00, 0x00, 0x00};
+alignas(16) constexpr uint8_t kPcscMask[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                               0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00};
+alignas(16) constexpr uint8_t kShortValue[16] = {0x3B, 0x80, 0x80, 0x01};
+alignas(16) constexpr uint8_t kShortMask[16] = {0xFF, 0xF0, 0xFF, 0xFF};
+constexpr std::size_t kPatternBytes = 16;
+constexpr uint8_t kPcscLength = 20;
+
+// Индексы байтов для маски длины в XOR-свёртке; у TS индекс 0x7F, чтобы он
+// никогда не попадал под маску (длина не больше 33)
+alignas(32) constexpr uint8_t kXorIndex[32] = {0x7F, 1,  2,  3,  4,  5,  6,  7,  8,  9,  10,
+                                               11,   12, 13, 14, 15, 16, 17, 18, 19, 20, 21,
+                                               22,   23, 24, 25, 26, 27, 28, 29, 30, 31};
+constexpr std::size_t kXorBytes = 32;
+
+uint8_t xorScalar(const uint8_t *p, std::size_t length)
+{
+    uint8_t x = 0;
+    for (std::size_t i = 1; i < length; ++i) x ^= p[i];
+    return x;
+}
+
+#if defined(ATR_BATCH_SIMD)
+// Сворачивает 16 байт в один XOR
+inline uint8_t foldXor(__m128i x)
+{
+    x = _mm_xor_si128(x, _mm_srli_si128(x, 8));
+    x = _mm_xor_si128(x, _mm_srli_si128(x, 4));
+    x = _mm_xor_si128(x, _mm_srli_si128(x, 2));
+    x = _mm_xor_si128(x, _mm_srli_si128(x, 1));
+    return static_cast<uint8_t>(_mm_cvtsi128_si32(x));
+}
+
+// XOR p[1 .. length) для length <= 33; читает p[0 .. 32), поэтому нужен
+// stride >= 32. Байты за концом записи обнуляются маской, 33-й — отдельно.
+inline uint8_t xorVector(const uint8_t *p, uint8_t length)
+{
+#if defined(ATR_BATCH_AVX2)
+    const __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i *>(kXorIndex));
+    const __m256i inside = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(length)), index);
+    const __m256i bytes = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), inside);
+    const __m128i x = _mm_xor_si128(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+#else
+    const __m128i len = _mm_set1_epi8(static_cast<char>(length));
+    const __m128i lo = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)),
+                                     _mm_cmpgt_epi8(len, _mm_load_si128(reinterpret_cast<const __m128i *>(kXorIndex))));
+    const __m128i hi = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16)),
+                                     _mm_cmpgt_epi8(len, _mm_load_si128(reinterpret_cast<const __m128i *>(kXorIndex + 16))));
+    const __m128i x = _mm_xor_si128(lo, hi);
+#endif
+    const uint8_t tail = length > kXorBytes ? p[kXorBytes] : 0;
+    return foldXor(x) ^ tail;
+}
+#endif
+
+// XOR записи: SIMD-свёртка, если слот позволяет прочитать 32 байта, а
+// запись не длиннее ATR
+inline uint8_t xorRecord(const uint8_t *p, uint8_t length, bool wide)
+{
+#if defined(ATR_BATCH_SIMD)
+    if (wide && length <= kMaxAtrLength) return xorVector(p, length);
+#else
+    (void)wide;
+#endif
+    return xorScalar(p, length);
+}
+
+bool matchScalar(const uint8_t *p, const uint8_t *value, const uint8_t *mask)
+{
+    for (std::size_t i = 0; i < kPatternBytes; ++i) {
+        if ((p[i] & mask[i]) != value[i]) return false;
+    }
+    return true;
+}
+
+// Шаблон проверен по первым байтам слота; длина отсекает совпадения,
+// захватившие байты за концом записи
+Shape shapeOf(bool pcsc, bool shortForm, const uint8_t *p, uint8_t length)
+{
+    if (pcsc && length == kPcscLength) return Shape::PcscPart3;
+    if (shortForm && length == 5 + (p[1] & 0x0F)) return Shape::Contactless;
+    return Shape::Irregular;
+}
+
+// decode() для 3B 8n 80 01 ...: TD1 = 80 (T=0), TD2 = 01 (T=1), группа 3 пуста
+void decodeContactless(const uint8_t *p, uint8_t length, bool wide, Atr &a)
+{
+    a.raw = p;
+    a.length = length;
+    a.ts = p[0];
+    a.t0 = p[1];
+    a.interfaceLength = 2;
+    a.historicalOffset = 4;
+    a.historicalLength = p[1] & 0x0F;
+    a.protocolMask = 0x0003;
+    a.groupCount = 3;
+    a.groups[0] = InterfaceGroup{TD, 0, 0, 0, p[2]};
+    a.groups[1] = InterfaceGroup{TD, 0, 0, 0, p[3]};
+    a.groups[2] = InterfaceGroup{0, 0, 0, 0, 0};
+    a.clockRateConversion = 372;
+    a.bitRateAdjustment = 1;
+    a.baudRate = 9600;
+    a.programmingVoltage = 0;
+    a.programmingCurrent = 0;
+    a.guardTime = 0;
+    a.waitingTime = 10;
+    a.ifsc = 32;
+    a.bwi = 4;
+    a.cwi = 13;
+    a.edcCrc = false;
+
+    a.hasTck = true;
+    a.tck = p[length - 1];
+    a.tckValid = xorRecord(p, length, wide) == 0;
+}
+
+// Результаты identify() для PC/SC Part 3 внутри пакета. При нулевых RFU
+// байтах весь ATR задаётся (SS, NN NN, TCK), так что результат можно
+// переиспользовать без изменения смысла.
+class PcscMemo
+{
+public:
+    PcscMemo() { std::fill(std::begin(m_used), std::end(m_used), false); }
+
+    static bool keyOf(const uint8_t *p, uint32_t &key)
+    {
+        if (p[15] | p[16] | p[17] | p[18]) return false;
+        key = (uint32_t(p[12]) << 24) | (uint32_t(p[13]) << 16) | (uint32_t(p[14]) << 8) | p[19];
+        return true;
+    }
+
+    const Identification *find(uint32_t key) const
+    {
+        for (std::size_t n = 0, i = slot(key); n < kSlots; ++n, i = (i + 1) % kSlots) {
+            if (!m_used[i]) return nullptr;
+            if (m_keys[i] == key) return &m_ids[i];
+        }
+        return nullptr;
+    }
+
+    void insert(uint32_t key, const Identification &id)
+    {
+        if (m_size == kSlots / 2) return;   // держим таблицу полупустой
+        std::size_t i = slot(key);
+        while (m_used[i]) i = (i + 1) % kSlots;
+        m_used[i] = true;
+        m_keys[i] = key;
+        m_ids[i] = id;
+        ++m_size;
+    }
+
+private:
+    static constexpr std::size_t kSlots = 256;
+    static std::size_t slot(uint32_t key) { return (key * 2654435761u) >> 24; }
+
+    bool m_used[kSlots];
+    uint32_t m_keys[kSlots];
+    Identification m_ids[kSlots];
+    std::size_t m_size = 0;
+};
+
+const Identification kNoIdentification{CardType::Unknown, nullptr, nullptr};
+
+} // namespace
+
+void classifyBatchScalar(const uint8_t *atrs, std::size_t stride, const uint8_t *lengths,
+                         std::size_t count, const CardDatabase &db, const RuleSet &rules,
+                         BatchRecord *out)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        Atr a;
+        const std::size_t length = std::min<std::size_t>(lengths[i], stride);
+        out[i].status = decode({atrs + i * stride, length}, a);
+        out[i].id = out[i].status == Status::Ok ? identify(a, db, rules) : kNoIdentification;
+    }
+}
+
+BatchStats classifyBatch(const uint8_t *atrs, std::size_t stride, const uint8_t *lengths,
+                         std::size_t count, const CardDatabase &db, const RuleSet &rules,
+                         BatchRecord *out)
+{
+    BatchStats stats{0, 0, 0};
+    PcscMemo memo;
+    const bool wide = stride >= kXorBytes;
+
+    auto process = [&](std::size_t i, bool pcsc, bool shortForm) {
+        const uint8_t *p = atrs + i * stride;
+        const uint8_t length = static_cast<uint8_t>(std::min<std::size_t>(lengths[i], stride));
+        Atr a;
+        switch (shapeOf(pcsc, shortForm, p, length)) {
+            case Shape::PcscPart3: {
+                ++stats.pcscPart3;
+                out[i].status = Status::Ok;
+                uint32_t key = 0;
+                const bool cacheable = PcscMemo::keyOf(p, key);
+                if (cacheable) {
+                    if (const Identification *known = memo.find(key)) {
+                        out[i].id = *known;
+                        return;
+                    }
+                }
+                decodeContactless(p, length, wide, a);
+                out[i].id = identify(a, db, rules);
+                if (cacheable) memo.insert(key, out[i].id);
+                return;
+            }
+            case Shape::Contactless:
+                ++stats.contactless;
+                decodeContactless(p, length, wide, a);
+                out[i].status = Status::Ok;
+                out[i].id = identify(a, db, rules);
+                return;
+            case Shape::Irregular:
+                ++stats.irregular;
+                out[i].status = decode({p, length}, a);
+                out[i].id = out[i].status == Status::Ok ? identify(a, db, rules) : kNoIdentification;
+                return;
+        }
+    };
+
+    std::size_t i = 0;
+    // SIMD-загрузка 16 байт не выходит за слот только при stride >= 16
+    const bool vector = stride >= kPatternBytes;
+
+#if defined(ATR_BATCH_AVX2)
+    if (vector) {
+        const __m256i pcscValue = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(kPcscValue)));
+        const __m256i pcscMask = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(kPcscMask)));
+        const __m256i shortValue = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(kShortValue)));
+        const __m256i shortMask = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(kShortMask)));
+        // Две записи на регистр: по одной в каждой 128-битной половине
+        for (; i + 2 <= count; i += 2) {
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(atrs + i * stride));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(atrs + (i + 1) * stride));
+            const __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+            const uint32_t pcsc = static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(x, pcscMask), pcscValue)));
+            const uint32_t shortForm = static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(x, shortMask), shortValue)));
+            process(i, (pcsc & 0xFFFF) == 0xFFFF, (shortForm & 0xFFFF) == 0xFFFF);
+            process(i + 1, (pcsc >> 16) == 0xFFFF, (shortForm >> 16) == 0xFFFF);
+        }
+    }
+#endif
+
+#if defined(ATR_BATCH_SIMD)
+    if (vector) {
+        const __m128i pcscValue = _mm_load_si128(reinterpret_cast<const __m128i *>(kPcscValue));
+        const __m128i pcscMask = _mm_load_si128(reinterpret_cast<const __m128i *>(kPcscMask));
+        const __m128i shortValue = _mm_load_si128(reinterpret_cast<const __m128i *>(kShortValue));
+        const __m128i shortMask = _mm_load_si128(reinterpret_cast<const __m128i *>(kShortMask));
+        for (; i < count; ++i) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(atrs + i * stride));
+            const int pcsc = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(x, pcscMask), pcscValue));
+            const int shortForm = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(x, shortMask), shortValue));
+            process(i, pcsc == 0xFFFF, shortForm == 0xFFFF);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const uint8_t *p = atrs + i * stride;
+        process(i, vector && matchScalar(p, kPcscValue, kPcscMask),
+                vector && matchScalar(p, kShortValue, kShortMask));
+    }
+    return stats;
+}
+
+std::size_t checksumBatch(const uint8_t *atrs, std::size_t stride, const uint8_t *lengths,
+                          std::size_t count, uint8_t *out)
+{
+    const bool wide = stride >= kXorBytes;
+    std::size_t invalid = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint8_t length = static_cast<uint8_t>(std::min<std::size_t>(lengths[i], stride));
+        const uint8_t x = xorRecord(atrs + i * stride, length, wide);
+        if (out) out[i] = x;
+        invalid += x != 0;
+    }
+    return invalid;
+}
+
+const char *batchKernel()
+{
+#if defined(ATR_BATCH_AVX2)
+    return "avx2";
+#elif defined(ATR_BATCH_SIMD)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace atr
@@ -0,0 +1,63 @@
+#ifndef ATRBATCH_H
+#define ATRBATCH_H
+
+// Пакетная классификация ATR без зависимостей от Qt.
+// Записи лежат в одном буфере с фиксированным шагом (stride), длины — в
+// отдельном массиве. SIMD-ядро (AVX2/SSE2, выбирается при сборке) одним
+// сравнением по маске распознаёт ATR бесконтактных карт фиксированной
+// структуры, которые ридеры формируют по PC/SC Part 3:
+//   3B 8F 80 01 80 4F 0C A0 00 00 03 06 SS NN NN 00 00 00 00 TCK
+//   3B 8n 80 01 <n исторических байтов> TCK
+// Такие записи декодируются без прохода по цепочке interface bytes, а
+// результат определения типа для PC/SC Part 3 переиспользуется для
+// одинаковых (SS, NN NN, TCK) внутри пакета. Остальные записи идут через
+// atr::decode() и atr::identify(). Результат совпадает со скалярной
+// версией classifyBatchScalar() запись в запись.
+// checksumBatch() проверяет TCK пакета записей XOR-сверткой по маске длины.
+
+#include "atrcore.h"
+#include "atrdatabase.h"
+#include "atrrules.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace atr {
+
+struct BatchRecord {
+    Status status;
+    Identification id;           // заполнено, если status == Status::Ok
+};
+
+// Сколько записей прошло каждым путём
+struct BatchStats {
+    std::size_t pcscPart3;       // полный шаблон PC/SC Part 3
+    std::size_t contactless;     // короткая форма 3B 8n 80 01
+    std::size_t irregular;       // обычный decode()
+};
+
+// count записей: i-я — atrs[i * stride .. i * stride + lengths[i]).
+// out — массив из count элементов.
+BatchStats classifyBatch(const uint8_t *atrs, std::size_t stride, const uint8_t *lengths,
+                         std::size_t count, const CardDatabase &db, const RuleSet &rules,
+                         BatchRecord *out);
+
+// Эталон: decode() + identify() для каждой записи
+void classifyBatchScalar(const uint8_t *atrs, std::size_t stride, const uint8_t *lengths,
+                         std::size_t count, const CardDatabase &db, const RuleSet &rules,
+                         BatchRecord *out);
+
+// XOR байтов T0..последний для count записей (TS не входит, длина
+// ограничена stride): out[i] = p[1] ^ ... ^ p[lengths[i] - 1]. У ATR с TCK
+// контрольная сумма верна, если out[i] == 0. При stride >= 32 записи
+// сворачиваются SIMD-ядром без побайтового цикла. Возвращает число записей
+// с ненулевым XOR. out может быть nullptr, если нужен только счётчик.
+std::size_t checksumBatch(const uint8_t *atrs, std::size_t stride, const uint8_t *lengths,
+                          std::size_t count, uint8_t *out);
+
+// Реализация ядра в этой сборке: "avx2", "sse2" или "scalar"
+const char *batchKernel();
+
+} // namespace atr
+
+#endif // ATRBATCH_H
@@ -0,0 +1,430 @@
+#ifndef ATRCORE_H
+#define ATRCORE_H
+
+// Ядро декодирования ATR (ISO/IEC 7816-3) без зависимостей от Qt.
+// Все функции работают на стеке с результатом фиксированного размера и не
+// копируют входные байты (результат ссылается на буфер вызывающего),
+// поэтому их можно вызывать из любых (в том числе не-Qt) потоков без
+// выделения памяти в куче. ATRParser является тонкой Qt-обёрткой над ним.
+// Определение типа карты — в atrdatabase.h и atrrules.h.
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "atrtables.h"
+
+// Типы карт (uint8_t — хранится в компактной ATRData)
+enum class CardType : uint8_t {
+    Unknown,
+    BankCard_EMV,
+    Mifare_Classic,
+    Mifare_DESFire,
+    Mifare_Ultralight,
+    Mifare_Plus,
+    ISO14443A,
+    ISO14443B
+};
+
+namespace atr {
+
+// Число значений CardType (для гистограмм по типам)
+constexpr std::size_t kCardTypeCount = static_cast<std::size_t>(CardType::ISO14443B) + 1;
+
+// Идентификатор типа карты (имя перечисления) для файлов правил и
+// машиночитаемого вывода
+inline const char *cardTypeId(CardType type)
+{
+    switch (type) {
+        case CardType::BankCard_EMV: return "BankCard_EMV";
+        case CardType::Mifare_Classic: return "Mifare_Classic";
+        case CardType::Mifare_DESFire: return "Mifare_DESFire";
+        case CardType::Mifare_Ultralight: return "Mifare_Ultralight";
+        case CardType::Mifare_Plus: return "Mifare_Plus";
+        case CardType::ISO14443A: return "ISO14443A";
+        case CardType::ISO14443B: return "ISO14443B";
+        default: return "Unknown";
+    }
+}
+
+// ISO 7816-3: TS + не более 32 байт
+constexpr std::size_t kMaxAtrLength = 33;
+// Групп interface bytes, для которых сохраняются детали (TA1..TD8).
+// Реальные ATR используют не более 3-4 групп; более длинные цепочки
+// проходятся до конца, но детали лишних групп не сохраняются.
+constexpr std::size_t kMaxInterfaceGroups = 8;
+
+// Биты присутствия байтов в группе (Y-полубайт T0/TDi)
+enum InterfaceBit : uint8_t {
+    TA = 0x10,
+    TB = 0x20,
+    TC = 0x40,
+    TD = 0x80
+};
+
+// Результат декодирования
+enum class Status : uint8_t {
+    Ok,
+    TooShort,            // меньше двух байт (TS + T0)
+    TooLong,             // больше kMaxAtrLength
+    InvalidTS,           // TS не 0x3B и не 0x3F
+    TruncatedInterface,  // цепочка TA/TB/TC/TD обрывается
+    InvalidLength,       // ATS: TL равен нулю или больше длины буфера
+    StrictViolation      // строгий режим: есть ошибки atr::validate() (atrvalidate.h)
+};
+
+// Идентификатор статуса для машиночитаемого вывода
+inline const char *statusId(Status status)
+{
+    switch (status) {
+        case Status::Ok: return "ok";
+        case Status::TooShort: return "too_short";
+        case Status::TooLong: return "too_long";
+        case Status::InvalidTS: return "invalid_ts";
+        case Status::TruncatedInterface: return "truncated_interface";
+        case Status::InvalidLength: return "invalid_length";
+        case Status::StrictViolation: return "strict_violation";
+    }
+    return "unknown";
+}
+
+// Одна группа interface bytes TAi/TBi/TCi/TDi
+struct InterfaceGroup {
+    uint8_t present;            // маска InterfaceBit
+    uint8_t ta;
+    uint8_t tb;
+    uint8_t tc;
+    uint8_t td;
+
+    bool has(InterfaceBit bit) const { return (present & bit) != 0; }
+};
+
+// Распарсенный ATR. POD фиксированного размера: все поля заполняет decode().
+// Байты не копируются: raw указывает на буфер, переданный в decode(), и
+// действителен, пока жив этот буфер.
+struct Atr {
+    const uint8_t *raw;
+    uint8_t length;
+
+    uint8_t ts;                 // Initial character
+    uint8_t t0;                 // Format character
+
+    // Interface bytes: raw[2 .. 2 + interfaceLength)
+    uint8_t interfaceLength;
+    // Historical bytes: raw[historicalOffset .. historicalOffset + historicalLength)
+    uint8_t historicalOffset;
+    uint8_t historicalLength;
+
+    uint8_t tck;                // Check character (если есть)
+    bool hasTck;                // TCK требуется (протокол не T=0)
+    bool tckValid;              // XOR T0..TCK == 0
+
+    // Протоколы из TD: бит N — T=N
+    uint16_t protocolMask;
+
+    // Группы interface bytes (не более kMaxInterfaceGroups)
+    uint8_t groupCount;
+    InterfaceGroup groups[kMaxInterfaceGroups];
+
+    // TA1: Fi/Di и скорость при f = 3.75 МГц (по умолчанию 372/1/9600)
+    uint16_t clockRateConversion;
+    uint8_t bitRateAdjustment;
+    uint32_t baudRate;
+    // TB1: VPP/IPP
+    uint8_t programmingVoltage;
+    uint8_t programmingCurrent;
+    // TC1: extra guard time N; TC2: waiting time integer WI (T=0)
+    uint8_t guardTime;
+    uint8_t waitingTime;
+    // T=1: первая группа после TDi (i >= 2) с T=1 — IFSC, BWI/CWI, EDC.
+    // Без этих байтов — значения по умолчанию 32 / 4 / 13 / LRC.
+    uint8_t ifsc;
+    uint8_t bwi;
+    uint8_t cwi;
+    bool edcCrc;
+
+    bool supportsProtocol(uint8_t protocol) const
+    {
+        return protocol < 16 && (protocolMask & (1u << protocol)) != 0;
+    }
+
+    const uint8_t *interfaceBytes() const { return raw + 2; }
+    const uint8_t *historicalBytes() const { return raw + historicalOffset; }
+
+    std::span<const uint8_t> bytes() const { return {raw, length}; }
+    std::span<const uint8_t> historical() const { return {raw + historicalOffset, historicalLength}; }
+};
+
+// Распарсенный ATS (ISO/IEC 14443-4, 5.2). Байты не копируются: смещения
+// относятся к буферу, переданному в decodeAts().
+struct Ats {
+    uint8_t length;             // TL
+    uint8_t t0;                 // Format byte (0, если TL == 1)
+    uint8_t present;            // маска TA/TB/TC из T0 (b8 — RFU)
+
+    // T0 b4-b1: FSCI -> FSC в байтах (-1 — RFU). Без T0 — FSCI = 2 (32 байта)
+    bool fscPresent;
+    int16_t fsc;
+    // TA: делители DS (PICC -> PCD) и DR (PCD -> PICC); 0 — только 106 кбит/с
+    uint8_t bitRates;
+    // TB: FWI/SFGI (-1 — байт отсутствует)
+    int8_t fwi;
+    int8_t sfgi;
+    // TC: поддержка CID/NAD
+    bool supportsCID;
+    bool supportsNAD;
+
+    // Исторические байты: in[historicalOffset .. length), всё после TA/TB/TC
+    uint8_t historicalOffset;
+    uint8_t historicalLength;
+
+    bool has(InterfaceBit bit) const { return (present & bit) != 0; }
+};
+
+// Результат определения типа карты. Строки UTF-8 живут, пока живут база
+// и правила; идентификаторы — в таблице atrstrings.h (0 — не заполнен).
+struct Identification {
+    CardType type;
+    const char *name;
+    const char *manufacturer;
+    uint16_t nameId = 0;
+    uint16_t manufacturerId = 0;
+};
+
+namespace detail {
+
+// Число interface bytes группы по Y-полубайту (popcount без POPCNT)
+inline constexpr uint8_t kGroupBytes[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+// Интерпретация байтов групп 1 и 2 и T=1-специфичной группы: загрузка
+// из таблиц atrtables.h
+inline void applyInterfaceByte(Atr &out, uint8_t group, bool t1Group, InterfaceBit bit, uint8_t value)
+{
+    if (group == 0) {
+        switch (bit) {
+            case TA: {
+                const tables::Ta1 &ta = tables::kTa1[value];
+                out.clockRateConversion = ta.fi;
+                out.bitRateAdjustment = ta.di;
+                out.baudRate = ta.baud[tables::kDefaultClock];
+                break;
+            }
+            case TB:
+                out.programmingVoltage = tables::kTb1[value].programmingVoltage;
+                out.programmingCurrent = tables::kTb1[value].programmingCurrent;
+                break;
+            case TC:
+                out.guardTime = tables::kTc1[value].n;
+                break;
+            default:
+                break;
+        }
+    } else if (group == 1 && bit == TC) {
+        out.waitingTime = value;
+    } else if (t1Group) {
+        switch (bit) {
+            case TA:
+                out.ifsc = tables::kT1Ta[value].ifsc;
+                break;
+            case TB:
+                out.bwi = tables::kT1Tb[value].bwi;
+                out.cwi = tables::kT1Tb[value].cwi;
+                break;
+            case TC:
+                out.edcCrc = tables::kT1Tc[value].crc;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace detail
+
+// Декодирование ATR в out за один проход: сырые interface bytes, детали
+// групп TA/TB/TC/TD и набор протоколов. Не выделяет память и не копирует
+// вход: out.raw ссылается на in.
+inline Status decode(std::span<const uint8_t> in, Atr &out)
+{
+    const std::size_t n = in.size();
+    out.raw = in.data();
+    out.length = 0;
+    if (n < 2) return Status::TooShort;
+    if (n > kMaxAtrLength) return Status::TooLong;
+
+    out.length = static_cast<uint8_t>(n);
+    out.ts = in[0];
+    out.t0 = in[1];
+    out.interfaceLength = 0;
+    out.historicalOffset = 2;
+    out.historicalLength = 0;
+    out.tck = 0;
+    out.hasTck = false;
+    out.tckValid = true;
+    out.protocolMask = 0;
+    out.groupCount = 0;
+    out.clockRateConversion = 372;
+    out.bitRateAdjustment = 1;
+    out.baudRate = 9600;
+    out.programmingVoltage = 0;
+    out.programmingCurrent = 0;
+    out.guardTime = 0;
+    out.waitingTime = 10;
+    out.ifsc = 32;
+    out.bwi = 4;
+    out.cwi = 13;
+    out.edcCrc = false;
+
+    if (out.ts != 0x3B && out.ts != 0x3F) return Status::InvalidTS;
+
+    // Цепочка interface bytes: Y-полубайт T0/TDi задаёт наличие TA/TB/TC/TD.
+    // Границы проверяются один раз на группу: по Y известно число её байтов,
+    // и если они не помещаются во вход, цепочка оборвана. Внутри группы
+    // байты читаются из p без проверок.
+    const uint8_t *p = in.data();
+    std::size_t idx = 2;
+    uint8_t y = out.t0;
+    uint8_t group = 0;
+    // Протокол из TD, открывшего текущую группу; T=1-параметры берутся
+    // только из первой такой группы начиная с третьей
+    uint8_t groupProtocol = 0xFF;
+    bool t1Seen = false;
+    // XOR для TCK накапливается по ходу разбора: T0 и interface bytes
+    // второй раз не читаются
+    uint8_t x = out.t0;
+    for (;;) {
+        if (idx + detail::kGroupBytes[y >> 4] > n) return Status::TruncatedInterface;
+        const bool t1Group = group >= 2 && groupProtocol == 1 && !t1Seen;
+        if (t1Group) t1Seen = true;
+        InterfaceGroup *g = group < kMaxInterfaceGroups ? &out.groups[group] : nullptr;
+        if (g) {
+            *g = InterfaceGroup{static_cast<uint8_t>(y & 0xF0), 0, 0, 0, 0};
+            out.groupCount = group + 1;
+        }
+        for (const InterfaceBit bit : {TA, TB, TC}) {
+            if (!(y & bit)) continue;
+            const uint8_t value = p[idx++];
+            x ^= value;
+            if (g) (bit == TA ? g->ta : bit == TB ? g->tb : g->tc) = value;
+            detail::applyInterfaceByte(out, group, t1Group, bit, value);
+        }
+        if (!(y & TD)) break;              // Нет больше TD байтов
+        y = p[idx++];
+        x ^= y;
+        if (g) g->td = y;
+        out.protocolMask |= static_cast<uint16_t>(1u << (y & 0x0F));
+        groupProtocol = y & 0x0F;
+        ++group;
+    }
+
+    out.interfaceLength = static_cast<uint8_t>(idx - 2);
+    out.historicalOffset = static_cast<uint8_t>(idx);
+
+    // Исторические байты: если ATR короче заявленного — не извлекаем
+    const std::size_t historicalCount = out.t0 & 0x0F;
+    if (idx + historicalCount <= n) {
+        out.historicalLength = static_cast<uint8_t>(historicalCount);
+    }
+
+    // TCK присутствует, если заявлен любой протокол кроме T=0
+    const std::size_t tckIdx = idx + historicalCount;
+    if (out.protocolMask & ~uint16_t(1)) {
+        out.hasTck = true;
+        if (tckIdx < n) {
+            out.tck = p[tckIdx];
+            for (std::size_t i = idx; i <= tckIdx; ++i) x ^= p[i];
+            out.tckValid = (x == 0);
+        } else {
+            out.tckValid = false;
+        }
+    }
+
+    return Status::Ok;
+}
+
+namespace detail {
+
+// ISO/IEC 14443-4: FSCI -> FSC (байт); 9..F — RFU
+inline constexpr int16_t kAtsFscTable[16] = {16, 24, 32, 40, 48, 64, 96, 128, 256, -1, -1, -1, -1, -1, -1, -1};
+
+} // namespace detail
+
+// Декодирование ATS за один проход без выделения памяти.
+// Status::TooShort — пустой буфер, Status::InvalidLength — некорректный TL.
+inline Status decodeAts(std::span<const uint8_t> in, Ats &out)
+{
+    out = Ats{0, 0, 0, false, detail::kAtsFscTable[2], 0, -1, -1, false, false, 0, 0};
+    if (in.empty()) return Status::TooShort;
+
+    // TL — первый байт, общая длина ATS
+    const std::size_t tl = in[0];
+    if (tl < 1 || tl > in.size()) return Status::InvalidLength;
+    out.length = static_cast<uint8_t>(tl);
+    out.historicalOffset = 1;
+    if (tl < 2) return Status::Ok;   // только TL — крайне редко, но считаем валидным
+
+    // T0 (форматный байт ATS): b7-b5 — наличие TC/TB/TA, b4-b1 — FSCI
+    const uint8_t t0 = in[1];
+    out.t0 = t0;
+    out.present = t0 & (TA | TB | TC);
+    out.fscPresent = true;
+    out.fsc = detail::kAtsFscTable[t0 & 0x0F];
+
+    std::size_t idx = 2;
+    // TA — поддерживаемые скорости
+    if ((t0 & TA) && idx < tl) {
+        out.bitRates = in[idx++];
+    }
+    // TB — FWI (высокие 4 бита), SFGI (низкие 4 бита)
+    if ((t0 & TB) && idx < tl) {
+        const tables::AtsTb &tb = tables::kAtsTb[in[idx++]];
+        out.fwi = tb.fwi;
+        out.sfgi = tb.sfgi;
+    }
+    // TC — поддержка NAD/CID
+    if ((t0 & TC) && idx < tl) {
+        const tables::AtsTc &tc = tables::kAtsTc[in[idx++]];
+        out.supportsCID = tc.supportsCID;
+        out.supportsNAD = tc.supportsNAD;
+    }
+
+    // Исторические байты занимают остаток до TL
+    out.historicalOffset = static_cast<uint8_t>(idx);
+    out.historicalLength = static_cast<uint8_t>(tl - idx);
+    return Status::Ok;
+}
+
+namespace detail {
+
+// Производители, определяемые по category indicator исторических байтов
+inline constexpr const char *kManufacturerNames[] = {
+    "Не определен",
+    "Неизвестный производитель",
+    "Philips/NXP",
+    "Generic smartcard",
+};
+
+// Индекс в kManufacturerNames по category indicator
+inline uint8_t detectManufacturerIndex(const Atr &a)
+{
+    if (a.historicalLength >= 2) {
+        switch (a.historicalBytes()[0]) {
+            case 0x00: return 1;
+            case 0x10: return 2;
+            case 0x80: return 3;
+            default: break;
+        }
+    }
+    return 0;
+}
+
+inline const char *detectManufacturer(const Atr &a)
+{
+    return kManufacturerNames[detectManufacturerIndex(a)];
+}
+
+} // namespace detail
+
+} // namespace atr
+
+#endif // ATRCORE_H
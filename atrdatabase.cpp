@@ -0,0 +1,200 @@
+#include "atrdatabase.h"
+#include "atrstrings.h"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <istream>
+
+namespace atr {
+
+namespace {
+
+int hexNibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+std::string_view trimmed(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+} // namespace
+
+bool AtrPattern::parse(std::string_view text, AtrPattern &out)
+{
+    out.length = 0;
+    std::size_t i = 0;
+    while (i < text.size()) {
+        if (text[i] == ' ' || text[i] == '\t' || text[i] == '\r') {
+            ++i;
+            continue;
+        }
+        if (i + 1 >= text.size() || out.length >= kMaxAtrLength) return false;
+
+        uint8_t value = 0;
+        uint8_t mask = 0;
+        for (int half = 0; half < 2; ++half) {
+            const char c = text[i + half];
+            const int shift = half ? 0 : 4;
+            if (c == '.') continue;
+            const int nibble = hexNibble(c);
+            if (nibble < 0) return false;
+            value |= static_cast<uint8_t>(nibble << shift);
+            mask |= static_cast<uint8_t>(0x0F << shift);
+        }
+        out.value[out.length] = value;
+        out.mask[out.length] = mask;
+        ++out.length;
+        i += 2;
+    }
+    return out.length > 0;
+}
+
+CardDatabase::CardDatabase()
+    : m_nodes(1)
+{
+}
+
+const CardDatabase &CardDatabase::builtin()
+{
+    static const CardDatabase db = [] {
+        CardDatabase d;
+        d.add("3B 8F 80 01 80 4F 0C A0 00 00 03 06 03 00 01 00 00 00 00 6A",
+              CardType::Mifare_Classic, "Mifare Classic 1K");
+        d.add("3B 8F 80 01 80 4F 0C A0 00 00 03 06 03 00 02 00 00 00 00 69",
+              CardType::Mifare_Classic, "Mifare Classic 4K");
+        d.add("3B 81 80 01 80 80",
+              CardType::Mifare_DESFire, "Mifare DESFire EV1");
+        d.add("3B 8F 80 01 80 4F 0C A0 00 00 03 06 03 00 03 00 00 00 00 68",
+              CardType::Mifare_Ultralight, "Mifare Ultralight");
+        return d;
+    }();
+    return db;
+}
+
+void CardDatabase::add(const AtrPattern &pattern, CardType type, std::string name)
+{
+    uint32_t node = 0;
+    for (uint8_t i = 0; i < pattern.length; ++i) {
+        const uint8_t mask = pattern.mask[i];
+        const uint8_t value = pattern.value[i] & mask;
+        const uint32_t next = static_cast<uint32_t>(m_nodes.size());
+
+        if (mask == 0xFF) {
+            std::vector<Edge> &edges = m_nodes[node].exact;
+            auto it = std::lower_bound(edges.begin(), edges.end(), value,
+                                       [](const Edge &e, uint8_t v) { return e.value < v; });
+            if (it != edges.end() && it->value == value) {
+                node = it->child;
+                continue;
+            }
+            edges.insert(it, Edge{value, mask, next});
+        } else {
+            std::vector<Edge> &edges = m_nodes[node].masked;
+            auto it = std::find_if(edges.begin(), edges.end(),
+                                   [&](const Edge &e) { return e.value == value && e.mask == mask; });
+            if (it != edges.end()) {
+                node = it->child;
+                continue;
+            }
+            // Более конкретные маски проверяются раньше
+            it = std::find_if(edges.begin(), edges.end(),
+                              [&](const Edge &e) { return std::popcount(e.mask) < std::popcount(mask); });
+            edges.insert(it, Edge{value, mask, next});
+        }
+        m_nodes.emplace_back();
+        node = next;
+    }
+
+    if (m_nodes[node].entry < 0) {
+        m_nodes[node].entry = static_cast<int32_t>(m_entries.size());
+        const uint16_t nameId = internString(name);
+        m_entries.push_back(Entry{type, std::move(name), nameId});
+    }
+}
+
+bool CardDatabase::add(std::string_view pattern, CardType type, std::string name)
+{
+    AtrPattern p;
+    if (!AtrPattern::parse(pattern, p)) return false;
+    add(p, type, std::move(name));
+    return true;
+}
+
+std::size_t CardDatabase::loadSmartcardList(std::istream &in)
+{
+    const std::size_t before = m_entries.size();
+    std::string line;
+    AtrPattern pending;
+    bool havePending = false;
+
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            havePending = false;
+            continue;
+        }
+        if (line[0] == '\t') {
+            // Первая строка описания становится именем записи
+            if (havePending) {
+                add(pending, CardType::Unknown, std::string(trimmed(line)));
+                havePending = false;
+            }
+            continue;
+        }
+        havePending = AtrPattern::parse(line, pending);
+    }
+    return m_entries.size() - before;
+}
+
+std::size_t CardDatabase::loadSmartcardList(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in) return 0;
+    return loadSmartcardList(in);
+}
+
+const CardDatabase::Entry *CardDatabase::lookup(std::span<const uint8_t> atr) const
+{
+    if (atr.empty() || atr.size() > kMaxAtrLength) return nullptr;
+    Match best;
+    match(0, atr.data(), atr.size(), 0, best);
+    return best.entry >= 0 ? &m_entries[static_cast<std::size_t>(best.entry)] : nullptr;
+}
+
+void CardDatabase::match(uint32_t node, const uint8_t *atr, std::size_t remaining,
+                         uint16_t fixedBits, Match &best) const
+{
+    // Даже при точном совпадении всех оставшихся байтов ветвь не обгонит лучший результат
+    if (best.entry >= 0 && fixedBits + 8 * remaining < best.fixedBits) return;
+
+    const Node &n = m_nodes[node];
+    if (remaining == 0) {
+        if (n.entry >= 0 && (best.entry < 0 || fixedBits > best.fixedBits ||
+                             (fixedBits == best.fixedBits && n.entry < best.entry))) {
+            best = Match{n.entry, fixedBits};
+        }
+        return;
+    }
+
+    // Сначала точное ребро: его совпадение даёт верхнюю границу, отсекающую маски
+    const uint8_t b = *atr;
+    auto it = std::lower_bound(n.exact.begin(), n.exact.end(), b,
+                               [](const Edge &e, uint8_t v) { return e.value < v; });
+    if (it != n.exact.end() && it->value == b) {
+        match(it->child, atr + 1, remaining - 1, static_cast<uint16_t>(fixedBits + 8), best);
+    }
+    for (const Edge &e : n.masked) {
+        if ((b & e.mask) != e.value) continue;
+        match(e.child, atr + 1, remaining - 1,
+              static_cast<uint16_t>(fixedBits + std::popcount(e.mask)), best);
+    }
+}
+
+} // namespace atr
@@ -0,0 +1,96 @@
+#ifndef ATRDATABASE_H
+#define ATRDATABASE_H
+
+// База известных ATR без зависимостей от Qt.
+// Ключи — байты ATR (а не hex-строки), шаблоны могут содержать маски
+// по полубайтам, как в smartcard_list.txt из pcsc-tools ("3B 8. 80 01 ..").
+// Поиск идёт по байтовому префиксному дереву: точные байты — один путь,
+// но на каждом узле проверяются и все рёбра с масками, так что стоимость
+// растёт с числом пересекающихся шаблонов с масками.
+// После заполнения база используется только на чтение и безопасна для
+// одновременного доступа из нескольких потоков.
+
+#include "atrcore.h"
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace atr {
+
+// Шаблон ATR: байт совпадает, если (atr[i] & mask[i]) == value[i]
+struct AtrPattern {
+    uint8_t length;
+    uint8_t value[kMaxAtrLength];
+    uint8_t mask[kMaxAtrLength];
+
+    // Разбор текстового шаблона: "3B 8F 80 01", "3B 8. .. 01".
+    // Пробелы между байтами необязательны.
+    static bool parse(std::string_view text, AtrPattern &out);
+};
+
+class CardDatabase
+{
+public:
+    struct Entry {
+        CardType type;      // CardType::Unknown — тип определяется эвристиками
+        std::string name;   // UTF-8
+        uint16_t nameId;    // name в таблице atrstrings.h, интернируется в add()
+    };
+
+    CardDatabase();
+
+    // Встроенная база известных ATR, создаётся один раз за процесс
+    static const CardDatabase &builtin();
+
+    // Заполнение базы. Для совпадающих шаблонов остаётся первая запись.
+    void add(const AtrPattern &pattern, CardType type, std::string name);
+    bool add(std::string_view pattern, CardType type, std::string name);
+
+    // Загрузка в формате smartcard_list.txt (pcsc-tools): строка шаблона,
+    // затем строки описания, начинающиеся с табуляции. Имя записи — первая
+    // строка описания. Возвращает число добавленных записей; шаблоны
+    // с неподдерживаемым синтаксисом ([..], |) пропускаются.
+    std::size_t loadSmartcardList(std::istream &in);
+    std::size_t loadSmartcardList(const std::string &path);
+
+    // Поиск без форматирования строк и выделения памяти. Для базы только
+    // из точных шаблонов — O(длина ATR); шаблоны с масками добавляют обход
+    // с возвратом по совпадающим рёбрам (ветви, которые уже не могут
+    // победить, отсекаются). При нескольких совпадениях побеждает самый
+    // конкретный шаблон — с наибольшим числом фиксированных бит; при
+    // равенстве — добавленный раньше.
+    const Entry *lookup(std::span<const uint8_t> atr) const;
+    const Entry *lookup(const Atr &atr) const { return lookup(atr.bytes()); }
+
+    std::size_t size() const { return m_entries.size(); }
+
+private:
+    struct Edge {
+        uint8_t value;
+        uint8_t mask;
+        uint32_t child;
+    };
+
+    struct Node {
+        std::vector<Edge> exact;    // mask == 0xFF, отсортированы по value
+        std::vector<Edge> masked;   // шаблоны с масками
+        int32_t entry = -1;
+    };
+
+    struct Match {
+        int32_t entry = -1;
+        uint16_t fixedBits = 0;     // конкретность: число бит под масками шаблона
+    };
+
+    void match(uint32_t node, const uint8_t *atr, std::size_t remaining,
+               uint16_t fixedBits, Match &best) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Entry> m_entries;
+};
+
+} // namespace atr
+
+#endif // ATRDATABASE_H
@@ -0,0 +1,498 @@
+#include "atrformatter.h"
+
+#include <bit>
+#include <charconv>
+#include <span>
+
+namespace {
+
+void appendHex(QString &out, uint8_t byte, bool upper = true)
+{
+    static const char upperDigits[] = "0123456789ABCDEF";
+    static const char lowerDigits[] = "0123456789abcdef";
+    const char *digits = upper ? upperDigits : lowerDigits;
+    out += QLatin1Char(digits[byte >> 4]);
+    out += QLatin1Char(digits[byte & 0x0F]);
+}
+
+// "AA BB CC"
+void appendHexList(QString &out, std::span<const uint8_t> bytes)
+{
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        if (i > 0) out += QLatin1Char(' ');
+        appendHex(out, bytes[i]);
+    }
+}
+
+void appendInt(QString &out, long long value)
+{
+    char buf[24];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out += QLatin1String(buf, static_cast<int>(res.ptr - buf));
+}
+
+void appendEscaped(QString &out, const QString &text)
+{
+    for (const QChar c : text) {
+        switch (c.unicode()) {
+            case '<': out += QLatin1String("&lt;"); break;
+            case '>': out += QLatin1String("&gt;"); break;
+            case '&': out += QLatin1String("&amp;"); break;
+            case '"': out += QLatin1String("&quot;"); break;
+            default: out += c; break;
+        }
+    }
+}
+
+// Цвета ANSI (работают в консоли; в GUI игнорируются)
+const QLatin1String kReset("\x1b[0m");
+const QLatin1String kBold("\x1b[1m");
+const QLatin1String kCyan("\x1b[36m");
+const QLatin1String kGreen("\x1b[32m");
+const QLatin1String kBlue("\x1b[34m");
+const QLatin1String kGray("\x1b[90m");
+
+// Общий стиль значения байта: <code>0xAB</code>
+void appendCodeByte(QString &out, uint8_t byte)
+{
+    out += QLatin1String("<code style='background: #fff; padding: 2px 6px; border-radius: 3px;'>0x");
+    appendHex(out, byte);
+    out += QLatin1String("</code>");
+}
+
+} // namespace
+
+int ATRFormatter::estimateTextSize(const ATRData &data)
+{
+    return 450
+        + 3 * data.atrLength
+        + 3 * data.historicalLength
+        + 6 * std::popcount(data.protocolMask)
+        + (data.hasATS ? 300 + 3 * data.atsLength : 0)
+        + 2 * 64;   // название и производитель
+}
+
+int ATRFormatter::estimateHtmlSize(const ATRData &data)
+{
+    return 2900
+        + 50 * data.atrLength
+        + 300 * data.interfaceLength
+        + 40 * data.historicalLength
+        + 110 * std::popcount(data.protocolMask)
+        + (data.hasATS ? 1000 + 6 * (data.atsLength + data.ats_historicalLength) : 0)
+        + 4 * 64;   // название и производитель
+}
+
+void ATRFormatter::renderAtrHex(const ATRData &data, QString &out)
+{
+    out.resize(0);
+    out.reserve(3 * data.atrLength);
+    appendHexList(out, data.atr());
+}
+
+void ATRFormatter::renderText(const ATRData &data, QString &out)
+{
+    out.resize(0);
+    out.reserve(estimateTextSize(data));
+
+    out += QStringLiteral("=== Информация о карте ===\n");
+    out += QLatin1String("ATR: ");
+    appendHexList(out, data.atr());
+    out += QStringLiteral("\nТип карты: ");
+    out += data.cardName();
+    out += QStringLiteral("\nКатегория: ");
+    out += ATRParser::cardTypeToString(data.cardType);
+    out += QStringLiteral("\nПроизводитель: ");
+    out += data.manufacturer();
+    out += QLatin1String("\n\n");
+
+    out += QStringLiteral("=== Технические детали ===\n");
+    out += QLatin1String("TS: 0x");
+    appendHex(out, data.ts, false);
+    out += data.ts == 0x3B ? QStringLiteral(" (Прямая конвенция)\n") : QStringLiteral(" (Обратная конвенция)\n");
+    out += QLatin1String("T0: 0x");
+    appendHex(out, data.t0, false);
+    out += QStringLiteral("\nИсторические байты (");
+    appendInt(out, data.historicalLength);
+    out += QLatin1String("): ");
+    for (uint8_t byte : data.historical()) {
+        appendHex(out, byte);
+        out += QLatin1Char(' ');
+    }
+    out += QLatin1Char('\n');
+
+    if (data.protocolMask) {
+        out += QStringLiteral("Поддерживаемые протоколы: ");
+        for (int proto = 0; proto < 16; ++proto) {
+            if (!data.supportsProtocol(proto)) continue;
+            out += QLatin1String("T=");
+            appendInt(out, proto);
+            out += QLatin1Char(' ');
+        }
+        out += QLatin1Char('\n');
+    }
+
+    if (data.supportsProtocol(1)) {
+        out += QLatin1String("T=1: IFSC=");
+        appendInt(out, data.ifsc);
+        out += QLatin1String(", BWI=");
+        appendInt(out, data.bwi);
+        out += QLatin1String(", CWI=");
+        appendInt(out, data.cwi);
+        out += QLatin1String(", EDC=");
+        out += QLatin1String(data.edcCrc ? "CRC" : "LRC");
+        out += QLatin1Char('\n');
+    }
+
+    if (data.hasTck) {
+        out += QLatin1String("TCK: 0x");
+        appendHex(out, data.tck, false);
+        out += data.tckValid ? QStringLiteral(" (контрольная сумма OK)\n")
+                             : QStringLiteral(" (контрольная сумма ОШИБКА!)\n");
+    }
+
+    // ATS вывод (если есть)
+    if (data.hasATS) {
+        out += QLatin1Char('\n');
+        out += kBold;
+        out += kCyan;
+        out += QLatin1String("ATS (ISO/IEC 14443-4)");
+        out += kReset;
+        out += QLatin1Char('\n');
+
+        out += kBlue;
+        out += QLatin1String("ATS:");
+        out += kReset;
+        out += QLatin1Char(' ');
+        appendHexList(out, data.ats());
+        out += QLatin1Char('\n');
+
+        if (data.ats_fscPresent) {
+            out += kGreen;
+            out += QLatin1String("FSC:");
+            out += kReset;
+            out += QLatin1Char(' ');
+            appendInt(out, data.ats_fsc);
+            out += QStringLiteral(" байт\n");
+        }
+        if (data.ats_fwi >= 0) {
+            out += kGray;
+            out += QLatin1String("FWI:");
+            out += kReset;
+            out += QLatin1Char(' ');
+            appendInt(out, data.ats_fwi);
+            out += QLatin1String("  ");
+            out += kGray;
+            out += QStringLiteral("(таймаут≈)");
+            out += kReset;
+            out += QStringLiteral(" 302µs * 2^");
+            appendInt(out, data.ats_fwi);
+            out += QLatin1Char('\n');
+        }
+        if (data.ats_sfgi >= 0) {
+            out += kGray;
+            out += QLatin1String("SFGI:");
+            out += kReset;
+            out += QLatin1Char(' ');
+            appendInt(out, data.ats_sfgi);
+            out += QLatin1String("  ");
+            out += kGray;
+            out += QStringLiteral("(guard≈)");
+            out += kReset;
+            out += QStringLiteral(" 302µs * 2^");
+            appendInt(out, data.ats_sfgi);
+            out += QLatin1Char('\n');
+        }
+        out += kGray;
+        out += QLatin1String("Features:");
+        out += kReset;
+        out += QLatin1String(" CID=");
+        out += QLatin1String(data.ats_supportsCID ? "yes" : "no");
+        out += QLatin1String(", NAD=");
+        out += QLatin1String(data.ats_supportsNAD ? "yes" : "no");
+        out += QLatin1Char('\n');
+    }
+}
+
+void ATRFormatter::renderHtml(const ATRData &data, QString &out)
+{
+    out.resize(0);
+    out.reserve(estimateHtmlSize(data));
+
+    // Определяем цвет в зависимости от типа карты
+    QLatin1String cardColor("#2196F3"); // Синий по умолчанию
+    if (data.cardType == CardType::BankCard_EMV) {
+        cardColor = QLatin1String("#4CAF50"); // Зеленый для банковских
+    } else if (data.cardType >= CardType::Mifare_Classic &&
+               data.cardType <= CardType::Mifare_Plus) {
+        cardColor = QLatin1String("#FF9800"); // Оранжевый для Mifare
+    }
+
+    // Заголовок с названием карты
+    out += QLatin1String("<div style='background: linear-gradient(90deg, ");
+    out += cardColor;
+    out += QLatin1String(", ");
+    out += cardColor;
+    out += QLatin1String("CC); padding: 15px; margin: 10px 0; border-radius: 8px;'>");
+    out += QStringLiteral("<h2 style='color: white; margin: 0; text-align: center;'>🔖 ");
+    appendEscaped(out, data.cardName());
+    out += QLatin1String("</h2></div>");
+
+    // Основная информация
+    out += QLatin1String("<div style='background: #f5f5f5; padding: 12px; margin: 10px 0; border-left: 4px solid #2196F3;'>");
+    out += QStringLiteral("<b style='color: #1976D2;'>Тип карты:</b> <span style='color: #424242;'>");
+    out += ATRParser::cardTypeToString(data.cardType);
+    out += QStringLiteral("</span><br><b style='color: #1976D2;'>Производитель:</b> <span style='color: #424242;'>");
+    appendEscaped(out, data.manufacturer());
+    out += QLatin1String("</span></div>");
+
+    // ATR в hex
+    out += QLatin1String("<div style='margin: 15px 0;'>");
+    out += QStringLiteral("<h3 style='color: #1976D2; border-bottom: 2px solid #2196F3; padding-bottom: 5px;'>📋 ATR (HEX)</h3>");
+    out += QLatin1String("<div style='background: #263238; padding: 12px; border-radius: 4px; font-family: \"Courier New\", monospace;'>");
+    for (int i = 0; i < data.atrLength; i++) {
+        if (i > 0 && i % 16 == 0) out += QLatin1String("<br>");
+        else if (i > 0) out += QLatin1Char(' ');
+
+        // Подсветка разных частей ATR
+        QLatin1String byteColor("#00E676"); // Зеленый по умолчанию
+        if (i == 0) byteColor = QLatin1String("#FF5252"); // TS - красный
+        else if (i == 1) byteColor = QLatin1String("#FFD740"); // T0 - желтый
+        else if (i < 2 + data.interfaceLength) byteColor = QLatin1String("#00B0FF"); // Interface - голубой
+
+        out += QLatin1String("<span style='color: ");
+        out += byteColor;
+        out += QLatin1String(";'>");
+        appendHex(out, data.rawAtr[i]);
+        out += QLatin1String("</span>");
+    }
+    out += QLatin1String("</div></div>");
+
+    // Детальный разбор
+    out += QStringLiteral("<h3 style='color: #1976D2; border-bottom: 2px solid #2196F3; padding-bottom: 5px; margin-top: 20px;'>🔍 ДЕТАЛЬНЫЙ РАЗБОР ATR</h3>");
+
+    // TS байт
+    out += QLatin1String("<div style='background: #FFEBEE; padding: 10px; margin: 8px 0; border-left: 4px solid #F44336;'>");
+    out += QLatin1String("<b style='color: #C62828;'>TS</b> = ");
+    appendCodeByte(out, data.ts);
+    out += data.ts == 0x3B ? QStringLiteral(" <span style='color: #666;'>(Прямая конвенция)</span>")
+                           : QStringLiteral(" <span style='color: #666;'>(Обратная конвенция)</span>");
+    out += QLatin1String("</div>");
+
+    // T0 байт
+    auto mark = [](bool present) { return present ? QStringLiteral("✓") : QStringLiteral("✗"); };
+    out += QLatin1String("<div style='background: #FFF9C4; padding: 10px; margin: 8px 0; border-left: 4px solid #FBC02D;'>");
+    out += QLatin1String("<b style='color: #F57F17;'>T0</b> = ");
+    appendCodeByte(out, data.t0);
+    out += QStringLiteral(" <span style='color: #666;'>→ Исторических байт: <b>");
+    appendInt(out, data.t0 & 0x0F);
+    out += QLatin1String("</b>, TA:<b>");
+    out += mark(data.t0 & 0x10);
+    out += QLatin1String("</b> TB:<b>");
+    out += mark(data.t0 & 0x20);
+    out += QLatin1String("</b> TC:<b>");
+    out += mark(data.t0 & 0x40);
+    out += QLatin1String("</b> TD:<b>");
+    out += mark(data.t0 & 0x80);
+    out += QLatin1String("</b></span></div>");
+
+    // Interface bytes TA
+    const int taCount = data.interfaceByteCount(atr::TA);
+    if (taCount > 0) {
+        out += QLatin1String("<div style='margin: 15px 0;'>");
+        out += QStringLiteral("<h4 style='color: #0288D1; margin: 10px 0;'>⚡ INTERFACE BYTES TA (Параметры скорости)</h4>");
+        for (int i = 0; i < taCount; i++) {
+            out += QLatin1String("<div style='background: #E1F5FE; padding: 8px; margin: 5px 0; border-left: 3px solid #0288D1;'>");
+            out += QLatin1String("<b style='color: #01579B;'>TA");
+            appendInt(out, i + 1);
+            out += QLatin1String("</b> = ");
+            appendCodeByte(out, data.interfaceByte(atr::TA, i));
+            if (i == 0) {
+                out += QStringLiteral(" <span style='color: #666;'>→ Fi=<b>");
+                appendInt(out, data.clockRateConversion);
+                out += QLatin1String("</b>, Di=<b>");
+                appendInt(out, data.bitRateAdjustment);
+                out += QStringLiteral("</b>, Скорость: <b style='color: #0288D1;'>");
+                appendInt(out, data.baudRate);
+                out += QStringLiteral(" бит/с</b></span>");
+            }
+            out += QLatin1String("</div>");
+        }
+        out += QLatin1String("</div>");
+    }
+
+    // Interface bytes TB
+    const int tbCount = data.interfaceByteCount(atr::TB);
+    if (tbCount > 0) {
+        out += QLatin1String("<div style='margin: 15px 0;'>");
+        out += QStringLiteral("<h4 style='color: #7B1FA2; margin: 10px 0;'>🔋 INTERFACE BYTES TB (Параметры программирования)</h4>");
+        for (int i = 0; i < tbCount; i++) {
+            out += QLatin1String("<div style='background: #F3E5F5; padding: 8px; margin: 5px 0; border-left: 3px solid #7B1FA2;'>");
+            out += QLatin1String("<b style='color: #4A148C;'>TB");
+            appendInt(out, i + 1);
+            out += QLatin1String("</b> = ");
+            appendCodeByte(out, data.interfaceByte(atr::TB, i));
+            if (i == 0) {
+                out += QStringLiteral(" <span style='color: #666;'>→ VPP=<b>");
+                appendInt(out, data.programmingVoltage);
+                out += QLatin1String("</b>, IPP=<b>");
+                appendInt(out, data.programmingCurrent);
+                out += QLatin1String("</b></span>");
+            }
+            out += QLatin1String("</div>");
+        }
+        out += QLatin1String("</div>");
+    }
+
+    // Interface bytes TC
+    const int tcCount = data.interfaceByteCount(atr::TC);
+    if (tcCount > 0) {
+        out += QLatin1String("<div style='margin: 15px 0;'>");
+        out += QStringLiteral("<h4 style='color: #E64A19; margin: 10px 0;'>⏱️ INTERFACE BYTES TC (Временные параметры)</h4>");
+        for (int i = 0; i < tcCount; i++) {
+            out += QLatin1String("<div style='background: #FBE9E7; padding: 8px; margin: 5px 0; border-left: 3px solid #E64A19;'>");
+            out += QLatin1String("<b style='color: #BF360C;'>TC");
+            appendInt(out, i + 1);
+            out += QLatin1String("</b> = ");
+            appendCodeByte(out, data.interfaceByte(atr::TC, i));
+            if (i == 0) {
+                out += QStringLiteral(" <span style='color: #666;'>→ Guard Time: <b>");
+                appendInt(out, data.guardTime);
+                out += QLatin1String("</b></span>");
+            } else if (i == 1) {
+                out += QStringLiteral(" <span style='color: #666;'>→ Waiting Time: <b>");
+                appendInt(out, data.waitingTime);
+                out += QLatin1String("</b></span>");
+            }
+            out += QLatin1String("</div>");
+        }
+        out += QLatin1String("</div>");
+    }
+
+    // Interface bytes TD
+    const int tdCount = data.interfaceByteCount(atr::TD);
+    if (tdCount > 0) {
+        out += QLatin1String("<div style='margin: 15px 0;'>");
+        out += QStringLiteral("<h4 style='color: #00796B; margin: 10px 0;'>🔗 INTERFACE BYTES TD (Индикаторы протокола)</h4>");
+        for (int i = 0; i < tdCount; i++) {
+            out += QLatin1String("<div style='background: #E0F2F1; padding: 8px; margin: 5px 0; border-left: 3px solid #00796B;'>");
+            out += QLatin1String("<b style='color: #004D40;'>TD");
+            appendInt(out, i + 1);
+            out += QLatin1String("</b> = ");
+            const uint8_t td = data.interfaceByte(atr::TD, i);
+            appendCodeByte(out, td);
+            out += QStringLiteral(" <span style='color: #666;'>→ Протокол: <b style='color: #00796B;'>T=");
+            appendInt(out, td & 0x0F);
+            out += QLatin1String("</b></span></div>");
+        }
+        out += QLatin1String("</div>");
+    }
+
+    // Исторические байты
+    if (data.historicalLength > 0) {
+        out += QLatin1String("<div style='margin: 15px 0;'>");
+        out += QStringLiteral("<h4 style='color: #5D4037; margin: 10px 0;'>📚 ИСТОРИЧЕСКИЕ БАЙТЫ (");
+        appendInt(out, data.historicalLength);
+        out += QStringLiteral(" байт)</h4>");
+        out += QLatin1String("<div style='background: #EFEBE9; padding: 12px; border-left: 4px solid #5D4037; font-family: \"Courier New\", monospace;'>");
+        const std::span<const uint8_t> historical = data.historical();
+        for (std::size_t i = 0; i < historical.size(); i++) {
+            if (i > 0 && i % 16 == 0) out += QLatin1String("<br>");
+            else if (i > 0) out += QLatin1Char(' ');
+            out += QLatin1String("<span style='color: #3E2723;'>");
+            appendHex(out, historical[i]);
+            out += QLatin1String("</span>");
+        }
+        out += QLatin1String("</div></div>");
+    }
+
+    // TCK (контрольная сумма)
+    if (data.hasTck) {
+        const bool ok = data.tckValid;
+        out += QLatin1String("<div style='background: ");
+        out += QLatin1String(ok ? "#E8F5E9" : "#FFEBEE");
+        out += QLatin1String("; padding: 10px; margin: 10px 0; border-left: 4px solid ");
+        out += QLatin1String(ok ? "#4CAF50" : "#F44336");
+        out += QLatin1String(";'><b style='color: ");
+        const QLatin1String textColor(ok ? "#2E7D32" : "#C62828");
+        out += textColor;
+        out += QLatin1String(";'>TCK</b> = ");
+        appendCodeByte(out, data.tck);
+        out += QStringLiteral(" <span style='color: #666;'>→ Контрольная сумма: <b style='color: ");
+        out += textColor;
+        out += QLatin1String(";'>");
+        out += ok ? QStringLiteral("✅ Верна") : QStringLiteral("❌ Ошибка");
+        out += QLatin1String("</b></span></div>");
+    }
+
+    // Поддерживаемые протоколы
+    if (data.protocolMask) {
+        out += QLatin1String("<div style='background: #E3F2FD; padding: 10px; margin: 10px 0; border-left: 4px solid #1976D2;'>");
+        out += QStringLiteral("<b style='color: #0D47A1;'>📡 Поддерживаемые протоколы:</b> ");
+        bool first = true;
+        for (int proto = 0; proto < 16; ++proto) {
+            if (!data.supportsProtocol(proto)) continue;
+            if (!first) out += QLatin1Char(' ');
+            first = false;
+            out += QLatin1String("<span style='background: #1976D2; color: white; padding: 2px 8px; border-radius: 3px; margin: 0 2px;'>T=");
+            appendInt(out, proto);
+            out += QLatin1String("</span>");
+        }
+        out += QLatin1String("</div>");
+    }
+
+    // Параметры T=1 (по умолчанию, если в ATR их нет)
+    if (data.supportsProtocol(1)) {
+        out += QLatin1String("<div style='background: #E3F2FD; padding: 10px; margin: 10px 0; border-left: 4px solid #1976D2;'>");
+        out += QStringLiteral("<b style='color: #0D47A1;'>Параметры T=1:</b> <span style='color: #666;'>IFSC=<b>");
+        appendInt(out, data.ifsc);
+        out += QLatin1String("</b>, BWI=<b>");
+        appendInt(out, data.bwi);
+        out += QLatin1String("</b>, CWI=<b>");
+        appendInt(out, data.cwi);
+        out += QLatin1String("</b>, EDC=<b>");
+        out += QLatin1String(data.edcCrc ? "CRC" : "LRC");
+        out += QLatin1String("</b></span></div>");
+    }
+
+    // ATS (в том же стиле)
+    if (data.hasATS && data.atsLength > 0) {
+        out += QLatin1String("<div style='margin-top:10px; color:#00BCD4; font-weight:600;'>ATS (ISO/IEC 14443-4)</div>");
+        out += QLatin1String("<div><span style='color:#8E24AA;'>ATS:</span> <span style='color:#222;'>");
+        appendHexList(out, data.ats());
+        out += QLatin1String("</span></div>");
+
+        if (data.ats_fscPresent) {
+            out += QLatin1String("<div><span style='color:#43A047;'>FSC:</span> <span style='color:#222;'>");
+            appendInt(out, data.ats_fsc);
+            out += QStringLiteral(" байт</span></div>");
+        }
+        if (data.ats_fwi >= 0) {
+            out += QLatin1String("<div><span style='color:#777;'>FWI:</span> <span style='color:#222;'>");
+            appendInt(out, data.ats_fwi);
+            out += QStringLiteral("</span><span style='color:#777;'> &nbsp; (~timeout)≈</span><span style='color:#222;'>302µs * 2^");
+            appendInt(out, data.ats_fwi);
+            out += QLatin1String("</span></div>");
+        }
+        if (data.ats_sfgi >= 0) {
+            out += QLatin1String("<div><span style='color:#777;'>SFGI:</span> <span style='color:#222;'>");
+            appendInt(out, data.ats_sfgi);
+            out += QStringLiteral("</span><span style='color:#777;'> &nbsp; (~guard)≈</span><span style='color:#222;'>302µs * 2^");
+            appendInt(out, data.ats_sfgi);
+            out += QLatin1String("</span></div>");
+        }
+
+        out += QStringLiteral("<div><span style='color:#777;'>Опции:</span> <span style='color:#222;'>CID=");
+        out += data.ats_supportsCID ? QStringLiteral("да") : QStringLiteral("нет");
+        out += QLatin1String(", NAD=");
+        out += data.ats_supportsNAD ? QStringLiteral("да") : QStringLiteral("нет");
+        out += QLatin1String("</span></div>");
+
+        // ATS Historical bytes
+        if (data.ats_historicalLength > 0) {
+            out += QLatin1String("<div><span style='color:#777;'>ATS Historical bytes:</span> <span style='color:#222;'>");
+            appendHexList(out, data.atsHistorical());
+            out += QLatin1String("</span></div>");
+        }
+    }
+}
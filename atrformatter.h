@@ -0,0 +1,31 @@
+#ifndef ATRFORMATTER_H
+#define ATRFORMATTER_H
+
+#include <QString>
+
+#include "atrparser.h"
+
+// Форматирование результата разбора для отображения.
+// Работает только с неизменяемым снимком ATRData (повторный разбор не
+// нужен) и пишет в буфер вызывающего: буфер очищается с сохранением
+// ёмкости и заранее резервируется под оценку размера, поэтому при
+// повторном использовании одного QString выделений памяти нет.
+// Вызывается только там, где вывод действительно показывается.
+class ATRFormatter
+{
+public:
+    // ATR в hex через пробел: "3B 8F 80 ..."
+    static void renderAtrHex(const ATRData &data, QString &out);
+
+    // Текстовый отчёт (ATS-часть с ANSI-цветами для консоли)
+    static void renderText(const ATRData &data, QString &out);
+
+    // HTML для QTextEdit
+    static void renderHtml(const ATRData &data, QString &out);
+
+private:
+    static int estimateTextSize(const ATRData &data);
+    static int estimateHtmlSize(const ATRData &data);
+};
+
+#endif // ATRFORMATTER_H
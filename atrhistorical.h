@@ -0,0 +1,210 @@
+#ifndef ATRHISTORICAL_H
+#define ATRHISTORICAL_H
+
+// Декодер исторических байтов ATR/ATS (ISO/IEC 7816-4, 8.1.1) без
+// зависимостей от Qt. Разбор ленивый: индекс объектов COMPACT-TLV строится
+// при первом обращении к любому объекту, а каждое поле (card service data,
+// card capabilities, status indicator, PC/SC Part 3) декодируется только
+// при запросе. Байты не копируются — декодер ссылается на переданный буфер.
+// Экземпляр хранит индекс в mutable-полях и не разделяется между потоками
+// без синхронизации; создавать его дёшево (на стеке, без выделения памяти).
+
+#include "atrcore.h"
+
+#include <cstdint>
+#include <span>
+
+namespace atr {
+
+// Теги COMPACT-TLV (старший полубайт; младший — длина)
+enum class HistoricalTag : uint8_t {
+    CountryCode = 0x1,
+    IssuerId = 0x2,
+    CardServiceData = 0x3,
+    InitialAccessData = 0x4,
+    CardIssuerData = 0x5,
+    PreIssuingData = 0x6,
+    CardCapabilities = 0x7,
+    StatusIndicator = 0x8,
+    ApplicationId = 0xF
+};
+
+// Card service data (тег 3)
+struct CardServiceData {
+    bool selectByFullDfName;     // b8
+    bool selectByPartialDfName;  // b7
+    bool dataObjectsInDir;       // b6: BER-TLV объекты в EF.DIR
+    bool dataObjectsInAtr;       // b5: BER-TLV объекты в EF.ATR
+    uint8_t efAccess;            // b4-b2: 4 — READ BINARY, 0 — READ RECORD, 2 — GET DATA
+    bool withoutMf;              // b1 == 1: карта без MF
+};
+
+// Card capabilities (тег 7, 1-3 байта)
+struct CardCapabilities {
+    uint8_t length;
+    uint8_t selectionMethods;    // первая таблица функций (DF/EF selection)
+    uint8_t dataCoding;          // вторая таблица (0, если байта нет)
+    bool commandChaining;        // третья таблица: b8
+    bool extendedLength;         // b7: расширенные Lc/Le
+    uint8_t logicalChannels;     // макс. число логических каналов (0 — нет данных)
+};
+
+// Status indicator: LCS и/или SW1-SW2
+struct StatusIndicator {
+    bool hasLifeCycle;
+    uint8_t lifeCycle;
+    bool hasStatusWord;
+    uint16_t statusWord;
+};
+
+// PC/SC Part 3: бесконтактная карта, ATR сформирован ридером
+//   80 4F 0C A0 00 00 03 06 SS NN NN 00 00 00 00
+struct PcscCardInfo {
+    uint8_t standard;            // SS: 03 — ISO 14443-A часть 3, 11 — FeliCa, ...
+    uint16_t cardName;           // NN NN: 0001 — Mifare 1K, 0003 — Ultralight, ...
+};
+
+class HistoricalBytes
+{
+public:
+    explicit HistoricalBytes(std::span<const uint8_t> bytes) : m_bytes(bytes) {}
+
+    std::span<const uint8_t> bytes() const { return m_bytes; }
+
+    // Category indicator (первый байт) или -1, если байтов нет
+    int categoryIndicator() const { return m_bytes.empty() ? -1 : m_bytes[0]; }
+
+    // 0x00 (status indicator в последних трёх байтах) и 0x80 — COMPACT-TLV;
+    // 0x10 — ссылка на DIR, остальные значения — собственный формат
+    bool isCompactTlv() const
+    {
+        return !m_bytes.empty() && (m_bytes[0] == 0x00 || m_bytes[0] == 0x80);
+    }
+
+    // Вся цепочка COMPACT-TLV корректна и занимает исторические байты целиком
+    bool wellFormed() const
+    {
+        index();
+        return m_wellFormed;
+    }
+
+    // Значение объекта (первое вхождение тега); пусто, если объекта нет
+    std::span<const uint8_t> object(HistoricalTag tag) const
+    {
+        index();
+        const uint8_t t = static_cast<uint8_t>(tag);
+        if (!m_offset[t]) return {};
+        return m_bytes.subspan(m_offset[t], m_length[t]);
+    }
+
+    bool has(HistoricalTag tag) const
+    {
+        index();
+        return m_offset[static_cast<uint8_t>(tag)] != 0;
+    }
+
+    bool serviceData(CardServiceData &out) const
+    {
+        const std::span<const uint8_t> v = object(HistoricalTag::CardServiceData);
+        if (v.empty()) return false;
+        const uint8_t b = v[0];
+        out = CardServiceData{(b & 0x80) != 0, (b & 0x40) != 0, (b & 0x20) != 0, (b & 0x10) != 0,
+                              static_cast<uint8_t>((b >> 1) & 0x07), (b & 0x01) != 0};
+        return true;
+    }
+
+    bool capabilities(CardCapabilities &out) const
+    {
+        const std::span<const uint8_t> v = object(HistoricalTag::CardCapabilities);
+        if (v.empty()) return false;
+        out = CardCapabilities{static_cast<uint8_t>(v.size()), v[0], 0, false, false, 0};
+        if (v.size() >= 2) out.dataCoding = v[1];
+        if (v.size() >= 3) {
+            const uint8_t b = v[2];
+            out.commandChaining = (b & 0x80) != 0;
+            out.extendedLength = (b & 0x40) != 0;
+            // b5-b4 != 00 — логические каналы поддерживаются; b3-b1 — число минус один
+            if (b & 0x18) out.logicalChannels = static_cast<uint8_t>((b & 0x07) + 1);
+        }
+        return true;
+    }
+
+    bool status(StatusIndicator &out) const
+    {
+        const std::span<const uint8_t> v = object(HistoricalTag::StatusIndicator);
+        if (v.empty() || v.size() > 3) return false;
+        out = StatusIndicator{false, 0, false, 0};
+        if (v.size() != 2) {
+            out.hasLifeCycle = true;
+            out.lifeCycle = v[0];
+        }
+        if (v.size() >= 2) {
+            out.hasStatusWord = true;
+            out.statusWord = static_cast<uint16_t>((v[v.size() - 2] << 8) | v[v.size() - 1]);
+        }
+        return true;
+    }
+
+    bool pcscCard(PcscCardInfo &out) const
+    {
+        static constexpr uint8_t kPcscRid[] = {0xA0, 0x00, 0x00, 0x03, 0x06};
+        const std::span<const uint8_t> aid = object(HistoricalTag::ApplicationId);
+        if (aid.size() < 8) return false;
+        for (std::size_t i = 0; i < sizeof(kPcscRid); ++i) {
+            if (aid[i] != kPcscRid[i]) return false;
+        }
+        out = PcscCardInfo{aid[5], static_cast<uint16_t>((aid[6] << 8) | aid[7])};
+        return true;
+    }
+
+private:
+    void index() const
+    {
+        if (m_indexed) return;
+        m_indexed = true;
+        m_wellFormed = false;
+        for (uint8_t &o : m_offset) o = 0;
+        if (!isCompactTlv() || m_bytes.size() > 255) return;
+
+        std::size_t end = m_bytes.size();
+        if (m_bytes[0] == 0x00) {
+            // Обязательный status indicator — последние три байта вне TLV
+            if (end < 4) return;
+            end -= 3;
+            m_offset[static_cast<uint8_t>(HistoricalTag::StatusIndicator)] = static_cast<uint8_t>(end);
+            m_length[static_cast<uint8_t>(HistoricalTag::StatusIndicator)] = 3;
+        }
+
+        std::size_t pos = 1;
+        // PC/SC Part 3: AID в виде BER-TLV 4F LL (а не COMPACT-TLV 4F)
+        if (m_bytes[0] == 0x80 && end >= 3 && m_bytes[1] == 0x4F && 3u + m_bytes[2] <= end) {
+            m_offset[static_cast<uint8_t>(HistoricalTag::ApplicationId)] = 3;
+            m_length[static_cast<uint8_t>(HistoricalTag::ApplicationId)] = m_bytes[2];
+            m_wellFormed = 3u + m_bytes[2] == end;
+            return;
+        }
+
+        while (pos < end) {
+            const uint8_t tag = m_bytes[pos] >> 4;
+            const uint8_t length = m_bytes[pos] & 0x0F;
+            if (tag == 0 || pos + 1 + length > end) return;
+            if (!m_offset[tag]) {
+                m_offset[tag] = static_cast<uint8_t>(pos + 1);
+                m_length[tag] = length;
+            }
+            pos += 1 + length;
+        }
+        m_wellFormed = true;
+    }
+
+    std::span<const uint8_t> m_bytes;
+    // Ленивый индекс по тегу: смещение значения (0 — объекта нет) и длина
+    mutable bool m_indexed = false;
+    mutable bool m_wellFormed = false;
+    mutable uint8_t m_offset[16];
+    mutable uint8_t m_length[16];
+};
+
+} // namespace atr
+
+#endif // ATRHISTORICAL_H
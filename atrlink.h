@@ -0,0 +1,232 @@
+#ifndef ATRLINK_H
+#define ATRLINK_H
+
+// Параметры канала для настройки собственного транспорта APDU без
+// зависимостей от Qt. Из разобранного ATR (ISO/IEC 7816-3) или ATS
+// (ISO/IEC 14443-4) вычисляются размеры кадров, тип EDC, скорость и все
+// таймауты в микросекундах для заданной частоты CLK, а также
+// рекомендуемый PPS-запрос. Времена округляются вверх: это наименьшие
+// таймауты, которые ещё не нарушают стандарт.
+
+#include "atrcore.h"
+#include "atrtables.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace atr {
+
+// PPS-запрос (ISO/IEC 7816-3, 9.2): PPSS PPS0 [PPS1] PCK
+struct PpsRequest {
+    bool needed;                 // false — PPS не нужен или невозможен
+    uint8_t protocol;            // T в PPS0
+    uint8_t fidi;                // PPS1: Fi (b8-b5), Di (b4-b1)
+    uint8_t length;              // байтов в bytes (0, если PPS не нужен)
+    uint8_t bytes[4];
+};
+
+// Канал контактной карты после PPS (или сразу после ATR в specific mode)
+struct LinkTiming {
+    uint32_t clockHz;
+    bool clockAllowed;           // clockHz не выше f(max) из TA1
+    bool specificMode;           // TA2: протокол и скорость заданы картой, PPS невозможен
+    bool implicitParameters;     // TA2 b5: Fi/Di не из TA1 — работаем на Fd/Dd
+
+    uint8_t protocol;            // T=0 или T=1
+    uint16_t fi;
+    uint8_t di;
+    uint32_t baud;               // бит/с: f * Di / Fi
+    uint32_t etuNs;              // длительность etu, нс
+    PpsRequest pps;
+
+    // Guard time между символами от ридера: 12 etu + N (TC1)
+    uint16_t guardTimeEtu;
+    uint32_t guardTimeUs;
+
+    // T=0: WT = WI * 960 * Fi / f, Fi из TA1
+    uint32_t waitingTimeUs;
+
+    // T=1 (ISO/IEC 7816-3, 11.4)
+    uint16_t ifsc;               // максимальное поле INF от ридера к карте
+    bool edcCrc;                 // CRC (2 байта) вместо LRC (1 байт)
+    uint8_t edcLength;
+    uint16_t maxBlockLength;     // пролог (3) + IFSC + EDC
+    uint32_t characterWaitingTimeUs;  // CWT = (11 + 2^CWI) etu
+    uint32_t blockWaitingTimeUs;      // BWT = 11 etu + 2^BWI * 960 * 372 / f
+    uint32_t blockGuardTimeUs;        // BGT = 22 etu
+};
+
+// Канал бесконтактной карты (ISO/IEC 14443-4, T=CL)
+struct ContactlessTiming {
+    uint16_t fsc;                // максимальный кадр от PCD к PICC (с PCB/CID/NAD/CRC)
+    uint16_t maxInfLength;       // FSC - PCB - CRC - CID/NAD, если карта их поддерживает
+    bool supportsCID;
+    bool supportsNAD;
+    uint32_t frameWaitingTimeUs; // FWT + дельта FWT (49152 / fc)
+    uint32_t startupGuardTimeUs; // SFGT: пауза после ATS перед первым кадром
+
+    // Скорости по TA(1) с учётом ограничения ридера: D = 2^DSI / 2^DRI
+    uint8_t dsi;                 // PICC -> PCD
+    uint8_t dri;                 // PCD -> PICC
+    uint16_t kbpsToPcd;
+    uint16_t kbpsToPicc;
+    // PPS (ISO/IEC 14443-4, 5.6): PPSS = D0 | CID, PPS0 = 11, PPS1 = DSI << 2 | DRI;
+    // CRC_A добавляет транспорт
+    bool ppsNeeded;
+    uint8_t pps1;
+};
+
+namespace detail {
+
+// Длительность cycles / divisor тактов частоты f в микросекундах, вверх
+constexpr uint32_t cyclesToUs(uint64_t cycles, uint32_t divisor, uint32_t f)
+{
+    const uint64_t den = uint64_t(divisor) * f;
+    return static_cast<uint32_t>((cycles * 1000000ull + den - 1) / den);
+}
+
+// ISO/IEC 14443-4: 128 / 2^n fc при fc = 13.56 МГц — 106 * 2^n кбит/с
+inline constexpr uint16_t kClKbps[4] = {106, 212, 424, 848};
+
+// Наибольший делитель из маски TA(1) (бит n-1 — 2^n), укладывающийся в
+// maxKbps; 0 — 106 кбит/с
+inline uint8_t bestClDivisor(uint8_t mask, uint16_t maxKbps)
+{
+    for (uint8_t n = 3; n > 0; --n) {
+        if ((mask & (1u << (n - 1))) && (!maxKbps || kClKbps[n] <= maxKbps)) return n;
+    }
+    return 0;
+}
+
+} // namespace detail
+
+// Рекомендуемые параметры контактного канала. maxBaud — предел ридера
+// (0 — без ограничения): если скорость из TA1 выше, в PPS1 запрашивается
+// наибольший Di с тем же Fi, который в предел укладывается.
+// В negotiable mode выбирается T=1, если карта его предлагает, иначе T=0.
+inline LinkTiming linkTiming(const Atr &a, uint32_t clockHz = tables::kClocksHz[tables::kDefaultClock],
+                             uint32_t maxBaud = 0)
+{
+    LinkTiming t{};
+    t.clockHz = clockHz ? clockHz : tables::kClocksHz[tables::kDefaultClock];
+    const uint32_t f = t.clockHz;
+
+    const bool hasTa1 = a.groupCount > 0 && a.groups[0].has(TA);
+    const bool hasTa2 = a.groupCount > 1 && a.groups[1].has(TA);
+    const uint8_t ta1 = hasTa1 ? a.groups[0].ta : 0x11;
+    const tables::Ta1 &card = tables::kTa1[ta1];
+    t.clockAllowed = card.fmax == 0 || f <= uint32_t(card.fmax) * 100000u;
+
+    t.fi = 372;
+    t.di = 1;
+    uint8_t fidi = 0x11;
+    if (hasTa2) {
+        // Specific mode: карта сразу работает по TA2, PPS не принимается
+        const uint8_t ta2 = a.groups[1].ta;
+        t.specificMode = true;
+        t.implicitParameters = (ta2 & 0x10) != 0;
+        t.protocol = ta2 & 0x0F;
+        if (!t.implicitParameters && card.valid) {
+            t.fi = card.fi;
+            t.di = card.di;
+        }
+    } else {
+        t.protocol = a.supportsProtocol(1) ? 1 : 0;
+        if (hasTa1 && card.valid) {
+            // Di карты или, если скорость выше предела ридера, меньшая степень
+            // двойки с тем же Fi; Fi карты с Di = 1 медленнее Fd/Dd и не берётся
+            auto tryDi = [&](uint8_t diCode) {
+                const uint8_t di = tables::kDi[diCode];
+                if (di > card.di || di <= t.di) return;
+                if (maxBaud && uint64_t(f) * di / card.fi > maxBaud) return;
+                t.fi = card.fi;
+                t.di = di;
+                fidi = static_cast<uint8_t>((ta1 & 0xF0) | diCode);
+            };
+            tryDi(ta1 & 0x0F);
+            for (uint8_t diCode = 2; diCode <= 7; ++diCode) tryDi(diCode);
+        }
+        // PPS нужен, если меняются Fi/Di или протокол не первый из TD1
+        const uint8_t firstOffered = a.groupCount > 0 && a.groups[0].has(TD) ? a.groups[0].td & 0x0F : 0;
+        if (fidi != 0x11 || t.protocol != firstOffered) {
+            PpsRequest &pps = t.pps;
+            pps.needed = true;
+            pps.protocol = t.protocol;
+            pps.fidi = fidi;
+            pps.bytes[0] = 0xFF;
+            if (fidi != 0x11) {
+                pps.bytes[1] = static_cast<uint8_t>(0x10 | t.protocol);
+                pps.bytes[2] = fidi;
+                pps.length = 4;
+            } else {
+                pps.bytes[1] = t.protocol;
+                pps.length = 3;
+            }
+            uint8_t pck = 0;
+            for (uint8_t i = 0; i + 1 < pps.length; ++i) pck ^= pps.bytes[i];
+            pps.bytes[pps.length - 1] = pck;
+        }
+    }
+
+    t.baud = static_cast<uint32_t>(uint64_t(f) * t.di / t.fi);
+    t.etuNs = static_cast<uint32_t>((uint64_t(t.fi) * 1000000000ull + uint64_t(t.di) * f / 2) / (uint64_t(t.di) * f));
+
+    // Время в etu: n * Fi / Di тактов
+    auto etuUs = [&](uint64_t n) { return detail::cyclesToUs(n * t.fi, t.di, f); };
+
+    const tables::Tc1 &tc1 = tables::kTc1[a.guardTime];
+    t.guardTimeEtu = t.protocol == 1 ? tc1.guardEtuT1 : tc1.guardEtuT0;
+    t.guardTimeUs = etuUs(t.guardTimeEtu);
+
+    // Fi в WT — из TA1 карты (ISO/IEC 7816-3, 10.2), даже если канал работает на Fd
+    t.waitingTimeUs = detail::cyclesToUs(uint64_t(a.waitingTime) * 960u * card.fi, 1, f);
+
+    t.ifsc = a.ifsc;
+    t.edcCrc = a.edcCrc;
+    t.edcLength = a.edcCrc ? 2 : 1;
+    t.maxBlockLength = static_cast<uint16_t>(3 + t.ifsc + t.edcLength);
+    t.characterWaitingTimeUs = etuUs(11u + (1u << a.cwi));
+    // 11 etu + 2^BWI * 960 * 372 тактов; общий делитель Di
+    t.blockWaitingTimeUs = detail::cyclesToUs(11ull * t.fi + (uint64_t(960u * 372u) << a.bwi) * t.di, t.di, f);
+    t.blockGuardTimeUs = etuUs(22);
+    return t;
+}
+
+// Параметры T=CL по ATS. maxKbps — предел ридера (0 — без ограничения).
+inline ContactlessTiming linkTiming(const Ats &s, uint16_t maxKbps = 0)
+{
+    ContactlessTiming t{};
+    t.fsc = static_cast<uint16_t>(s.fsc > 0 ? s.fsc : detail::kAtsFscTable[2]);
+    t.supportsCID = s.supportsCID;
+    t.supportsNAD = s.supportsNAD;
+    // PCB + CRC_A; CID и NAD учитываются, только если карта их поддерживает
+    const uint16_t overhead = static_cast<uint16_t>(3 + (s.supportsCID ? 1 : 0) + (s.supportsNAD ? 1 : 0));
+    t.maxInfLength = static_cast<uint16_t>(t.fsc > overhead ? t.fsc - overhead : 0);
+
+    // Без TB(1): FWI = 4, SFGI = 0
+    const tables::AtsTb &tb = tables::kAtsTb[s.fwi >= 0 ? static_cast<uint8_t>((s.fwi << 4) | s.sfgi) : 0x40];
+    // Дельта FWT = 49152 / fc ≈ 3.6 мкс, вверх
+    t.frameWaitingTimeUs = tb.fwtUs + 4;
+    t.startupGuardTimeUs = tb.sfgtUs;
+
+    // TA(1) с b4 = 1 (RFU) не используется: остаёмся на 106 кбит/с
+    const tables::AtsTa &ta = tables::kAtsTa[s.has(TA) ? s.bitRates : 0];
+    const uint8_t dsMask = ta.valid ? ta.dsMask : 0;
+    const uint8_t drMask = ta.valid ? ta.drMask : 0;
+    const uint8_t ds = detail::bestClDivisor(ta.sameBitRate ? dsMask & drMask : dsMask, maxKbps);
+    const uint8_t dr = ta.sameBitRate ? ds : detail::bestClDivisor(drMask, maxKbps);
+    t.dsi = ds;
+    t.dri = dr;
+    t.kbpsToPcd = detail::kClKbps[ds];
+    t.kbpsToPicc = detail::kClKbps[dr];
+    t.ppsNeeded = ds != 0 || dr != 0;
+    t.pps1 = static_cast<uint8_t>((ds << 2) | dr);
+    return t;
+}
+
+// Контрольное значение: etu при Fd/Dd и 3.5712 МГц — 104.17 мкс
+static_assert(detail::cyclesToUs(372, 1, 3571200) == 105);
+
+} // namespace atr
+
+#endif // ATRLINK_H
@@ -4,97 +4,207 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
-#include <QMap>
-
-// Типы карт
-enum class CardType {
-    Unknown,
-    BankCard_EMV,
-    Mifare_Classic,
-    Mifare_DESFire,
-    Mifare_Ultralight,
-    Mifare_Plus,
-    ISO14443A,
-    ISO14443B
-};
+#include <QMetaType>
 
-// Структура для детального парсинга interface bytes
-struct InterfaceByteDetails {
-    struct TABytes {
-        QVector<uint8_t> values;
-        int clockRateConversion;  // Fi
-        int bitRateAdjustment;    // Di
-        int baudRate;
-
-        TABytes() : clockRateConversion(372), bitRateAdjustment(1), baudRate(9600) {}
-    };
-
-    struct TBBytes {
-        QVector<uint8_t> values;
-        int programmingVoltage;   // VPP
-        int programmingCurrent;   // IPP
-
-        TBBytes() : programmingVoltage(0), programmingCurrent(0) {}
-    };
-
-    struct TCBytes {
-        QVector<uint8_t> values;
-        int guardTime;            // N (extra guard time)
-        int waitingTime;          // WI (waiting time integer)
-
-        TCBytes() : guardTime(0), waitingTime(10) {}
-    };
-
-    struct TDBytes {
-        QVector<uint8_t> values;
-        QVector<int> protocols;   // Список протоколов из каждого TD
-    };
-
-    TABytes ta;
-    TBBytes tb;
-    TCBytes tc;
-    TDBytes td;
-};
+#include <bit>
+#include <span>
+#include <type_traits>
+
+#include "atrcore.h"
+#include "atrdatabase.h"
+#include "atrlink.h"
+#include "atrrules.h"
+#include "atrvalidate.h"
 
-// Структура для хранения распарсенного ATR
+// ATS длиннее этого сохраняется усечённым (TL может доходить до FSD-2,
+// но реальные карты укладываются в 20 байт)
+constexpr int kMaxStoredAtsLength = 20;
+
+// Распарсенный ATR (+ ATS). Компактная запись фиксированного размера без
+// данных в куче: байты ATR/ATS лежат во встроенных массивах, части ATR
+// задаются смещениями в rawAtr, протоколы — битовой маской, название и
+// производитель — идентификаторами строк (atrstrings.h). Копируется как
+// memcpy (в том числе при передаче через queued-сигналы) и занимает не
+// больше двух строк кэша.
 struct ATRData {
-    QVector<uint8_t> rawAtr;
-    uint8_t ts;              // Initial character
-    uint8_t t0;              // Format character
-    QVector<uint8_t> interfaceBytes;
-    QVector<uint8_t> historicalBytes;
-    uint8_t tck;             // Check character (если есть)
-    bool hasTck;
-
-    // Протоколы
-    QVector<int> supportedProtocols;
-
-    // Детальный парсинг interface bytes
-    InterfaceByteDetails interfaceDetails;
-
-    // Информация о карте
-    CardType cardType;
-    QString cardName;
-    QString manufacturer;
-
-    // ATS (ISO/IEC 14443-4, T=CL)
-    QVector<uint8_t> atsRaw;     // Полный ATS
+    // ATR: rawAtr[0 .. atrLength)
+    uint8_t rawAtr[atr::kMaxAtrLength] = {};
+    uint8_t atrLength = 0;
+    uint8_t ts = 0;              // Initial character
+    uint8_t t0 = 0;              // Format character
+    // Interface bytes: rawAtr[2 .. 2 + interfaceLength)
+    uint8_t interfaceLength = 0;
+    // Исторические байты: rawAtr[historicalOffset .. historicalOffset + historicalLength)
+    uint8_t historicalOffset = 2;
+    uint8_t historicalLength = 0;
+    uint8_t tck = 0;             // Check character (если есть)
+    bool hasTck = false;
+    bool tckValid = true;        // XOR T0..TCK == 0
+
+    // Протоколы из TD: бит N — T=N
+    uint16_t protocolMask = 0;
+
+    // Маски TA/TB/TC/TD (atr::InterfaceBit) по группам; сами байты — в rawAtr
+    uint8_t groupCount = 0;
+    uint8_t groupPresent[atr::kMaxInterfaceGroups] = {};
+
+    // TA1: Fi/Di и скорость; TB1: VPP/IPP; TC1: N; TC2: WI (T=0)
+    uint16_t clockRateConversion = 372;
+    uint8_t bitRateAdjustment = 1;
+    uint8_t programmingVoltage = 0;
+    uint8_t programmingCurrent = 0;
+    uint8_t guardTime = 0;
+    uint8_t waitingTime = 10;
+    // T=1: IFSC, BWI/CWI, EDC (CRC вместо LRC)
+    uint8_t ifsc = 32;
+    uint8_t bwi = 4;
+    uint8_t cwi = 13;
+    bool edcCrc = false;
+
+    // Информация о карте; строки — в atrstrings.h (QString — ATRStringTable)
+    CardType cardType = CardType::Unknown;
+    uint32_t baudRate = 9600;
+    uint16_t cardNameId = 0;
+    uint16_t manufacturerId = 0;
+
+    // ATS (ISO/IEC 14443-4, T=CL): atsRaw[0 .. atsLength)
+    uint8_t atsRaw[kMaxStoredAtsLength] = {};
+    uint8_t atsLength = 0;
     bool hasATS = false;
+    bool ats_truncated = false;  // TL больше kMaxStoredAtsLength
     // Поля, извлеченные из TL/T0/T[A-D]
-    int ats_hbLen = -1;          // длина исторических байтов ATS
-    bool ats_fscPresent = false; // есть ли размер фрейма (FSCI)
-    int ats_fsc = -1;            // байтовый размер кадра (FSC)
-    bool ats_taPresent = false;
-    bool ats_tbPresent = false;
-    bool ats_tcPresent = false;
-    bool ats_tdPresent = false;
-    int ats_fwi = -1;            // Frame Waiting Integer
-    int ats_sfgi = -1;           // Start-up Frame Guard Integer
+    uint8_t ats_present = 0;     // маска TA/TB/TC из T0
+    bool ats_fscPresent = false; // есть ли T0 с размером кадра (FSCI)
+    int16_t ats_fsc = -1;        // байтовый размер кадра (FSC)
+    uint8_t ats_bitRates = 0;    // TA: делители DS/DR (0 — только 106 кбит/с)
+    int8_t ats_fwi = -1;         // Frame Waiting Integer
+    int8_t ats_sfgi = -1;        // Start-up Frame Guard Integer
     bool ats_supportsCID = false;
     bool ats_supportsNAD = false;
-    QVector<uint8_t> ats_historicalBytes;
+    // Исторические байты ATS: atsRaw[ats_historicalOffset .. + ats_historicalLength)
+    uint8_t ats_historicalOffset = 0;
+    uint8_t ats_historicalLength = 0;
+
+    // Представления без копирования; действительны, пока жива запись
+    std::span<const uint8_t> atr() const { return {rawAtr, atrLength}; }
+    std::span<const uint8_t> historical() const { return {rawAtr + historicalOffset, historicalLength}; }
+    // Байты группы i (0 — TA1..TD1) в порядке TA, TB, TC, TD; пусто, если группы нет
+    std::span<const uint8_t> interfaceGroup(int i) const;
+    std::span<const uint8_t> ats() const { return {atsRaw, atsLength}; }
+    std::span<const uint8_t> atsHistorical() const { return {atsRaw + ats_historicalOffset, ats_historicalLength}; }
+
+    bool supportsProtocol(int protocol) const
+    {
+        return protocol >= 0 && protocol < 16 && (protocolMask & (1u << protocol)) != 0;
+    }
+
+    // Число байтов вида bit (TA/TB/TC/TD) во всех группах и index-й из них
+    // (TA1, TA2, ... в порядке следования)
+    int interfaceByteCount(atr::InterfaceBit bit) const;
+    uint8_t interfaceByte(atr::InterfaceBit bit, int index) const;
 
-    ATRData() : ts(0), t0(0), tck(0), hasTck(false), cardType(CardType::Unknown) {}
+    bool ats_has(atr::InterfaceBit bit) const { return (ats_present & bit) != 0; }
+
+    // Параметры канала для своего транспорта (atrlink.h): скорость после
+    // PPS, размеры кадров и таймауты в мкс при частоте CLK clockHz;
+    // maxBaud / maxKbps — предел ридера (0 — без ограничения).
+    // Без ATR / ATS — значения по умолчанию ISO 7816-3 / ISO 14443-4.
+    atr::LinkTiming linkTiming(uint32_t clockHz = atr::tables::kClocksHz[atr::tables::kDefaultClock],
+                               uint32_t maxBaud = 0) const;
+    atr::ContactlessTiming contactlessTiming(uint16_t maxKbps = 0) const;
+
+    QString cardName() const;
+    QString manufacturer() const;
+};
+
+static_assert(std::is_trivially_copyable_v<ATRData>, "ATRData копируется как memcpy");
+static_assert(sizeof(ATRData) <= 128, "ATRData должна умещаться в две строки кэша");
+
+inline std::span<const uint8_t> ATRData::interfaceGroup(int i) const
+{
+    if (i < 0 || i >= groupCount) return {};
+    int offset = 2;
+    for (int g = 0; g < i; ++g) {
+        offset += std::popcount(unsigned(groupPresent[g]));
+    }
+    return {rawAtr + offset, static_cast<std::size_t>(std::popcount(unsigned(groupPresent[i])))};
+}
+
+inline int ATRData::interfaceByteCount(atr::InterfaceBit bit) const
+{
+    int count = 0;
+    for (uint8_t g = 0; g < groupCount; ++g) {
+        if (groupPresent[g] & bit) ++count;
+    }
+    return count;
+}
+
+inline uint8_t ATRData::interfaceByte(atr::InterfaceBit bit, int index) const
+{
+    // Байты группы идут в порядке TA, TB, TC, TD
+    int offset = 2;
+    for (uint8_t g = 0; g < groupCount; ++g) {
+        const unsigned present = groupPresent[g];
+        if ((present & bit) && index-- == 0) {
+            return rawAtr[offset + std::popcount(present & (bit - 1u))];
+        }
+        offset += std::popcount(present);
+    }
+    return 0;
+}
+
+// Для передачи между потоками (queued-сигналы ReaderWorker)
+Q_DECLARE_METATYPE(ATRData)
+
+// Результат разбора без строк и сигналов: код ошибки ядра и смещение
+// байта во входе, на котором разбор остановился (для обрыва цепочки и
+// слишком короткого входа — длина входа, для лишних байтов — первый лишний)
+struct ParseResult {
+    atr::Status status = atr::Status::Ok;
+    uint8_t offset = 0;
+
+    bool ok() const { return status == atr::Status::Ok; }
+    explicit operator bool() const { return ok(); }
+};
+
+// Разбор ATR/ATS в ATRData без QObject, сигналов и QString: ошибки
+// возвращаются как ParseResult. Обычный объект, который можно держать в
+// любом потоке (по одному на поток) и на стеке; ATRParser — его
+// Qt-обёртка с сигналами.
+class ATRDecoder
+{
+public:
+    ATRDecoder();
+
+    // При ошибке прежний результат не меняется
+    ParseResult parseATR(std::span<const uint8_t> atr);
+    // При ошибке поля ATS сбрасываются (hasATS == false)
+    ParseResult parseATS(std::span<const uint8_t> ats);
+
+    const ATRData &data() const { return m_atrData; }
+
+    // Строгий режим: parseATR() дополнительно проверяет ATR по ISO 7816-3
+    // (atr::validate()) и отказывает со Status::StrictViolation, если есть
+    // ошибки; смещение — первой ошибки. Предупреждения не мешают разбору.
+    void setStrict(bool strict) { m_strict = strict; }
+    bool strict() const { return m_strict; }
+    // Нарушения последнего parseATR() (только в строгом режиме)
+    const atr::Diagnostics &diagnostics() const { return m_diagnostics; }
+
+    // База и правила должны жить дольше декодера; nullptr — встроенные
+    void setCardDatabase(const atr::CardDatabase *database);
+    const atr::CardDatabase *cardDatabase() const { return m_database; }
+    void setRuleSet(const atr::RuleSet *rules);
+    const atr::RuleSet *ruleSet() const { return m_rules; }
+
+private:
+    void detectCardType(const atr::Atr &decoded);
+
+    ATRData m_atrData;
+    const atr::CardDatabase *m_database;
+    const atr::RuleSet *m_rules;
+    bool m_strict = false;
+    atr::Diagnostics m_diagnostics;
 };
 
 class ATRParser : public QObject
@@ -105,54 +215,62 @@ public:
     explicit ATRParser(QObject *parent = nullptr);
     ~ATRParser();
     
-    // Основные методы парсинга
+    // Основные методы парсинга. Вход разбирается на месте (в том числе
+    // память вызывающего, например кольцевой буфер захвата); байты
+    // копируются один раз — в запись ATRData.
     bool parseATR(const QVector<uint8_t> &atr);
     bool parseATR(const uint8_t *atr, size_t length);
+    bool parseATR(std::span<const uint8_t> atr);
     // Новый: парсинг ATS (14443-4)
     bool parseATS(const QVector<uint8_t>& ats);
     bool parseATS(const uint8_t* ats, size_t length);
+    // Код и смещение ошибки последнего parseATR()/parseATS()
+    ParseResult lastResult() const { return m_lastResult; }
+
+    // Режим наблюдателя: cardDetected/parsingError (и предупреждение о
+    // TCK) выдаются только в нём. По умолчанию выключен — разбор не
+    // строит строк и не вызывает сигналы.
+    void setObserverMode(bool enabled) { m_observerMode = enabled; }
+    bool observerMode() const { return m_observerMode; }
+
+    // Строгая проверка ISO 7816-3 (см. ATRDecoder::setStrict())
+    void setStrict(bool strict) { m_decoder.setStrict(strict); }
+    bool strict() const { return m_decoder.strict(); }
+    const atr::Diagnostics &diagnostics() const { return m_decoder.diagnostics(); }
 
     // Получение результатов
-    ATRData getATRData() const { return m_atrData; }
-    CardType getCardType() const { return m_atrData.cardType; }
-    QString getCardName() const { return m_atrData.cardName; }
-    QString getManufacturer() const { return m_atrData.manufacturer; }
-    QVector<int> getSupportedProtocols() const { return m_atrData.supportedProtocols; }
+    ATRData getATRData() const { return m_decoder.data(); }
+    CardType getCardType() const { return m_decoder.data().cardType; }
+    QString getCardName() const { return m_decoder.data().cardName(); }
+    QString getManufacturer() const { return m_decoder.data().manufacturer(); }
+    QVector<int> getSupportedProtocols() const;
+
+    // База известных ATR (по умолчанию atr::CardDatabase::builtin()).
+    // База должна жить дольше парсера.
+    void setCardDatabase(const atr::CardDatabase *database) { m_decoder.setCardDatabase(database); }
+    const atr::CardDatabase *cardDatabase() const { return m_decoder.cardDatabase(); }
+    // Правила определения типа карты (по умолчанию atr::RuleSet::builtin())
+    void setRuleSet(const atr::RuleSet *rules) { m_decoder.setRuleSet(rules); }
+    const atr::RuleSet *ruleSet() const { return m_decoder.ruleSet(); }
     
-    // Утилиты
+    // Утилиты. Для повторного использования буфера и вывода по уже
+    // готовому ATRData используйте ATRFormatter напрямую.
     QString atrToString() const;
     QString getDetailedInfo();
     QString getFormattedOutput();  // Новый метод для красивого вывода
     static QString cardTypeToString(CardType type);
+    // Текст ошибки для parsingError (строится только по запросу)
+    static QString errorString(const ParseResult &result, std::span<const uint8_t> input,
+                               bool ats = false);
     
 signals:
     void cardDetected(CardType type, const QString &name);
     void parsingError(const QString &error);
 
 private:
-    ATRData m_atrData;
-    
-    // Внутренние методы парсинга
-    bool parseInterfaceBytes();
-    void parseInterfaceBytesDetailed();  // Новый метод для детального парсинга
-    void detectCardType();
-    bool verifyChecksum();
-    
-    // Определение типов карт
-    bool isMifareClassic() const;
-    bool isMifareDESFire() const;
-    bool isMifareUltralight() const;
-    bool isMifarePlus() const;
-    bool isEMVBankCard();
-    
-    // Словарь известных ATR
-    void initKnownATRs();
-    QMap<QString, QPair<CardType, QString>> m_knownATRs;
-    
-    // Определение производителя по историческим байтам
-    QString detectManufacturer() const;
-    // Вспомогательное форматирование ATS
-    static int atsFSCItoFSC(int fsci);
+    ATRDecoder m_decoder;
+    ParseResult m_lastResult;
+    bool m_observerMode = false;
 };
 
 #endif // ATRPARSER_H
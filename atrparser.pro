@@ -2,10 +2,14 @@ TEMPLATE = subdirs
 
 SUBDIRS = \
     atrparser_gui \
-    atrparser_console
+    atrparser_console \
+    atrparser_batch
 
 # GUI Application
 atrparser_gui.file = atrparser_gui.pro
 
 # Console Application
 atrparser_console.file = atrparser_console.pro
+
+# Batch decoder (без PC/SC)
+atrparser_batch.file = atrparser_batch.pro
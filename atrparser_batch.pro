@@ -0,0 +1,28 @@
+QT += core
+QT -= gui
+
+TARGET = atrparser_batch
+TEMPLATE = app
+
+CONFIG += c++2a console thread
+CONFIG -= app_bundle
+
+# Source files (без PC/SC)
+SOURCES += \
+    batch_decoder.cpp \
+    atrdatabase.cpp \
+    atrrules.cpp \
+    atrstrings.cpp
+
+HEADERS += \
+    atrcore.h \
+    atrdatabase.h \
+    atrhistorical.h \
+    atrrules.h \
+    atrstrings.h \
+    atrtables.h \
+    atrvalidate.h
+
+# Install
+target.path = /usr/local/bin
+INSTALLS += target
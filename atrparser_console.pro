@@ -4,18 +4,47 @@ QT -= gui
 TARGET = atrparser_console
 TEMPLATE = app
 
-CONFIG += c++17 console
+CONFIG += c++2a console
 CONFIG -= app_bundle
 
 # Source files
 SOURCES += \
     console_example.cpp \
+    atrdatabase.cpp \
+    atrformatter.cpp \
     atrparser.cpp \
-    cardreader.cpp
+    atrresultcache.cpp \
+    atrrules.cpp \
+    atrstrings.cpp \
+    atrstringtable.cpp \
+    atsprobecache.cpp \
+    cardmonitor.cpp \
+    cardreader.cpp \
+    linknegotiator.cpp \
+    pcsctransport.cpp \
+    pipelinemetrics.cpp \
+    readerworker.cpp
 
 HEADERS += \
+    atrcore.h \
+    atrdatabase.h \
+    atrformatter.h \
+    atrhistorical.h \
+    atrlink.h \
     atrparser.h \
-    cardreader.h
+    atrresultcache.h \
+    atrrules.h \
+    atrstrings.h \
+    atrstringtable.h \
+    atrtables.h \
+    atrvalidate.h \
+    atsprobecache.h \
+    cardmonitor.h \
+    cardreader.h \
+    linknegotiator.h \
+    pcsctransport.h \
+    pipelinemetrics.h \
+    readerworker.h
 
 # PC/SC Lite library
 unix {
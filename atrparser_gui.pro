@@ -3,17 +3,46 @@ QT += core gui widgets
 TARGET = atrparser_gui
 TEMPLATE = app
 
-CONFIG += c++17
+CONFIG += c++2a
 
 # Source files
 SOURCES += \
     main.cpp \
+    atrdatabase.cpp \
+    atrformatter.cpp \
     atrparser.cpp \
-    cardreader.cpp
+    atrresultcache.cpp \
+    atrrules.cpp \
+    atrstrings.cpp \
+    atrstringtable.cpp \
+    atsprobecache.cpp \
+    cardmonitor.cpp \
+    cardreader.cpp \
+    linknegotiator.cpp \
+    pcsctransport.cpp \
+    pipelinemetrics.cpp \
+    readerworker.cpp
 
 HEADERS += \
+    atrcore.h \
+    atrdatabase.h \
+    atrformatter.h \
+    atrhistorical.h \
+    atrlink.h \
     atrparser.h \
-    cardreader.h
+    atrresultcache.h \
+    atrrules.h \
+    atrstrings.h \
+    atrstringtable.h \
+    atrtables.h \
+    atrvalidate.h \
+    atsprobecache.h \
+    cardmonitor.h \
+    cardreader.h \
+    linknegotiator.h \
+    pcsctransport.h \
+    pipelinemetrics.h \
+    readerworker.h
 
 # PC/SC Lite library
 unix {
@@ -0,0 +1,159 @@
+#include "atrreclassify.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+namespace atr {
+
+namespace {
+
+// Диапазон блоков одного потока. Владелец берёт блоки из начала, вор
+// забирает половину остатка с конца; оба под коротким мьютексом диапазона.
+struct alignas(64) WorkQueue {
+    std::mutex lock;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    bool pop(std::size_t &block)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (begin == end) return false;
+        block = begin++;
+        return true;
+    }
+
+    std::size_t remaining()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return end - begin;
+    }
+
+    // Отдать вору вторую половину остатка
+    bool split(std::size_t &first, std::size_t &last)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const std::size_t left = end - begin;
+        if (left < 2) return false;
+        first = end - left / 2;
+        last = end;
+        end = first;
+        return true;
+    }
+
+    void assign(std::size_t first, std::size_t last)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        begin = first;
+        end = last;
+    }
+};
+
+struct WorkerResult {
+    std::array<std::size_t, kCardTypeCount> histogram{};
+    std::array<std::array<std::size_t, kCardTypeCount>, kCardTypeCount> transitions{};
+    std::vector<TypeChange> changes;
+    std::size_t invalid = 0;
+};
+
+std::size_t typeIndex(CardType type)
+{
+    const std::size_t i = static_cast<std::size_t>(type);
+    return i < kCardTypeCount ? i : 0;
+}
+
+} // namespace
+
+ReclassifyResult reclassify(const Corpus &corpus, const CardDatabase &db, const RuleSet &rules,
+                            std::span<const CardType> previous, const ReclassifyOptions &options)
+{
+    ReclassifyResult result;
+    result.types.resize(corpus.count);
+    if (corpus.count == 0) return result;
+
+    const bool diff = previous.size() == corpus.count;
+    const std::size_t blockSize = std::max<std::size_t>(1, options.blockSize);
+    const std::size_t blocks = (corpus.count + blockSize - 1) / blockSize;
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, blocks));
+
+    std::vector<WorkQueue> queues(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        queues[t].assign(blocks * t / threads, blocks * (t + 1) / threads);
+    }
+    std::vector<WorkerResult> partial(threads);
+
+    auto runBlock = [&](std::size_t block, WorkerResult &local, std::vector<BatchRecord> &records) {
+        const std::size_t first = block * blockSize;
+        const std::size_t n = std::min(blockSize, corpus.count - first);
+        classifyBatch(corpus.atrs + first * corpus.stride, corpus.stride, corpus.lengths + first, n,
+                      db, rules, records.data());
+        for (std::size_t i = 0; i < n; ++i) {
+            const CardType type = records[i].status == Status::Ok ? records[i].id.type : CardType::Unknown;
+            if (records[i].status != Status::Ok) ++local.invalid;
+            result.types[first + i] = type;
+            ++local.histogram[typeIndex(type)];
+            if (diff) {
+                const CardType before = previous[first + i];
+                ++local.transitions[typeIndex(before)][typeIndex(type)];
+                if (before != type) local.changes.push_back(TypeChange{first + i, before, type});
+            }
+        }
+    };
+
+    auto worker = [&](unsigned self) {
+        std::vector<BatchRecord> records(blockSize);
+        WorkerResult &local = partial[self];
+        for (;;) {
+            std::size_t block = 0;
+            while (queues[self].pop(block)) runBlock(block, local, records);
+
+            // Своё кончилось: крадём у потока с наибольшим остатком
+            unsigned victim = self;
+            std::size_t most = 0;
+            for (unsigned t = 0; t < threads; ++t) {
+                if (t == self) continue;
+                const std::size_t left = queues[t].remaining();
+                if (left > most) {
+                    most = left;
+                    victim = t;
+                }
+            }
+            if (victim == self) return;
+
+            std::size_t first = 0;
+            std::size_t last = 0;
+            if (queues[victim].split(first, last)) {
+                queues[self].assign(first, last);
+            } else if (queues[victim].pop(block)) {
+                runBlock(block, local, records);
+            }
+            // Иначе остаток успели забрать — ищем заново
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    for (const WorkerResult &local : partial) {
+        for (std::size_t i = 0; i < kCardTypeCount; ++i) {
+            result.histogram[i] += local.histogram[i];
+            for (std::size_t j = 0; j < kCardTypeCount; ++j) {
+                result.transitions[i][j] += local.transitions[i][j];
+            }
+        }
+        result.invalid += local.invalid;
+        result.changes.insert(result.changes.end(), local.changes.begin(), local.changes.end());
+    }
+    std::sort(result.changes.begin(), result.changes.end(),
+              [](const TypeChange &a, const TypeChange &b) { return a.index < b.index; });
+    return result;
+}
+
+} // namespace atr
@@ -0,0 +1,58 @@
+#ifndef ATRRECLASSIFY_H
+#define ATRRECLASSIFY_H
+
+// Переклассификация корпуса ATR после обновления базы известных ATR или
+// правил. Корпус — сырые байты в буфере с фиксированным шагом (как у
+// classifyBatch()); декодирование и определение типа идут на всех ядрах без
+// Qt-объектов на запись. Блоки записей распределяются по потокам с кражей
+// работы: каждый поток забирает блоки из начала своего диапазона, а
+// освободившийся поток отнимает половину остатка у самого загруженного.
+// Результат — новые типы, гистограмма по CardType и отличия от прежней
+// классификации.
+
+#include "atrbatch.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace atr {
+
+struct Corpus {
+    const uint8_t *atrs;         // i-я запись — atrs[i * stride .. + lengths[i])
+    std::size_t stride;
+    const uint8_t *lengths;
+    std::size_t count;
+};
+
+// Запись, тип которой изменился
+struct TypeChange {
+    std::size_t index;
+    CardType from;
+    CardType to;
+};
+
+struct ReclassifyResult {
+    std::vector<CardType> types;                            // по записям корпуса
+    std::array<std::size_t, kCardTypeCount> histogram{};    // по новым типам
+    std::array<std::array<std::size_t, kCardTypeCount>, kCardTypeCount> transitions{}; // [было][стало]
+    std::vector<TypeChange> changes;                        // по возрастанию index
+    std::size_t invalid = 0;                                // ATR с ошибкой декодирования (тип Unknown)
+};
+
+struct ReclassifyOptions {
+    unsigned threads = 0;        // 0 — по числу ядер
+    std::size_t blockSize = 4096; // записей в блоке (единица кражи работы)
+};
+
+// previous — прежняя классификация (count элементов) или пустой span, если
+// отличия не нужны. Для ATR с ошибкой декодирования тип — Unknown.
+ReclassifyResult reclassify(const Corpus &corpus, const CardDatabase &db, const RuleSet &rules,
+                            std::span<const CardType> previous = {},
+                            const ReclassifyOptions &options = {});
+
+} // namespace atr
+
+#endif // ATRRECLASSIFY_H
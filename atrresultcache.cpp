@@ -0,0 +1,192 @@
+#include "atrresultcache.h"
+#include "pipelinemetrics.h"
+
+#include <cstring>
+#include <thread>
+
+namespace {
+
+// Читатель набора на время find(): отмечается в счётчике текущей эпохи.
+// Эпоха перечитывается после отметки — если запись успела её переключить,
+// отметка переносится в новый счётчик, иначе запись могла бы не дождаться
+// читателя, увидевшего старую запись набора.
+class ReaderGuard
+{
+public:
+    ReaderGuard(std::atomic<uint8_t> &epoch, std::atomic<uint32_t> (&readers)[2])
+    {
+        for (;;) {
+            const uint8_t e = epoch.load();
+            readers[e].fetch_add(1);
+            if (epoch.load() == e) {
+                m_counter = &readers[e];
+                return;
+            }
+            readers[e].fetch_sub(1);
+        }
+    }
+    ~ReaderGuard() { m_counter->fetch_sub(1); }
+
+private:
+    std::atomic<uint32_t> *m_counter;
+};
+
+} // namespace
+
+ATRResultCache &ATRResultCache::instance()
+{
+    static ATRResultCache cache;
+    return cache;
+}
+
+ATRResultCache::ATRResultCache(int capacity)
+{
+    std::size_t sets = 1;
+    while (sets * kWays < static_cast<std::size_t>(qMax(capacity, kWays))) sets <<= 1;
+    m_setStorage = std::make_unique<Set[]>(sets);
+    m_sets = std::span<Set>(m_setStorage.get(), sets);
+}
+
+ATRResultCache::~ATRResultCache()
+{
+    for (Set &set : m_sets) {
+        for (std::atomic<Node *> &way : set.ways) delete way.load();
+    }
+}
+
+uint64_t ATRResultCache::hashKey(std::span<const uint8_t> atr, std::span<const uint8_t> ats)
+{
+    // FNV-1a; длина ATR входит в хэш, чтобы граница ATR/ATS различалась
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](uint8_t b) {
+        h ^= b;
+        h *= 1099511628211ull;
+    };
+    mix(static_cast<uint8_t>(atr.size()));
+    for (uint8_t b : atr) mix(b);
+    for (uint8_t b : ats) mix(b);
+    return h;
+}
+
+bool ATRResultCache::matches(const Node *node, uint64_t hash,
+                             std::span<const uint8_t> atr, std::span<const uint8_t> ats)
+{
+    return node->hash == hash
+        && node->atrLength == atr.size()
+        && node->key.size() == atr.size() + ats.size()
+        && std::memcmp(node->key.data(), atr.data(), atr.size()) == 0
+        && (ats.empty() || std::memcmp(node->key.data() + atr.size(), ats.data(), ats.size()) == 0);
+}
+
+ATRResultCache::Set &ATRResultCache::setFor(uint64_t hash) const
+{
+    // Старшие биты: у FNV-1a они перемешаны лучше младших
+    return m_sets[(hash >> 32) & (m_sets.size() - 1)];
+}
+
+ATRResultCache::Entry ATRResultCache::find(std::span<const uint8_t> atr, std::span<const uint8_t> ats) const
+{
+    const uint64_t hash = hashKey(atr, ats);
+    Set &set = setFor(hash);
+
+    ReaderGuard guard(set.epoch, set.readers);
+    for (int i = 0; i < kWays; ++i) {
+        const Node *node = set.ways[i].load();
+        if (node && matches(node, hash, atr, ats)) {
+            if (!set.referenced[i].load(std::memory_order_relaxed)) {
+                set.referenced[i].store(true, std::memory_order_relaxed);
+            }
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return node->data;
+        }
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+ATRResultCache::Entry ATRResultCache::insert(std::span<const uint8_t> atr, std::span<const uint8_t> ats,
+                                             const ATRData &data)
+{
+    const uint64_t hash = hashKey(atr, ats);
+    Set &set = setFor(hash);
+
+    std::lock_guard<std::mutex> lock(m_writeLock);
+
+    // Другой поток мог успеть вставить тот же ключ после нашего промаха
+    int target = -1;
+    for (int i = 0; i < kWays; ++i) {
+        const Node *node = set.ways[i].load();
+        if (node && matches(node, hash, atr, ats)) return node->data;
+        if (!node && target < 0) target = i;
+    }
+
+    // CLOCK: первый канал без отметки обращения; отметки по пути снимаются
+    if (target < 0) {
+        while (set.referenced[set.hand].exchange(false, std::memory_order_relaxed)) {
+            set.hand = (set.hand + 1) % kWays;
+        }
+        target = set.hand;
+        set.hand = (set.hand + 1) % kWays;
+    }
+
+    Node *node = new Node{hash, static_cast<uint8_t>(atr.size()), {}, std::make_shared<const ATRData>(data)};
+    node->key.reserve(atr.size() + ats.size());
+    node->key.insert(node->key.end(), atr.begin(), atr.end());
+    node->key.insert(node->key.end(), ats.begin(), ats.end());
+    Entry entry = node->data;
+
+    set.referenced[target].store(false, std::memory_order_relaxed);
+    if (Node *old = set.ways[target].exchange(node)) {
+        retire(set, old);
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_insertions.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
+ATRResultCache::Entry ATRResultCache::parse(std::span<const uint8_t> atr, std::span<const uint8_t> ats)
+{
+    if (Entry cached = find(atr, ats)) return cached;
+
+    ATRDecoder decoder;
+    {
+        metrics::StageTimer timer(metrics::Stage::ParseAtr);
+        if (!decoder.parseATR(atr)) return nullptr;
+    }
+    if (!ats.empty()) {
+        metrics::StageTimer timer(metrics::Stage::ParseAts);
+        decoder.parseATS(ats);
+    }
+    return insert(atr, ats, decoder.data());
+}
+
+ATRResultCache::Stats ATRResultCache::stats() const
+{
+    return Stats{m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed),
+                 m_insertions.load(std::memory_order_relaxed), m_evictions.load(std::memory_order_relaxed)};
+}
+
+void ATRResultCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_writeLock);
+    for (Set &set : m_sets) {
+        for (int i = 0; i < kWays; ++i) {
+            if (Node *old = set.ways[i].exchange(nullptr)) retire(set, old);
+            set.referenced[i].store(false, std::memory_order_relaxed);
+        }
+        set.hand = 0;
+    }
+}
+
+void ATRResultCache::retire(Set &set, Node *node)
+{
+    // node убран из таблицы (seq_cst exchange раньше переключения эпохи):
+    // читатель, подтвердивший новую эпоху, его уже не увидит. Ждать нужно
+    // только отмеченных в старом счётчике — новые туда не попадают, поэтому
+    // счётчик обнуляется за время уже начатых find(). Читатели держат не
+    // Node, а копию shared_ptr, так что выданные ATRData переживают удаление.
+    const uint8_t old = set.epoch.load();
+    set.epoch.store(old ^ 1);
+    while (set.readers[old].load() != 0) std::this_thread::yield();
+    delete node;
+}
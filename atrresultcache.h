@@ -0,0 +1,99 @@
+#ifndef ATRRESULTCACHE_H
+#define ATRRESULTCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "atrparser.h"
+
+// Кэш результатов разбора по байтам ATR+ATS.
+// На практике несколько сотен различных ATR дают почти все касания, поэтому
+// повторное касание не разбирается заново: ключ — хэш ATR и ATS (с полным
+// сравнением байтов), значение — общая неизменяемая ATRData. Таблица
+// 4-канальная множественно-ассоциативная, вытеснение внутри набора — CLOCK.
+// Чтение без блокировок: указатели на записи атомарные, читатели отмечаются
+// в счётчиках своего набора (у каждого набора своя строка кэша, так что
+// поиски разных ATR не соприкасаются). Вытесненная запись освобождается
+// сразу: запись переключает эпоху набора и ждёт только читателей, вошедших
+// до переключения, — новые считаются в другом счётчике, поэтому ожидание
+// конечно и списка отложенных записей нет. Запись (insert/clear) — под
+// мьютексом. Результаты соответствуют базе и
+// правилам, которыми разобраны записи; при их смене кэш нужно очистить.
+class ATRResultCache
+{
+public:
+    using Entry = std::shared_ptr<const ATRData>;
+
+    struct Stats {
+        quint64 hits;
+        quint64 misses;
+        quint64 insertions;
+        quint64 evictions;
+    };
+
+    // Общий кэш процесса (встроенные база и правила); используется
+    // ReaderWorker и CardReader
+    static ATRResultCache &instance();
+
+    // capacity — число записей, округляется вверх до 4 * 2^n
+    explicit ATRResultCache(int capacity = 1024);
+    ~ATRResultCache();
+
+    ATRResultCache(const ATRResultCache &) = delete;
+    ATRResultCache &operator=(const ATRResultCache &) = delete;
+
+    // nullptr, если записи нет
+    Entry find(std::span<const uint8_t> atr, std::span<const uint8_t> ats = {}) const;
+    // Сохраняет копию data; если ключ уже есть, возвращает имеющуюся запись
+    Entry insert(std::span<const uint8_t> atr, std::span<const uint8_t> ats, const ATRData &data);
+    // find(), при промахе — разбор ATRDecoder (встроенные база и правила) и
+    // insert(). nullptr, если ATR некорректен (такие ATR не кэшируются).
+    Entry parse(std::span<const uint8_t> atr, std::span<const uint8_t> ats = {});
+
+    Stats stats() const;
+    int capacity() const { return static_cast<int>(m_sets.size()) * kWays; }
+    void clear();
+
+private:
+    static constexpr int kWays = 4;
+
+    struct Node {
+        uint64_t hash;
+        uint8_t atrLength;
+        std::vector<uint8_t> key;    // ATR, затем ATS
+        Entry data;
+    };
+
+    struct alignas(64) Set {
+        std::atomic<Node *> ways[kWays] = {};
+        std::atomic<bool> referenced[kWays] = {};
+        uint8_t hand = 0;            // стрелка CLOCK (только под m_writeLock)
+        // Читатели в find(): счётчик readers[epoch]; epoch переключает запись
+        std::atomic<uint8_t> epoch{0};
+        std::atomic<uint32_t> readers[2] = {};
+    };
+
+    static uint64_t hashKey(std::span<const uint8_t> atr, std::span<const uint8_t> ats);
+    static bool matches(const Node *node, uint64_t hash,
+                        std::span<const uint8_t> atr, std::span<const uint8_t> ats);
+    Set &setFor(uint64_t hash) const;
+    // Под m_writeLock: ждёт читателей набора, которые могли видеть node,
+    // и освобождает его (node уже убран из set.ways)
+    static void retire(Set &set, Node *node);
+
+    std::unique_ptr<Set[]> m_setStorage;
+    std::span<Set> m_sets;
+
+    std::mutex m_writeLock;
+
+    mutable std::atomic<quint64> m_hits{0};
+    mutable std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_insertions{0};
+    std::atomic<quint64> m_evictions{0};
+};
+
+#endif // ATRRESULTCACHE_H
@@ -0,0 +1,456 @@
+#include "atrrules.h"
+#include "atrhistorical.h"
+#include "atrstrings.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <sstream>
+
+namespace atr {
+
+namespace {
+
+// Встроенные эвристики в формате файла правил
+constexpr std::string_view kBuiltinRules = R"(
+# PC/SC Part 3: имя карты из исторических байтов 80 4F 0C A0 00 00 03 06 SS NN NN
+pcsc | Mifare_Classic    | Mifare Classic 1K      | NXP              | 00 01 |
+pcsc | Mifare_Classic    | Mifare Classic 4K      | NXP              | 00 02 |
+pcsc | Mifare_Ultralight | Mifare Ultralight      | NXP              | 00 03 |
+pcsc | Mifare_Classic    | Mifare Mini            | NXP              | 00 26 |
+pcsc | Mifare_Plus       | Mifare Plus SL1 2K     | NXP              | 00 36 |
+pcsc | Mifare_Plus       | Mifare Plus SL1 4K     | NXP              | 00 37 |
+pcsc | Mifare_Plus       | Mifare Plus SL2 2K     | NXP              | 00 38 |
+pcsc | Mifare_Plus       | Mifare Plus SL2 4K     | NXP              | 00 39 |
+pcsc | Mifare_Ultralight | Mifare Ultralight C    | NXP              | 00 3A |
+# Mifare Classic: PC/SC Part 3 ATR 3B 8F 80 ... или 03 00 в исторических байтах
+atr  | Mifare_Classic    | Mifare Classic         |                  | 3B 8F 80 | minlen=4
+hist | Mifare_Classic    | Mifare Classic         |                  | 03 00    | minhist=7
+# DESFire: 3B 81 80 / 3B 86 80 или 75 77 81 в исторических байтах
+atr  | Mifare_DESFire    | Mifare DESFire         |                  | 3B 81 80 |
+atr  | Mifare_DESFire    | Mifare DESFire         |                  | 3B 86 80 |
+hist | Mifare_DESFire    | Mifare DESFire         |                  | 75 77 81 |
+# Ultralight: 3B 8F 80 01 80 4F 0C A0 00 00 03 06 03...
+atr  | Mifare_Ultralight | Mifare Ultralight      |                  | 3B 8F .. .. .. .. A0 .. .. .. 03 |
+# Mifare Plus: маркер 00 01 00 (не в последней позиции)
+hist | Mifare_Plus       | Mifare Plus            |                  | 00 01 00 | tail=1
+# EMV: T=1 и известный RID в исторических байтах, иначе T=1 и длина ATR > 12
+hist | BankCard_EMV      | Банковская карта (EMV) | Visa             | A0 00 00 00 03 | protocols=1
+hist | BankCard_EMV      | Банковская карта (EMV) | Mastercard       | A0 00 00 00 04 | protocols=1
+hist | BankCard_EMV      | Банковская карта (EMV) | American Express | A0 00 00 00 25 | protocols=1
+any  | BankCard_EMV      | Банковская карта (EMV) |                  |                | protocols=1 minlen=13
+)";
+
+std::string_view trimmed(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+// Строки, которые identify() подставляет без правил; интернируются один
+// раз за процесс, чтобы определение типа карты только копировало идентификаторы
+struct FallbackStrings {
+    uint16_t unknown = internString("Неизвестная карта");
+    uint16_t iso14443a = internString("ISO 14443-A карта");
+    uint16_t iso14443b = internString("ISO 14443-B карта");
+    uint16_t manufacturers[std::size(detail::kManufacturerNames)];
+
+    FallbackStrings()
+    {
+        for (std::size_t i = 0; i < std::size(manufacturers); ++i) {
+            manufacturers[i] = internString(detail::kManufacturerNames[i]);
+        }
+    }
+};
+
+const FallbackStrings &fallbackStrings()
+{
+    static const FallbackStrings strings;
+    return strings;
+}
+
+void setDetectedManufacturer(Identification &id, const Atr &a)
+{
+    const uint8_t index = detail::detectManufacturerIndex(a);
+    id.manufacturer = detail::kManufacturerNames[index];
+    id.manufacturerId = fallbackStrings().manufacturers[index];
+}
+
+bool parseNumber(std::string_view s, unsigned max, unsigned &out)
+{
+    if (s.empty()) return false;
+    out = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') return false;
+        out = out * 10 + static_cast<unsigned>(c - '0');
+        if (out > max) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+const RuleSet &RuleSet::builtin()
+{
+    static const RuleSet rules = [] {
+        RuleSet r;
+        r.loadText(kBuiltinRules);
+        return r;
+    }();
+    return rules;
+}
+
+bool RuleSet::cardTypeFromName(std::string_view name, CardType &out)
+{
+    for (int i = static_cast<int>(CardType::Unknown); i <= static_cast<int>(CardType::ISO14443B); ++i) {
+        const CardType type = static_cast<CardType>(i);
+        if (name == cardTypeId(type)) {
+            out = type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RuleSet::load(std::istream &in, std::string *error)
+{
+    std::string line;
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && std::getline(in, line)) {
+        ++lineNo;
+        std::string lineError;
+        if (!parseLine(line, &lineError)) {
+            if (error) *error = "строка " + std::to_string(lineNo) + ": " + lineError;
+            ok = false;
+        }
+    }
+    compile();
+    return ok;
+}
+
+bool RuleSet::load(const std::string &path, std::string *error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "не удалось открыть " + path;
+        return false;
+    }
+    return load(in, error);
+}
+
+bool RuleSet::loadText(std::string_view text, std::string *error)
+{
+    std::istringstream in{std::string(text)};
+    return load(in, error);
+}
+
+bool RuleSet::parseLine(std::string_view line, std::string *error)
+{
+    line = trimmed(line);
+    if (line.empty() || line.front() == '#') return true;
+
+    std::string_view fields[6];
+    std::size_t count = 0;
+    while (count < 6) {
+        const std::size_t bar = line.find('|');
+        fields[count++] = trimmed(line.substr(0, bar));
+        if (bar == std::string_view::npos) break;
+        line.remove_prefix(bar + 1);
+    }
+    if (count < 5) {
+        *error = "ожидается 'вид | тип | имя | производитель | шаблон | условия'";
+        return false;
+    }
+
+    Rule rule{};
+    if (fields[0] == "atr") {
+        rule.kind = Kind::Atr;
+    } else if (fields[0] == "hist") {
+        rule.kind = Kind::Historical;
+    } else if (fields[0] == "any") {
+        rule.kind = Kind::Any;
+    } else if (fields[0] == "pcsc") {
+        rule.kind = Kind::PcscCard;
+    } else {
+        *error = "неизвестный вид правила '" + std::string(fields[0]) + "'";
+        return false;
+    }
+    if (!cardTypeFromName(fields[1], rule.type)) {
+        *error = "неизвестный тип карты '" + std::string(fields[1]) + "'";
+        return false;
+    }
+    rule.name = fields[2];
+    rule.manufacturer = fields[3];
+
+    if (rule.kind == Kind::Any) {
+        if (!fields[4].empty()) {
+            *error = "правило 'any' не может содержать шаблон";
+            return false;
+        }
+    } else if (!AtrPattern::parse(fields[4], rule.pattern)) {
+        *error = "некорректный шаблон '" + std::string(fields[4]) + "'";
+        return false;
+    } else if (rule.kind != Kind::Atr &&
+               std::any_of(rule.pattern.mask, rule.pattern.mask + rule.pattern.length,
+                           [](uint8_t m) { return m != 0xFF; })) {
+        *error = "маски в правилах 'hist' и 'pcsc' не поддерживаются";
+        return false;
+    } else if (rule.kind == Kind::PcscCard && rule.pattern.length != 2) {
+        *error = "шаблон правила 'pcsc' — имя карты из двух байтов";
+        return false;
+    }
+
+    std::string_view options = count > 5 ? fields[5] : std::string_view();
+    while (!(options = trimmed(options)).empty()) {
+        const std::size_t end = options.find_first_of(" \t");
+        const std::string_view option = options.substr(0, end);
+        options.remove_prefix(end == std::string_view::npos ? options.size() : end);
+
+        const std::size_t eq = option.find('=');
+        const std::string_view key = option.substr(0, eq);
+        std::string_view value = eq == std::string_view::npos ? std::string_view() : option.substr(eq + 1);
+        unsigned n = 0;
+        bool valid = true;
+        if (key == "protocols") {
+            valid = !value.empty();
+            while (valid && !value.empty()) {
+                const std::size_t comma = value.find(',');
+                // n проверяется до сдвига: parseNumber выходит с уже превышенным значением
+                if (!parseNumber(value.substr(0, comma), 15, n)) {
+                    valid = false;
+                    break;
+                }
+                rule.protocols |= static_cast<uint16_t>(1u << n);
+                value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+            }
+        } else if (key == "minlen") {
+            valid = parseNumber(value, kMaxAtrLength, n);
+            rule.minLength = static_cast<uint8_t>(n);
+        } else if (key == "minhist") {
+            valid = parseNumber(value, 15, n);
+            rule.minHistorical = static_cast<uint8_t>(n);
+        } else if (key == "tail") {
+            valid = parseNumber(value, 15, n);
+            rule.minTrailing = static_cast<uint8_t>(n);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            *error = "некорректное условие '" + std::string(option) + "'";
+            return false;
+        }
+    }
+
+    rule.nameId = internString(rule.name);
+    rule.manufacturerId = internString(rule.manufacturer);
+    m_rules.push_back(std::move(rule));
+    return true;
+}
+
+void RuleSet::compile()
+{
+    // Префиксное дерево шаблонов ATR
+    m_prefix.assign(1, PrefixNode());
+    for (uint32_t r = 0; r < m_rules.size(); ++r) {
+        const Rule &rule = m_rules[r];
+        if (rule.kind == Kind::Historical || rule.kind == Kind::PcscCard) continue;
+
+        uint32_t node = 0;
+        const uint8_t length = rule.kind == Kind::Atr ? rule.pattern.length : 0;
+        for (uint8_t i = 0; i < length; ++i) {
+            const uint8_t mask = rule.pattern.mask[i];
+            const uint8_t value = rule.pattern.value[i] & mask;
+            std::vector<PrefixEdge> &edges = m_prefix[node].edges;
+            auto it = std::find_if(edges.begin(), edges.end(),
+                                   [&](const PrefixEdge &e) { return e.value == value && e.mask == mask; });
+            if (it != edges.end()) {
+                node = it->child;
+                continue;
+            }
+            const uint32_t child = static_cast<uint32_t>(m_prefix.size());
+            edges.push_back(PrefixEdge{value, mask, child});
+            m_prefix.emplace_back();
+            node = child;
+        }
+        m_prefix[node].rules.push_back(r);
+    }
+
+    // Имена карт PC/SC Part 3
+    m_pcscCards.clear();
+    for (uint32_t r = 0; r < m_rules.size(); ++r) {
+        const Rule &rule = m_rules[r];
+        if (rule.kind != Kind::PcscCard) continue;
+        m_pcscCards[static_cast<uint16_t>((rule.pattern.value[0] << 8) | rule.pattern.value[1])].push_back(r);
+    }
+
+    // Автомат Ахо-Корасик для исторических байтов
+    std::vector<std::array<int32_t, 256>> go(1);
+    std::vector<std::vector<uint32_t>> out(1);
+    go[0].fill(-1);
+    for (uint32_t r = 0; r < m_rules.size(); ++r) {
+        const Rule &rule = m_rules[r];
+        if (rule.kind != Kind::Historical) continue;
+
+        int32_t state = 0;
+        for (uint8_t i = 0; i < rule.pattern.length; ++i) {
+            const uint8_t b = rule.pattern.value[i];
+            if (go[state][b] < 0) {
+                go[state][b] = static_cast<int32_t>(go.size());
+                go.emplace_back().fill(-1);
+                out.emplace_back();
+            }
+            state = go[state][b];
+        }
+        out[state].push_back(r);
+    }
+
+    std::vector<int32_t> fail(go.size(), 0);
+    std::vector<int32_t> queue;
+    queue.reserve(go.size());
+    for (int b = 0; b < 256; ++b) {
+        if (go[0][b] < 0) {
+            go[0][b] = 0;
+        } else {
+            queue.push_back(go[0][b]);
+        }
+    }
+    for (std::size_t q = 0; q < queue.size(); ++q) {
+        const int32_t s = queue[q];
+        for (int b = 0; b < 256; ++b) {
+            const int32_t t = go[s][b];
+            if (t < 0) {
+                go[s][b] = go[fail[s]][b];
+                continue;
+            }
+            fail[t] = go[fail[s]][b];
+            out[t].insert(out[t].end(), out[fail[t]].begin(), out[fail[t]].end());
+            queue.push_back(t);
+        }
+    }
+
+    m_delta.resize(go.size() * 256);
+    m_outputStart.assign(1, 0);
+    m_outputs.clear();
+    for (std::size_t s = 0; s < go.size(); ++s) {
+        std::copy(go[s].begin(), go[s].end(), m_delta.begin() + static_cast<std::ptrdiff_t>(s * 256));
+        std::sort(out[s].begin(), out[s].end());
+        m_outputs.insert(m_outputs.end(), out[s].begin(), out[s].end());
+        m_outputStart.push_back(static_cast<uint32_t>(m_outputs.size()));
+    }
+}
+
+bool RuleSet::conditionsHold(const Rule &rule, const Atr &atr) const
+{
+    return (atr.protocolMask & rule.protocols) == rule.protocols &&
+           atr.length >= rule.minLength &&
+           atr.historicalLength >= rule.minHistorical;
+}
+
+void RuleSet::matchPrefix(uint32_t node, const Atr &atr, std::size_t pos, uint32_t &best) const
+{
+    const PrefixNode &n = m_prefix[node];
+    for (uint32_t r : n.rules) {
+        if (r >= best) break;
+        if (conditionsHold(m_rules[r], atr)) {
+            best = r;
+            break;
+        }
+    }
+    if (pos >= atr.length) return;
+
+    const uint8_t b = atr.raw[pos];
+    for (const PrefixEdge &e : n.edges) {
+        if ((b & e.mask) == e.value) matchPrefix(e.child, atr, pos + 1, best);
+    }
+}
+
+const RuleSet::Rule *RuleSet::match(const Atr &atr) const
+{
+    uint32_t best = kNoRule;
+    if (!m_prefix.empty()) matchPrefix(0, atr, 0, best);
+
+    // Имя карты PC/SC Part 3: исторические байты декодируются только здесь
+    PcscCardInfo card;
+    if (!m_pcscCards.empty() && HistoricalBytes(atr.historical()).pcscCard(card)) {
+        const auto it = m_pcscCards.find(card.cardName);
+        if (it != m_pcscCards.end()) {
+            for (uint32_t r : it->second) {
+                if (r >= best) break;
+                if (conditionsHold(m_rules[r], atr)) {
+                    best = r;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Один проход автомата по историческим байтам
+    if (!m_outputs.empty()) {
+        const uint8_t *hb = atr.historicalBytes();
+        const std::size_t n = atr.historicalLength;
+        uint32_t state = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            state = m_delta[state * 256 + hb[i]];
+            for (uint32_t k = m_outputStart[state]; k < m_outputStart[state + 1]; ++k) {
+                const uint32_t r = m_outputs[k];
+                if (r >= best) break;
+                const Rule &rule = m_rules[r];
+                if (i + 1 + rule.minTrailing <= n && conditionsHold(rule, atr)) {
+                    best = r;
+                    break;
+                }
+            }
+        }
+    }
+
+    return best == kNoRule ? nullptr : &m_rules[best];
+}
+
+Identification identify(const Atr &a, const RuleSet &rules)
+{
+    const FallbackStrings &fallback = fallbackStrings();
+    Identification id{CardType::Unknown, "Неизвестная карта", nullptr, fallback.unknown};
+
+    if (const RuleSet::Rule *rule = rules.match(a)) {
+        id.type = rule->type;
+        id.name = rule->name.c_str();
+        id.nameId = rule->nameId;
+        if (!rule->manufacturer.empty()) {
+            id.manufacturer = rule->manufacturer.c_str();
+            id.manufacturerId = rule->manufacturerId;
+        }
+    }
+    // Общие типы ISO
+    else if (a.ts == 0x3B) {
+        id = {CardType::ISO14443A, "ISO 14443-A карта", nullptr, fallback.iso14443a};
+    } else if (a.ts == 0x3F) {
+        id = {CardType::ISO14443B, "ISO 14443-B карта", nullptr, fallback.iso14443b};
+    }
+
+    if (!id.manufacturer) {
+        setDetectedManufacturer(id, a);
+    }
+    return id;
+}
+
+Identification identify(const Atr &a, const CardDatabase &db, const RuleSet &rules)
+{
+    const CardDatabase::Entry *known = db.lookup(a);
+    if (!known) return identify(a, rules);
+
+    if (known->type == CardType::Unknown) {
+        Identification id = identify(a, rules);
+        id.name = known->name.c_str();
+        id.nameId = known->nameId;
+        return id;
+    }
+    Identification id{known->type, known->name.c_str(), nullptr, known->nameId};
+    setDetectedManufacturer(id, a);
+    return id;
+}
+
+} // namespace atr
@@ -0,0 +1,122 @@
+#ifndef ATRRULES_H
+#define ATRRULES_H
+
+// Декларативные правила определения типа карты без зависимостей от Qt.
+// Правило — это либо шаблон начала ATR (значение/маска по полубайтам),
+// либо подпоследовательность исторических байтов, либо имя карты PC/SC
+// Part 3 из декодированных исторических байтов (atrhistorical.h), плюс
+// необязательные условия (протоколы, минимальные длины). При нескольких
+// совпадениях побеждает правило, объявленное раньше.
+// Шаблоны ATR собираются в префиксное дерево, подпоследовательности — в
+// автомат Ахо-Корасик, имена PC/SC — в хэш-таблицу. Автомат проходит
+// исторические байты один раз, но в дереве на каждом узле проверяются все
+// рёбра с масками, а на каждом совпадении — условия правил, объявленных
+// раньше текущего лучшего. Поэтому стоимость растёт с числом пересекающихся
+// шаблонов с масками и совпавших правил с невыполненными условиями.
+//
+// Формат файла правил (одно правило на строку, поля через '|'):
+//   вид | тип | имя | производитель | шаблон | условия
+//   atr  | Mifare_DESFire | Mifare DESFire | | 3B 81 80 |
+//   hist | BankCard_EMV | Банковская карта (EMV) | Visa | A0 00 00 00 03 | protocols=1
+//   any  | BankCard_EMV | Банковская карта (EMV) | | | protocols=1 minlen=13
+//   pcsc | Mifare_Ultralight | Mifare Ultralight | NXP | 00 03 |
+// Условия: protocols=1,15 (все перечисленные T=N), minlen=N (длина ATR),
+// minhist=N (число исторических байтов), tail=N (байтов после совпадения).
+// Строки, начинающиеся с '#', и пустые строки игнорируются.
+
+#include "atrcore.h"
+#include "atrdatabase.h"
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace atr {
+
+class RuleSet
+{
+public:
+    enum class Kind : uint8_t {
+        Atr,          // шаблон с начала ATR
+        Historical,   // подпоследовательность исторических байтов
+        Any,          // только условия
+        PcscCard      // имя карты PC/SC Part 3 (NN NN), шаблон из двух байтов
+    };
+
+    struct Rule {
+        Kind kind;
+        CardType type;
+        std::string name;           // UTF-8
+        std::string manufacturer;   // пусто — определяется по category indicator
+        uint16_t nameId;            // строки в таблице atrstrings.h, интернируются при загрузке
+        uint16_t manufacturerId;
+        AtrPattern pattern;         // Kind::Atr, Kind::Historical и Kind::PcscCard (маска 0xFF)
+        uint16_t protocols;         // требуемые протоколы: бит N — T=N
+        uint8_t minLength;
+        uint8_t minHistorical;
+        uint8_t minTrailing;
+    };
+
+    // Встроенные правила (эвристики Mifare/EMV), компилируются один раз за процесс
+    static const RuleSet &builtin();
+
+    // Добавляет правила из текста и перекомпилирует автоматы.
+    // При ошибке формата возвращает false и описание в error;
+    // правила до ошибочной строки остаются добавленными.
+    bool load(std::istream &in, std::string *error = nullptr);
+    bool load(const std::string &path, std::string *error = nullptr);
+    bool loadText(std::string_view text, std::string *error = nullptr);
+
+    // Первое по порядку объявления правило, которому соответствует ATR
+    const Rule *match(const Atr &atr) const;
+
+    std::size_t size() const { return m_rules.size(); }
+    const Rule &rule(std::size_t i) const { return m_rules[i]; }
+
+    static bool cardTypeFromName(std::string_view name, CardType &out);
+
+private:
+    static constexpr uint32_t kNoRule = UINT32_MAX;
+
+    bool parseLine(std::string_view line, std::string *error);
+    void compile();
+    bool conditionsHold(const Rule &rule, const Atr &atr) const;
+    void matchPrefix(uint32_t node, const Atr &atr, std::size_t pos, uint32_t &best) const;
+
+    std::vector<Rule> m_rules;
+
+    // Префиксное дерево для Kind::Atr и Kind::Any (корень)
+    struct PrefixEdge {
+        uint8_t value;
+        uint8_t mask;
+        uint32_t child;
+    };
+    struct PrefixNode {
+        std::vector<PrefixEdge> edges;
+        std::vector<uint32_t> rules;
+    };
+    std::vector<PrefixNode> m_prefix;
+
+    // Автомат Ахо-Корасик для Kind::Historical: полная таблица переходов
+    // (256 на состояние) и списки правил, заканчивающихся в состоянии
+    std::vector<uint32_t> m_delta;
+    std::vector<uint32_t> m_outputStart;    // size = states + 1
+    std::vector<uint32_t> m_outputs;
+
+    // Kind::PcscCard: имя карты -> правила в порядке объявления
+    std::unordered_map<uint16_t, std::vector<uint32_t>> m_pcscCards;
+};
+
+// Определение типа карты по правилам; если ни одно не подошло —
+// ISO 14443-A/B по TS. Строки результата живут, пока жив RuleSet.
+Identification identify(const Atr &a, const RuleSet &rules = RuleSet::builtin());
+
+// База известных ATR, затем правила
+Identification identify(const Atr &a, const CardDatabase &db,
+                        const RuleSet &rules = RuleSet::builtin());
+
+} // namespace atr
+
+#endif // ATRRULES_H
@@ -0,0 +1,51 @@
+#include "atrstrings.h"
+
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace atr {
+
+namespace {
+
+struct Table {
+    std::mutex lock;
+    // deque не перемещает элементы при добавлении: ключи ids указывают в strings
+    std::deque<std::string> strings{std::string()};
+    std::unordered_map<std::string_view, StringId> ids;
+};
+
+Table &table()
+{
+    static Table t;
+    return t;
+}
+
+} // namespace
+
+StringId internString(std::string_view utf8)
+{
+    if (utf8.empty()) return 0;
+
+    Table &t = table();
+    std::lock_guard<std::mutex> lock(t.lock);
+    const auto it = t.ids.find(utf8);
+    if (it != t.ids.end()) return it->second;
+
+    if (t.strings.size() > std::numeric_limits<StringId>::max()) return 0;
+    const StringId id = static_cast<StringId>(t.strings.size());
+    const std::string &stored = t.strings.emplace_back(utf8);
+    t.ids.emplace(stored, id);
+    return id;
+}
+
+std::string_view internedString(StringId id)
+{
+    Table &t = table();
+    std::lock_guard<std::mutex> lock(t.lock);
+    return id < t.strings.size() ? std::string_view(t.strings[id]) : std::string_view();
+}
+
+} // namespace atr
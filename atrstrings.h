@@ -0,0 +1,29 @@
+#ifndef ATRSTRINGS_H
+#define ATRSTRINGS_H
+
+// Интернированные строки UTF-8 (названия карт, производители) без
+// зависимостей от Qt. Строки интернируются один раз — при заполнении
+// CardDatabase и загрузке RuleSet; определение типа карты только копирует
+// 16-битные идентификаторы и не трогает таблицу. Таблица общая для
+// процесса и только растёт: идентификаторы действительны в любом потоке.
+// Идентификатор 0 — пустая строка.
+
+#include <cstdint>
+#include <string_view>
+
+namespace atr {
+
+using StringId = uint16_t;
+
+// Идентификатор строки (пустая строка -> 0). Берёт мьютекс — вызывается
+// при построении баз и правил, а не при разборе. При переполнении
+// таблицы возвращает 0.
+StringId internString(std::string_view utf8);
+
+// Строка по идентификатору; неизвестный идентификатор — пустая строка.
+// Данные строки живут до конца процесса.
+std::string_view internedString(StringId id);
+
+} // namespace atr
+
+#endif // ATRSTRINGS_H
@@ -0,0 +1,27 @@
+#include "atrstringtable.h"
+#include "atrstrings.h"
+
+ATRStringTable &ATRStringTable::instance()
+{
+    static ATRStringTable table;
+    return table;
+}
+
+QString ATRStringTable::string(uint16_t id) const
+{
+    if (id == 0) return QString();
+    {
+        QReadLocker lock(&m_lock);
+        if (id < m_strings.size() && !m_strings.at(id).isNull()) return m_strings.at(id);
+    }
+
+    const std::string_view utf8 = atr::internedString(id);
+    if (utf8.empty()) return QString();
+
+    QWriteLocker lock(&m_lock);
+    if (id >= m_strings.size()) m_strings.resize(id + 1);
+    if (m_strings.at(id).isNull()) {
+        m_strings[id] = QString::fromUtf8(utf8.data(), static_cast<int>(utf8.size()));
+    }
+    return m_strings.at(id);
+}
@@ -0,0 +1,32 @@
+#ifndef ATRSTRINGTABLE_H
+#define ATRSTRINGTABLE_H
+
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+#include <cstdint>
+
+// QString-представление таблицы интернированных строк (atrstrings.h) для
+// ATRData: название карты и производитель хранятся в записи 16-битными
+// идентификаторами, поэтому она остаётся тривиально копируемой. Сами
+// строки интернируются при построении CardDatabase и RuleSet; здесь они
+// один раз переводятся в QString при первом отображении.
+class ATRStringTable
+{
+public:
+    static ATRStringTable &instance();
+
+    // Строка по идентификатору (копия QString без выделения памяти после
+    // первого обращения); неизвестный идентификатор — пустая строка
+    QString string(uint16_t id) const;
+
+private:
+    ATRStringTable() = default;
+
+    mutable QReadWriteLock m_lock;
+    // Пустой QString — строка ещё не переведена
+    mutable QVector<QString> m_strings;
+};
+
+#endif // ATRSTRINGTABLE_H
@@ -0,0 +1,185 @@
+#ifndef ATRTABLES_H
+#define ATRTABLES_H
+
+// Таблицы интерпретации байтов ATR/ATS, вычисляемые при компиляции.
+// На каждый возможный байт — готовая запись, так что декодирование в
+// atrcore.h сводится к загрузке из таблицы без ветвлений и делений.
+// Источники: ISO/IEC 7816-3 (таблицы 7, 8; T=1 — раздел 11.4),
+// ISO/IEC 14443-4 (5.2.4 - 5.2.6).
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace atr {
+namespace tables {
+
+// Типичные частоты CLK ридеров, для которых заранее посчитана скорость
+inline constexpr uint32_t kClocksHz[] = {3571200, 3750000, 4000000, 4800000};
+inline constexpr std::size_t kClockCount = sizeof(kClocksHz) / sizeof(kClocksHz[0]);
+// Частота для Atr::baudRate (исторически 3.75 МГц)
+inline constexpr std::size_t kDefaultClock = 1;
+
+// ISO 7816-3, таблицы 7 и 8: Fi, f(max) (в сотнях кГц), Di; 0 — RFU
+inline constexpr uint16_t kFi[16] = {372, 372, 558, 744, 1116, 1488, 1860, 0, 0, 512, 768, 1024, 1536, 2048, 0, 0};
+inline constexpr uint8_t kFmax[16] = {40, 50, 60, 80, 120, 160, 200, 0, 0, 50, 75, 100, 150, 200, 0, 0};
+inline constexpr uint8_t kDi[16] = {0, 1, 2, 4, 8, 16, 32, 64, 12, 20, 0, 0, 0, 0, 0, 0};
+
+// TA1: FI/DI. Для RFU-кодов берутся значения по умолчанию (372 / 1).
+struct Ta1 {
+    uint16_t fi;
+    uint8_t di;
+    uint8_t fmax;                // f(max), сотни кГц (0 — RFU)
+    bool valid;                  // оба кода определены стандартом
+    uint32_t baud[kClockCount];  // f * Di / Fi для kClocksHz
+};
+
+// TB1 (устаревший): значения VPP/IPP в том виде, в каком их показывает вывод
+struct Tb1 {
+    uint8_t programmingVoltage;  // b8-b6
+    uint8_t programmingCurrent;  // b5-b1
+};
+
+// TC1: extra guard time N; N = 255 — минимальный guard time
+struct Tc1 {
+    uint8_t n;
+    uint16_t guardEtuT0;         // 12 + N, для N = 255 — 12
+    uint16_t guardEtuT1;         // 12 + N, для N = 255 — 11
+};
+
+// TC2 (T=0): WI; 0 — RFU, используется значение по умолчанию 10
+struct Tc2 {
+    uint8_t wi;
+    bool valid;
+};
+
+// TAi (T=1, i > 2): IFSC; 0x00 и 0xFF — RFU, по умолчанию 32
+struct T1Ta {
+    uint8_t ifsc;
+    bool valid;
+};
+
+// TBi (T=1, i > 2): BWI (b8-b5, A..F — RFU, по умолчанию 4), CWI (b4-b1)
+struct T1Tb {
+    uint8_t bwi;
+    uint8_t cwi;
+    bool valid;
+    uint16_t cwtEtu;             // CWT = 11 + 2^CWI etu
+};
+
+// TCi (T=1, i > 2): код контроля ошибок (b1: 0 — LRC, 1 — CRC)
+struct T1Tc {
+    bool crc;
+    bool valid;                  // b8-b2 == 0
+};
+
+// ATS TA(1): поддерживаемые делители DS (PICC -> PCD) и DR (PCD -> PICC)
+struct AtsTa {
+    bool sameBitRate;            // b8: только одинаковые в обе стороны
+    uint8_t dsMask;              // b7-b5: 1 — 212, 2 — 424, 4 — 848 кбит/с
+    uint8_t drMask;              // b3-b1
+    bool valid;                  // b4 == 0
+};
+
+// ATS TB(1): FWI/SFGI; 15 — RFU (FWI по умолчанию 4, SFGI — 0)
+struct AtsTb {
+    int8_t fwi;                  // как в байте (для вывода)
+    int8_t sfgi;
+    uint32_t fwtUs;              // FWT = 256 * 16 / fc * 2^FWI
+    uint32_t sfgtUs;             // SFGT = 256 * 16 / fc * 2^SFGI (0, если SFGI = 0)
+};
+
+// ATS TC(1): поддержка CID (b2) и NAD (b1)
+struct AtsTc {
+    bool supportsCID;
+    bool supportsNAD;
+};
+
+namespace detail {
+
+// fc = 13.56 МГц: 4096 / fc * 2^n в микросекундах с округлением
+constexpr uint32_t atsTimeUs(unsigned n)
+{
+    return static_cast<uint32_t>(((4096ull << n) * 1000000ull + 6780000ull) / 13560000ull);
+}
+
+template<typename Entry, typename F>
+constexpr std::array<Entry, 256> build(F make)
+{
+    std::array<Entry, 256> table{};
+    for (unsigned b = 0; b < 256; ++b) table[b] = make(static_cast<uint8_t>(b));
+    return table;
+}
+
+} // namespace detail
+
+inline constexpr std::array<Ta1, 256> kTa1 = detail::build<Ta1>([](uint8_t b) {
+    const uint16_t fiCode = kFi[b >> 4];
+    const uint8_t diCode = kDi[b & 0x0F];
+    Ta1 e{};
+    e.fi = fiCode ? fiCode : 372;
+    e.di = diCode ? diCode : 1;
+    e.fmax = kFmax[b >> 4];
+    e.valid = fiCode && diCode;
+    for (std::size_t c = 0; c < kClockCount; ++c) {
+        e.baud[c] = static_cast<uint32_t>((uint64_t(kClocksHz[c]) * e.di) / e.fi);
+    }
+    return e;
+});
+
+inline constexpr std::array<Tb1, 256> kTb1 = detail::build<Tb1>([](uint8_t b) {
+    return Tb1{static_cast<uint8_t>((b >> 5) & 0x07), static_cast<uint8_t>(b & 0x1F)};
+});
+
+inline constexpr std::array<Tc1, 256> kTc1 = detail::build<Tc1>([](uint8_t b) {
+    return b == 0xFF ? Tc1{b, 12, 11}
+                     : Tc1{b, static_cast<uint16_t>(12 + b), static_cast<uint16_t>(12 + b)};
+});
+
+inline constexpr std::array<Tc2, 256> kTc2 = detail::build<Tc2>([](uint8_t b) {
+    return b ? Tc2{b, true} : Tc2{10, false};
+});
+
+inline constexpr std::array<T1Ta, 256> kT1Ta = detail::build<T1Ta>([](uint8_t b) {
+    return (b == 0x00 || b == 0xFF) ? T1Ta{32, false} : T1Ta{b, true};
+});
+
+inline constexpr std::array<T1Tb, 256> kT1Tb = detail::build<T1Tb>([](uint8_t b) {
+    const uint8_t bwi = b >> 4;
+    const uint8_t cwi = b & 0x0F;
+    return T1Tb{static_cast<uint8_t>(bwi <= 9 ? bwi : 4), cwi, bwi <= 9,
+                static_cast<uint16_t>(11 + (1u << cwi))};
+});
+
+inline constexpr std::array<T1Tc, 256> kT1Tc = detail::build<T1Tc>([](uint8_t b) {
+    return T1Tc{(b & 0x01) != 0, (b & 0xFE) == 0};
+});
+
+inline constexpr std::array<AtsTa, 256> kAtsTa = detail::build<AtsTa>([](uint8_t b) {
+    return AtsTa{(b & 0x80) != 0, static_cast<uint8_t>((b >> 4) & 0x07),
+                 static_cast<uint8_t>(b & 0x07), (b & 0x08) == 0};
+});
+
+inline constexpr std::array<AtsTb, 256> kAtsTb = detail::build<AtsTb>([](uint8_t b) {
+    const uint8_t fwi = b >> 4;
+    const uint8_t sfgi = b & 0x0F;
+    return AtsTb{static_cast<int8_t>(fwi), static_cast<int8_t>(sfgi),
+                 detail::atsTimeUs(fwi < 15 ? fwi : 4),
+                 sfgi == 0 || sfgi == 15 ? 0u : detail::atsTimeUs(sfgi)};
+});
+
+inline constexpr std::array<AtsTc, 256> kAtsTc = detail::build<AtsTc>([](uint8_t b) {
+    return AtsTc{(b & 0x02) != 0, (b & 0x01) != 0};
+});
+
+// Контрольные значения
+static_assert(kTa1[0x11].fi == 372 && kTa1[0x11].di == 1 && kTa1[0x11].baud[kDefaultClock] == 10080);
+static_assert(kTa1[0x96].fi == 512 && kTa1[0x96].di == 32 && kTa1[0x96].valid);
+static_assert(kTa1[0x70].fi == 372 && kTa1[0x70].di == 1 && !kTa1[0x70].valid);
+static_assert(kT1Tb[0x45].bwi == 4 && kT1Tb[0x45].cwtEtu == 43);
+static_assert(kAtsTb[0x81].fwtUs == 77329 && kAtsTb[0x81].sfgtUs == 604);
+
+} // namespace tables
+} // namespace atr
+
+#endif // ATRTABLES_H
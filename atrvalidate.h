@@ -0,0 +1,211 @@
+#ifndef ATRVALIDATE_H
+#define ATRVALIDATE_H
+
+// Строгая проверка ATR на соответствие ISO/IEC 7816-3 без зависимостей от Qt.
+// atr::decode() терпим к ошибкам (обрыв исторических байтов, лишние байты,
+// неверный TCK дают флаги, а не отказ); validate() перечисляет все
+// нарушения с позицией байта. Результат — запись фиксированного размера
+// без выделения памяти, так что шлюз может отбраковывать ATR плохих
+// ридеров до дорогой установки сессии.
+
+#include "atrcore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace atr {
+
+enum class Issue : uint8_t {
+    // Ошибки структуры
+    TooShort,              // меньше двух байт; offset — длина
+    TooLong,               // больше 33 байт; offset — первый лишний байт
+    InvalidTS,             // TS не 3B/3F
+    TruncatedInterface,    // цепочка TA/TB/TC/TD обрывается; offset — длина
+    TruncatedHistorical,   // байтов меньше, чем заявлено в T0; offset — длина
+    MissingTck,            // заявлен протокол кроме T=0, а TCK нет; offset — длина
+    UnexpectedTck,         // только T=0, но после исторических байтов есть байт
+    TckMismatch,           // XOR T0..TCK != 0; offset — TCK
+    TrailingBytes,         // байты после TCK / исторических; offset — первый лишний
+    // Зарезервированные значения и несогласованность
+    ReservedTa1,           // RFU-код Fi или Di
+    ReservedTa2,           // TA2: b7-b6 не нули
+    Ta2ProtocolNotOffered, // TA2 (specific mode) указывает протокол, которого нет в TD
+    ReservedTc2,           // TC2 = 0 (WI RFU)
+    T15InTd1,              // TD1 не может указывать T=15
+    ProtocolOrder,         // протоколы в TDi не по возрастанию
+    ReservedProtocol,      // T=2..13 (RFU)
+    ReservedIfsc,          // T=1 TA: IFSC 00 или FF
+    ReservedBwi,           // T=1 TB: BWI больше 9
+    ReservedEdc            // T=1 TC: b8-b2 не нули
+};
+
+enum class Severity : uint8_t {
+    Warning,
+    Error
+};
+
+// Ошибки — нарушения структуры, из-за которых ATR нельзя принять как есть;
+// предупреждения — RFU-значения и несогласованность параметров
+inline Severity severity(Issue issue)
+{
+    return issue <= Issue::TrailingBytes ? Severity::Error : Severity::Warning;
+}
+
+// Идентификатор для машиночитаемого вывода
+inline const char *issueId(Issue issue)
+{
+    switch (issue) {
+        case Issue::TooShort: return "too_short";
+        case Issue::TooLong: return "too_long";
+        case Issue::InvalidTS: return "invalid_ts";
+        case Issue::TruncatedInterface: return "truncated_interface";
+        case Issue::TruncatedHistorical: return "truncated_historical";
+        case Issue::MissingTck: return "missing_tck";
+        case Issue::UnexpectedTck: return "unexpected_tck";
+        case Issue::TckMismatch: return "tck_mismatch";
+        case Issue::TrailingBytes: return "trailing_bytes";
+        case Issue::ReservedTa1: return "reserved_ta1";
+        case Issue::ReservedTa2: return "reserved_ta2";
+        case Issue::Ta2ProtocolNotOffered: return "ta2_protocol_not_offered";
+        case Issue::ReservedTc2: return "reserved_tc2";
+        case Issue::T15InTd1: return "t15_in_td1";
+        case Issue::ProtocolOrder: return "protocol_order";
+        case Issue::ReservedProtocol: return "reserved_protocol";
+        case Issue::ReservedIfsc: return "reserved_ifsc";
+        case Issue::ReservedBwi: return "reserved_bwi";
+        case Issue::ReservedEdc: return "reserved_edc";
+    }
+    return "unknown";
+}
+
+struct Diagnostic {
+    Issue issue;
+    uint8_t offset;            // индекс байта во входе
+};
+
+// Список нарушений в порядке байтов; 32 байта
+struct Diagnostics {
+    static constexpr std::size_t kCapacity = 15;
+
+    uint8_t count = 0;
+    bool overflow = false;     // нарушений больше kCapacity, лишние отброшены
+    Diagnostic items[kCapacity] = {};
+
+    const Diagnostic *begin() const { return items; }
+    const Diagnostic *end() const { return items + count; }
+    bool empty() const { return count == 0; }
+
+    bool hasErrors() const { return firstError() != nullptr; }
+    const Diagnostic *firstError() const
+    {
+        for (const Diagnostic &d : *this) {
+            if (severity(d.issue) == Severity::Error) return &d;
+        }
+        return nullptr;
+    }
+
+    void add(Issue issue, std::size_t offset)
+    {
+        if (count == kCapacity) {
+            overflow = true;
+            return;
+        }
+        items[count++] = Diagnostic{issue, static_cast<uint8_t>(offset < 0xFF ? offset : 0xFF)};
+    }
+};
+
+// Проверка ATR по ISO/IEC 7816-3 (8.1 - 8.3, 11.4). Перечисляет все
+// нарушения, кроме тех, после которых разбор дальше невозможен (длина,
+// обрыв цепочки interface bytes).
+inline Diagnostics validate(std::span<const uint8_t> in)
+{
+    Diagnostics out;
+    const std::size_t n = in.size();
+    if (n < 2) {
+        out.add(Issue::TooShort, n);
+        return out;
+    }
+    if (n > kMaxAtrLength) {
+        out.add(Issue::TooLong, kMaxAtrLength);
+        return out;
+    }
+    if (in[0] != 0x3B && in[0] != 0x3F) out.add(Issue::InvalidTS, 0);
+
+    std::size_t idx = 2;
+    uint8_t y = in[1];
+    unsigned group = 0;              // 0 — TA1..TD1
+    uint8_t groupProtocol = 0xFF;    // протокол из TD, открывшего группу
+    int lastProtocol = -1;
+    uint16_t protocolMask = 0;
+    std::size_t ta2Offset = 0;
+    for (;;) {
+        for (const InterfaceBit bit : {TA, TB, TC}) {
+            if (!(y & bit)) continue;
+            if (idx >= n) {
+                out.add(Issue::TruncatedInterface, n);
+                return out;
+            }
+            const uint8_t v = in[idx];
+            if (group == 0 && bit == TA && !tables::kTa1[v].valid) {
+                out.add(Issue::ReservedTa1, idx);
+            } else if (group == 1 && bit == TA) {
+                ta2Offset = idx;
+                if (v & 0x60) out.add(Issue::ReservedTa2, idx);
+            } else if (group == 1 && bit == TC && v == 0) {
+                out.add(Issue::ReservedTc2, idx);
+            } else if (group >= 2 && groupProtocol == 1) {
+                if (bit == TA && !tables::kT1Ta[v].valid) out.add(Issue::ReservedIfsc, idx);
+                if (bit == TB && !tables::kT1Tb[v].valid) out.add(Issue::ReservedBwi, idx);
+                if (bit == TC && !tables::kT1Tc[v].valid) out.add(Issue::ReservedEdc, idx);
+            }
+            ++idx;
+        }
+        if (!(y & TD)) break;
+        if (idx >= n) {
+            out.add(Issue::TruncatedInterface, n);
+            return out;
+        }
+        y = in[idx];
+        const uint8_t protocol = y & 0x0F;
+        if (group == 0 && protocol == 15) out.add(Issue::T15InTd1, idx);
+        if (static_cast<int>(protocol) < lastProtocol) out.add(Issue::ProtocolOrder, idx);
+        if (protocol >= 2 && protocol <= 13) out.add(Issue::ReservedProtocol, idx);
+        lastProtocol = protocol > lastProtocol ? protocol : lastProtocol;
+        protocolMask |= static_cast<uint16_t>(1u << protocol);
+        groupProtocol = protocol;
+        ++idx;
+        ++group;
+    }
+
+    // TA2: specific mode, b4-b1 — протокол, который карта использует сразу
+    if (ta2Offset && !(protocolMask & (1u << (in[ta2Offset] & 0x0F)))) {
+        out.add(Issue::Ta2ProtocolNotOffered, ta2Offset);
+    }
+
+    const std::size_t historicalEnd = idx + (in[1] & 0x0F);
+    if (historicalEnd > n) {
+        out.add(Issue::TruncatedHistorical, n);
+        return out;
+    }
+
+    // TCK обязателен, если заявлен любой протокол кроме T=0 (в том числе
+    // T=15 и смесь T=0 с другими), и запрещён, если только T=0
+    if (protocolMask & ~uint16_t(1)) {
+        if (historicalEnd >= n) {
+            out.add(Issue::MissingTck, n);
+            return out;
+        }
+        uint8_t x = 0;
+        for (std::size_t i = 1; i <= historicalEnd; ++i) x ^= in[i];
+        if (x != 0) out.add(Issue::TckMismatch, historicalEnd);
+        if (historicalEnd + 1 < n) out.add(Issue::TrailingBytes, historicalEnd + 1);
+    } else if (historicalEnd < n) {
+        out.add(n - historicalEnd == 1 ? Issue::UnexpectedTck : Issue::TrailingBytes, historicalEnd);
+    }
+    return out;
+}
+
+} // namespace atr
+
+#endif // ATRVALIDATE_H
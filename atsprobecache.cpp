@@ -0,0 +1,101 @@
+#include "atsprobecache.h"
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSettings>
+
+namespace {
+
+const char kSettingsOrganization[] = "ATRParser";
+const char kSettingsApplication[] = "ATRParser";
+const char kSettingsGroup[] = "AtsProbeCache";
+
+} // namespace
+
+AtsProbeCache &AtsProbeCache::instance()
+{
+    static AtsProbeCache cache;
+    return cache;
+}
+
+AtsProbeCache::AtsProbeCache()
+{
+    load();
+}
+
+QString AtsProbeCache::readerModel(const QString &readerName)
+{
+    // pcsc-lite добавляет к имени два двузначных номера: экземпляр и слот
+    static const QRegularExpression instanceSuffix(QStringLiteral("(\\s+[0-9A-Fa-f]{2}){2}$"));
+    QString model = readerName;
+    model.remove(instanceSuffix);
+    return model.trimmed();
+}
+
+int AtsProbeCache::preferredProbe(const QString &readerName) const
+{
+    const QString model = readerModel(readerName);
+    QMutexLocker lock(&m_mutex);
+    return m_probes.value(model, -1);
+}
+
+void AtsProbeCache::recordSuccess(const QString &readerName, int probe)
+{
+    const QString model = readerModel(readerName);
+    QMutexLocker lock(&m_mutex);
+    auto it = m_probes.find(model);
+    if (it != m_probes.end() && it.value() == probe) {
+        return;
+    }
+    m_probes.insert(model, probe);
+    save();
+}
+
+void AtsProbeCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_probes.clear();
+    save();
+}
+
+void AtsProbeCache::load()
+{
+    QSettings settings(kSettingsOrganization, kSettingsApplication);
+    settings.beginGroup(kSettingsGroup);
+    // Таблица без версии — от списка с UID-командой; номера проб в ней
+    // указывают на другие APDU
+    if (settings.value("version").toInt() != kProbeListVersion) {
+        settings.endGroup();
+        return;
+    }
+    // Ключи QSettings не могут содержать '/', поэтому храним массив пар
+    const int count = settings.beginReadArray("readers");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        const QString model = settings.value("model").toString();
+        bool ok = false;
+        const int probe = settings.value("probe").toInt(&ok);
+        if (!model.isEmpty() && ok && probe >= 0) {
+            m_probes.insert(model, probe);
+        }
+    }
+    settings.endArray();
+    settings.endGroup();
+}
+
+void AtsProbeCache::save() const
+{
+    // Вызывается под m_mutex
+    QSettings settings(kSettingsOrganization, kSettingsApplication);
+    settings.beginGroup(kSettingsGroup);
+    settings.remove("");
+    settings.setValue("version", kProbeListVersion);
+    settings.beginWriteArray("readers", m_probes.size());
+    int i = 0;
+    for (auto it = m_probes.constBegin(); it != m_probes.constEnd(); ++it, ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("model", it.key());
+        settings.setValue("probe", it.value());
+    }
+    settings.endArray();
+    settings.endGroup();
+}
@@ -0,0 +1,45 @@
+#ifndef ATSPROBECACHE_H
+#define ATSPROBECACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+// Кэш «какой APDU вернул ATS» по модели ридера.
+// ReaderWorker::readATS перебирает несколько вариантов GET DATA; для
+// конкретной модели ридера работает обычно только один, поэтому он
+// запоминается и пробуется первым, а таблица сохраняется в QSettings
+// между запусками. Доступ из потоков воркеров защищён мьютексом.
+class AtsProbeCache
+{
+public:
+    // Версия списка APDU в ReaderWorker::readATS(): номер пробы имеет смысл
+    // только для неё, сохранённая таблица другой версии не загружается
+    static constexpr int kProbeListVersion = 2;
+
+    // Общий кэш процесса; при первом обращении загружается из QSettings
+    static AtsProbeCache &instance();
+
+    // Номер успешного APDU для модели ридера или -1, если ещё неизвестен
+    int preferredProbe(const QString &readerName) const;
+
+    // Запоминает успешный APDU; при изменении таблица сразу сохраняется
+    void recordSuccess(const QString &readerName, int probe);
+
+    void clear();
+
+    // Модель ридера: имя PC/SC без номеров экземпляра/слота
+    // ("ACS ACR122U PICC Interface 00 00" -> "ACS ACR122U PICC Interface")
+    static QString readerModel(const QString &readerName);
+
+private:
+    AtsProbeCache();
+
+    void load();
+    void save() const;
+
+    mutable QMutex m_mutex;
+    QHash<QString, int> m_probes;
+};
+
+#endif // ATSPROBECACHE_H
@@ -0,0 +1,608 @@
+// Пакетное декодирование ATR/ATS из файла или stdin без PC/SC.
+//
+// Формат входа: одна запись на строку, "ATR[<разделитель>ATS]", где
+// разделитель — ';', ',', '|' или табуляция; байты в hex, пробелы и ':'
+// между ними допускаются. Пустые строки и строки с '#' пропускаются.
+//
+//   atrparser_batch [--format jsonl|csv] [-o out] [-j N] [--strict]
+//                   [--smartcard-list file] [--rules file] [input|-]
+//
+// Большие файлы отображаются в память (QFile::map), делятся на блоки по
+// границам строк и декодируются параллельно (std::thread) ядром atrcore.h —
+// без Qt-объектов и выделений памяти на запись. Результаты пишутся в
+// порядке входа. С --strict ATR проверяется по ISO 7816-3 (atrvalidate.h):
+// выводится список нарушений, ATR с ошибками получает статус
+// strict_violation.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+
+#include "atrcore.h"
+#include "atrdatabase.h"
+#include "atrhistorical.h"
+#include "atrrules.h"
+#include "atrvalidate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum class OutputFormat {
+    Jsonl,
+    Csv
+};
+
+// Блок входа, обрабатываемый одним потоком
+constexpr std::size_t kChunkSize = 4u << 20;
+// ATS ограничен TL (один байт)
+constexpr std::size_t kMaxRecordBytes = 255;
+
+struct Context {
+    OutputFormat format;
+    bool strict;
+    const atr::CardDatabase *database;
+    const atr::RuleSet *rules;
+};
+
+struct Chunk {
+    std::size_t begin;
+    std::size_t end;
+    std::size_t firstLine;     // номер первой строки блока (с 1)
+    std::string output;
+};
+
+bool parseHex(std::string_view text, uint8_t *out, std::size_t &length)
+{
+    length = 0;
+    int high = -1;
+    for (const char c : text) {
+        int nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else if (c == ' ' || c == ':') {
+            if (high >= 0) return false;   // байт разорван разделителем
+            continue;
+        } else {
+            return false;
+        }
+
+        if (high < 0) {
+            high = nibble;
+        } else {
+            if (length == kMaxRecordBytes) return false;
+            out[length++] = static_cast<uint8_t>((high << 4) | nibble);
+            high = -1;
+        }
+    }
+    return high < 0;
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+void appendHex(std::string &out, const uint8_t *data, std::size_t length)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    for (std::size_t i = 0; i < length; ++i) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0x0F];
+    }
+}
+
+void appendInt(std::string &out, long long value)
+{
+    char buf[24];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+void appendJsonString(std::string &out, std::string_view s)
+{
+    out += '"';
+    for (const char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char digits[] = "0123456789abcdef";
+                    out += "\\u00";
+                    out += digits[(c >> 4) & 0x0F];
+                    out += digits[c & 0x0F];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendCsvString(std::string &out, std::string_view s)
+{
+    out += '"';
+    for (const char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// JSON: [{"issue":"...","offset":N,"severity":"error"},...]
+void appendDiagnosticsJson(std::string &out, const atr::Diagnostics &diagnostics)
+{
+    out += ",\"diagnostics\":[";
+    bool first = true;
+    for (const atr::Diagnostic &d : diagnostics) {
+        if (!first) out += ',';
+        out += "{\"issue\":\"";
+        out += atr::issueId(d.issue);
+        out += "\",\"offset\":";
+        appendInt(out, d.offset);
+        out += ",\"severity\":\"";
+        out += atr::severity(d.issue) == atr::Severity::Error ? "error" : "warning";
+        out += "\"}";
+        first = false;
+    }
+    out += ']';
+}
+
+// CSV: "issue@offset issue@offset ..."
+void appendDiagnosticsCsv(std::string &out, const atr::Diagnostics &diagnostics)
+{
+    bool first = true;
+    for (const atr::Diagnostic &d : diagnostics) {
+        if (!first) out += ' ';
+        out += atr::issueId(d.issue);
+        out += '@';
+        appendInt(out, d.offset);
+        first = false;
+    }
+}
+
+const char *tckId(const atr::Atr &a)
+{
+    if (!a.hasTck) return "none";
+    return a.tckValid ? "ok" : "bad";
+}
+
+void writeJson(std::string &out, std::size_t line, std::string_view atrText,
+               bool atrHexOk, atr::Status atrStatus, const atr::Atr &a,
+               const atr::Identification *id, const atr::Diagnostics *diagnostics,
+               bool hasAts, bool atsHexOk, atr::Status atsStatus,
+               const atr::Ats &ats, const uint8_t *atsBytes)
+{
+    out += "{\"line\":";
+    appendInt(out, static_cast<long long>(line));
+
+    if (!atrHexOk) {
+        out += ",\"input\":";
+        appendJsonString(out, atrText);
+        out += ",\"status\":\"invalid_hex\"}\n";
+        return;
+    }
+
+    out += ",\"atr\":\"";
+    appendHex(out, a.raw, a.length);
+    out += "\",\"status\":\"";
+    out += atr::statusId(atrStatus);
+    out += '"';
+    if (diagnostics) appendDiagnosticsJson(out, *diagnostics);
+
+    if (atrStatus == atr::Status::Ok) {
+        out += ",\"protocols\":[";
+        bool first = true;
+        for (uint8_t p = 0; p < 16; ++p) {
+            if (!a.supportsProtocol(p)) continue;
+            if (!first) out += ',';
+            appendInt(out, p);
+            first = false;
+        }
+        out += "],\"historical\":\"";
+        appendHex(out, a.historicalBytes(), a.historicalLength);
+        out += '"';
+        // Декодированные исторические байты — только если объекты есть
+        const atr::HistoricalBytes historical(a.historical());
+        const std::span<const uint8_t> capabilities = historical.object(atr::HistoricalTag::CardCapabilities);
+        if (!capabilities.empty()) {
+            out += ",\"capabilities\":\"";
+            appendHex(out, capabilities.data(), capabilities.size());
+            out += '"';
+        }
+        atr::PcscCardInfo pcsc;
+        if (historical.pcscCard(pcsc)) {
+            out += ",\"pcsc_card\":\"";
+            const uint8_t name[] = {static_cast<uint8_t>(pcsc.cardName >> 8), static_cast<uint8_t>(pcsc.cardName)};
+            appendHex(out, name, sizeof(name));
+            out += '"';
+        }
+        out += ",\"tck\":\"";
+        out += tckId(a);
+        out += "\",\"baud\":";
+        appendInt(out, a.baudRate);
+        out += ",\"type\":\"";
+        out += atr::cardTypeId(id->type);
+        out += "\",\"name\":";
+        appendJsonString(out, id->name);
+        out += ",\"manufacturer\":";
+        appendJsonString(out, id->manufacturer);
+    }
+
+    if (hasAts) {
+        out += ",\"ats\":{\"status\":\"";
+        if (!atsHexOk) {
+            out += "invalid_hex\"}";
+        } else {
+            out += atr::statusId(atsStatus);
+            out += '"';
+            if (atsStatus == atr::Status::Ok) {
+                out += ",\"raw\":\"";
+                appendHex(out, atsBytes, ats.length);
+                out += "\",\"fsc\":";
+                appendInt(out, ats.fsc);
+                out += ",\"fwi\":";
+                appendInt(out, ats.fwi);
+                out += ",\"sfgi\":";
+                appendInt(out, ats.sfgi);
+                out += ",\"cid\":";
+                out += ats.supportsCID ? "true" : "false";
+                out += ",\"nad\":";
+                out += ats.supportsNAD ? "true" : "false";
+                out += ",\"historical\":\"";
+                appendHex(out, atsBytes + ats.historicalOffset, ats.historicalLength);
+                out += '"';
+            }
+            out += '}';
+        }
+    }
+    out += "}\n";
+}
+
+void writeCsv(std::string &out, std::size_t line, std::string_view atrText,
+              bool atrHexOk, atr::Status atrStatus, const atr::Atr &a,
+              const atr::Identification *id, const atr::Diagnostics *diagnostics,
+              bool hasAts, bool atsHexOk, atr::Status atsStatus,
+              const atr::Ats &ats, const uint8_t *atsBytes)
+{
+    appendInt(out, static_cast<long long>(line));
+    out += ',';
+    if (!atrHexOk) {
+        appendCsvString(out, atrText);
+        out += ",invalid_hex,,,,,,,,,,,,,";
+        out += diagnostics ? ",\n" : "\n";
+        return;
+    }
+
+    appendHex(out, a.raw, a.length);
+    out += ',';
+    out += atr::statusId(atrStatus);
+    out += ',';
+    if (atrStatus == atr::Status::Ok) {
+        bool first = true;
+        for (uint8_t p = 0; p < 16; ++p) {
+            if (!a.supportsProtocol(p)) continue;
+            if (!first) out += ' ';
+            appendInt(out, p);
+            first = false;
+        }
+        out += ',';
+        appendHex(out, a.historicalBytes(), a.historicalLength);
+        out += ',';
+        out += tckId(a);
+        out += ',';
+        appendInt(out, a.baudRate);
+        out += ',';
+        out += atr::cardTypeId(id->type);
+        out += ',';
+        appendCsvString(out, id->name);
+        out += ',';
+        appendCsvString(out, id->manufacturer);
+    } else {
+        out += ",,,,,,";
+    }
+
+    out += ',';
+    if (hasAts) {
+        if (!atsHexOk) {
+            out += "invalid_hex,,,,,";
+        } else {
+            out += atr::statusId(atsStatus);
+            if (atsStatus == atr::Status::Ok) {
+                out += ',';
+                appendHex(out, atsBytes, ats.length);
+                out += ',';
+                appendInt(out, ats.fsc);
+                out += ',';
+                appendInt(out, ats.fwi);
+                out += ',';
+                appendInt(out, ats.sfgi);
+                out += ',';
+                appendHex(out, atsBytes + ats.historicalOffset, ats.historicalLength);
+            } else {
+                out += ",,,,,";
+            }
+        }
+    } else {
+        out += ",,,,,";
+    }
+    if (diagnostics) {
+        out += ',';
+        appendDiagnosticsCsv(out, *diagnostics);
+    }
+    out += '\n';
+}
+
+const char kCsvHeader[] =
+    "line,atr,status,protocols,historical,tck,baud,type,name,manufacturer,"
+    "ats_status,ats,ats_fsc,ats_fwi,ats_sfgi,ats_historical";
+
+void processRecord(const Context &ctx, std::string_view record, std::size_t line, std::string &out)
+{
+    // ATR и необязательный ATS
+    std::string_view atrText = record;
+    std::string_view atsText;
+    const std::size_t sep = record.find_first_of(";,|\t");
+    const bool hasAts = sep != std::string_view::npos;
+    if (hasAts) {
+        atrText = trim(record.substr(0, sep));
+        atsText = trim(record.substr(sep + 1));
+    }
+
+    uint8_t atrBytes[kMaxRecordBytes];
+    std::size_t atrLength = 0;
+    const bool atrHexOk = parseHex(atrText, atrBytes, atrLength);
+
+    atr::Atr a;
+    a.raw = atrBytes;
+    a.length = 0;
+    atr::Status atrStatus = atr::Status::TooShort;
+    atr::Identification id{CardType::Unknown, "", ""};
+    atr::Diagnostics diagnostics;
+    if (atrHexOk) {
+        atrStatus = atr::decode({atrBytes, atrLength}, a);
+        if (ctx.strict) {
+            diagnostics = atr::validate({atrBytes, atrLength});
+            if (atrStatus == atr::Status::Ok && diagnostics.hasErrors()) atrStatus = atr::Status::StrictViolation;
+        }
+        if (atrStatus == atr::Status::Ok) {
+            id = atr::identify(a, *ctx.database, *ctx.rules);
+        } else if (a.length == 0) {
+            // decode() обнуляет длину при ошибке длины — выводим как есть
+            a.length = static_cast<uint8_t>(std::min(atrLength, atr::kMaxAtrLength));
+        }
+    }
+
+    uint8_t atsBytes[kMaxRecordBytes];
+    std::size_t atsLength = 0;
+    bool atsHexOk = false;
+    atr::Ats ats{};
+    atr::Status atsStatus = atr::Status::TooShort;
+    if (hasAts) {
+        atsHexOk = parseHex(atsText, atsBytes, atsLength);
+        if (atsHexOk) atsStatus = atr::decodeAts({atsBytes, atsLength}, ats);
+    }
+
+    // В строгом режиме колонка diagnostics есть и у строк с invalid_hex (пустая)
+    const atr::Diagnostics *diagnosticsOut = ctx.strict ? &diagnostics : nullptr;
+    if (ctx.format == OutputFormat::Jsonl) {
+        writeJson(out, line, atrText, atrHexOk, atrStatus, a, &id, diagnosticsOut,
+                  hasAts, atsHexOk, atsStatus, ats, atsBytes);
+    } else {
+        writeCsv(out, line, atrText, atrHexOk, atrStatus, a, &id, diagnosticsOut,
+                 hasAts, atsHexOk, atsStatus, ats, atsBytes);
+    }
+}
+
+void processChunk(const Context &ctx, const char *data, Chunk &chunk)
+{
+    chunk.output.clear();
+    chunk.output.reserve((chunk.end - chunk.begin) * 3);
+
+    std::size_t line = chunk.firstLine;
+    std::size_t pos = chunk.begin;
+    while (pos < chunk.end) {
+        const char *nl = static_cast<const char *>(std::memchr(data + pos, '\n', chunk.end - pos));
+        const std::size_t lineEnd = nl ? static_cast<std::size_t>(nl - data) : chunk.end;
+        const std::string_view record = trim(std::string_view(data + pos, lineEnd - pos));
+        if (!record.empty() && record.front() != '#') {
+            processRecord(ctx, record, line, chunk.output);
+        }
+        pos = lineEnd + 1;
+        ++line;
+    }
+}
+
+// Границы блоков по концам строк и номера их первых строк
+std::vector<Chunk> splitChunks(const char *data, std::size_t size)
+{
+    std::vector<Chunk> chunks;
+    std::size_t begin = 0;
+    std::size_t line = 1;
+    while (begin < size) {
+        std::size_t end = std::min(begin + kChunkSize, size);
+        if (end < size) {
+            const char *nl = static_cast<const char *>(std::memchr(data + end, '\n', size - end));
+            end = nl ? static_cast<std::size_t>(nl - data) + 1 : size;
+        }
+        chunks.push_back(Chunk{begin, end, line, {}});
+        line += static_cast<std::size_t>(std::count(data + begin, data + end, '\n'));
+        begin = end;
+    }
+    return chunks;
+}
+
+bool run(const Context &ctx, const char *data, std::size_t size, unsigned jobs, std::FILE *out)
+{
+    if (ctx.format == OutputFormat::Csv) {
+        std::fputs(kCsvHeader, out);
+        std::fputs(ctx.strict ? ",diagnostics\n" : "\n", out);
+    }
+
+    std::vector<Chunk> chunks = splitChunks(data, size);
+
+    // Волнами по несколько блоков на поток: память под вывод ограничена,
+    // запись идёт в порядке входа
+    const std::size_t wave = static_cast<std::size_t>(jobs) * 4;
+    for (std::size_t first = 0; first < chunks.size(); first += wave) {
+        const std::size_t last = std::min(first + wave, chunks.size());
+        std::atomic<std::size_t> next{first};
+
+        auto worker = [&]() {
+            for (std::size_t i = next++; i < last; i = next++) {
+                processChunk(ctx, data, chunks[i]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        const unsigned count = static_cast<unsigned>(std::min<std::size_t>(jobs, last - first));
+        for (unsigned t = 1; t < count; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+
+        for (std::size_t i = first; i < last; ++i) {
+            const std::string &text = chunks[i].output;
+            if (std::fwrite(text.data(), 1, text.size(), out) != text.size()) {
+                return false;
+            }
+            std::string().swap(chunks[i].output);
+        }
+    }
+    return std::fflush(out) == 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("atrparser_batch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Пакетное декодирование ATR/ATS (JSON Lines или CSV)");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Входной файл ('-' или без аргумента — stdin)");
+    QCommandLineOption formatOption({"f", "format"}, "Формат вывода: jsonl или csv", "format", "jsonl");
+    QCommandLineOption outputOption({"o", "output"}, "Файл результата (по умолчанию stdout)", "file");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Число потоков (по умолчанию — число ядер)", "n");
+    QCommandLineOption listOption("smartcard-list", "База ATR в формате smartcard_list.txt", "file");
+    QCommandLineOption rulesOption("rules", "Дополнительные правила определения типа карты", "file");
+    QCommandLineOption strictOption("strict", "Строгая проверка ATR по ISO 7816-3 со списком нарушений");
+    parser.addOptions({formatOption, outputOption, jobsOption, listOption, rulesOption, strictOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    Context ctx;
+    ctx.strict = parser.isSet(strictOption);
+    const QString format = parser.value(formatOption);
+    if (format == "jsonl" || format == "json") {
+        ctx.format = OutputFormat::Jsonl;
+    } else if (format == "csv") {
+        ctx.format = OutputFormat::Csv;
+    } else {
+        err << "Неизвестный формат: " << format << Qt::endl;
+        return 2;
+    }
+
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (parser.isSet(jobsOption)) {
+        bool ok = false;
+        jobs = parser.value(jobsOption).toUInt(&ok);
+        if (!ok || jobs == 0) {
+            err << "Некорректное число потоков" << Qt::endl;
+            return 2;
+        }
+    }
+
+    atr::CardDatabase database = atr::CardDatabase::builtin();
+    if (parser.isSet(listOption)) {
+        const std::string path = QFile::encodeName(parser.value(listOption)).toStdString();
+        if (database.loadSmartcardList(path) == 0) {
+            err << "Не удалось загрузить базу ATR: " << parser.value(listOption) << Qt::endl;
+            return 2;
+        }
+    }
+    atr::RuleSet rules = atr::RuleSet::builtin();
+    if (parser.isSet(rulesOption)) {
+        std::string error;
+        if (!rules.load(QFile::encodeName(parser.value(rulesOption)).toStdString(), &error)) {
+            err << "Ошибка в правилах: " << QString::fromStdString(error) << Qt::endl;
+            return 2;
+        }
+    }
+    ctx.database = &database;
+    ctx.rules = &rules;
+
+    // Вход: отображение файла в память, для stdin и пайпов — чтение целиком
+    const QStringList args = parser.positionalArguments();
+    const QString inputPath = args.isEmpty() ? QString("-") : args.first();
+    QFile input;
+    QByteArray buffer;
+    const char *data = nullptr;
+    std::size_t size = 0;
+    if (inputPath == "-") {
+        if (!input.open(stdin, QIODevice::ReadOnly)) {
+            err << "Не удалось открыть stdin" << Qt::endl;
+            return 1;
+        }
+        buffer = input.readAll();
+    } else {
+        input.setFileName(inputPath);
+        if (!input.open(QIODevice::ReadOnly)) {
+            err << "Не удалось открыть " << inputPath << ": " << input.errorString() << Qt::endl;
+            return 1;
+        }
+        if (input.size() > 0) {
+            if (const uchar *mapped = input.map(0, input.size())) {
+                data = reinterpret_cast<const char *>(mapped);
+                size = static_cast<std::size_t>(input.size());
+            } else {
+                buffer = input.readAll();
+            }
+        }
+    }
+    if (!data) {
+        data = buffer.constData();
+        size = static_cast<std::size_t>(buffer.size());
+    }
+
+    std::FILE *out = stdout;
+    if (parser.isSet(outputOption)) {
+        out = std::fopen(QFile::encodeName(parser.value(outputOption)).constData(), "wb");
+        if (!out) {
+            err << "Не удалось создать " << parser.value(outputOption) << Qt::endl;
+            return 1;
+        }
+    }
+
+    const bool ok = run(ctx, data, size, jobs, out);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    if (!ok) {
+        err << "Ошибка записи результата" << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+// Пакетная классификация: SIMD-ядро atr::classifyBatch() против эталона
+// classifyBatchScalar() (decode() + identify() на каждую запись),
+// пакетная проверка TCK atr::checksumBatch() и параллельная
+// переклассификация корпуса atr::reclassify().
+//
+// Корпус синтетический, близкий к ночной переклассификации: в основном
+// PC/SC Part 3 и короткие бесконтактные ATR, плюс контактные карты, мусор
+// и обрезанные записи. Перед замером результаты обоих путей сверяются
+// запись в запись; при расхождении бенчмарк завершается с кодом 1.
+//
+// Запуск: ./atrparser_batch_bench [записей] [проходов]
+
+#include "../atrbatch.h"
+#include "../atrreclassify.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kStride = 33;
+
+const uint8_t kPcscPrefix[] = {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06};
+const uint16_t kPcscNames[] = {0x0001, 0x0002, 0x0003, 0x0026, 0x0036, 0x0037, 0x0038, 0x0039, 0x003A, 0x00FF};
+
+const std::vector<std::vector<uint8_t>> kContact = {
+    {0x3B, 0xEF, 0x00, 0x00, 0x81, 0x31, 0xFE, 0x45, 0x65, 0x63, 0x11, 0x04, 0x50, 0x02, 0x80, 0x00, 0x08, 0x39, 0x00, 0x04, 0x02, 0x05, 0x02, 0xE7},
+    {0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07},
+    {0x3F, 0xFF, 0x95, 0x00, 0xFF, 0x91, 0x81, 0x71, 0xFE, 0x47, 0x00, 0x44, 0x4E, 0x41, 0x53, 0x50, 0x31, 0x31, 0x30, 0x20, 0x52, 0x65, 0x76, 0x41, 0x30, 0x36},
+};
+
+uint8_t tckOf(const uint8_t *p, std::size_t length)
+{
+    uint8_t x = 0;
+    for (std::size_t i = 1; i < length; ++i) x ^= p[i];
+    return x;
+}
+
+void generate(std::size_t count, std::vector<uint8_t> &atrs, std::vector<uint8_t> &lengths)
+{
+    std::mt19937 rng(7816);
+    atrs.assign(count * kStride, 0);
+    lengths.assign(count, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        uint8_t *p = &atrs[i * kStride];
+        // Хвост слота заполнен мусором: ядро не должно на него смотреть
+        for (std::size_t j = 0; j < kStride; ++j) p[j] = static_cast<uint8_t>(rng());
+        const unsigned kind = rng() % 100;
+        std::size_t length = 0;
+        if (kind < 60) {
+            // PC/SC Part 3; изредка с битым TCK или ненулевым RFU
+            std::memcpy(p, kPcscPrefix, sizeof(kPcscPrefix));
+            const uint16_t name = kPcscNames[rng() % (sizeof(kPcscNames) / sizeof(kPcscNames[0]))];
+            p[12] = (rng() % 8) ? 0x03 : 0x11;
+            p[13] = static_cast<uint8_t>(name >> 8);
+            p[14] = static_cast<uint8_t>(name);
+            std::memset(p + 15, 0, 4);
+            if (rng() % 50 == 0) p[15 + rng() % 4] = static_cast<uint8_t>(rng());
+            length = 20;
+            p[19] = tckOf(p, 19);
+            if (rng() % 50 == 0) p[19] ^= 0x5A;
+        } else if (kind < 85) {
+            // 3B 8n 80 01 <n байтов> TCK
+            const std::size_t hist = rng() % 16;
+            p[0] = 0x3B;
+            p[1] = static_cast<uint8_t>(0x80 | hist);
+            p[2] = 0x80;
+            p[3] = 0x01;
+            length = 5 + hist;
+            p[length - 1] = tckOf(p, length - 1);
+        } else if (kind < 93) {
+            const std::vector<uint8_t> &atr = kContact[rng() % kContact.size()];
+            std::memcpy(p, atr.data(), atr.size());
+            length = atr.size();
+        } else if (kind < 97) {
+            // Шаблон совпадает, длина — нет
+            std::memcpy(p, kPcscPrefix, sizeof(kPcscPrefix));
+            length = 12 + rng() % 21;
+        } else {
+            length = rng() % (kStride + 1);
+        }
+        lengths[i] = static_cast<uint8_t>(length);
+    }
+}
+
+bool sameString(const char *a, const char *b)
+{
+    return a == b || (a && b && std::strcmp(a, b) == 0);
+}
+
+bool verify(const std::vector<uint8_t> &atrs, std::size_t stride, const std::vector<uint8_t> &lengths,
+            std::size_t count)
+{
+    std::vector<atr::BatchRecord> fast(count), reference(count);
+    const atr::CardDatabase &db = atr::CardDatabase::builtin();
+    const atr::RuleSet &rules = atr::RuleSet::builtin();
+    atr::classifyBatch(atrs.data(), stride, lengths.data(), count, db, rules, fast.data());
+    atr::classifyBatchScalar(atrs.data(), stride, lengths.data(), count, db, rules, reference.data());
+    for (std::size_t i = 0; i < count; ++i) {
+        const atr::BatchRecord &a = fast[i];
+        const atr::BatchRecord &b = reference[i];
+        const bool equal = a.status == b.status
+            && (a.status != atr::Status::Ok
+                || (a.id.type == b.id.type && sameString(a.id.name, b.id.name)
+                    && sameString(a.id.manufacturer, b.id.manufacturer)));
+        if (!equal) {
+            std::fprintf(stderr, "Расхождение в записи %zu (stride %zu): %s/%s против %s/%s\n", i, stride,
+                         atr::statusId(a.status), atr::cardTypeId(a.id.type),
+                         atr::statusId(b.status), atr::cardTypeId(b.id.type));
+            return false;
+        }
+    }
+    return true;
+}
+
+// checksumBatch() против побайтового XOR
+bool verifyChecksums(const std::vector<uint8_t> &atrs, std::size_t stride, const std::vector<uint8_t> &lengths,
+                     std::size_t count)
+{
+    std::vector<uint8_t> x(count);
+    std::size_t invalid = 0;
+    const std::size_t reported = atr::checksumBatch(atrs.data(), stride, lengths.data(), count, x.data());
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint8_t expected = tckOf(&atrs[i * stride], std::min<std::size_t>(lengths[i], stride));
+        if (x[i] != expected) {
+            std::fprintf(stderr, "checksumBatch(): запись %zu (stride %zu): %02X вместо %02X\n", i, stride,
+                         x[i], expected);
+            return false;
+        }
+        invalid += expected != 0;
+    }
+    if (reported != invalid) std::fprintf(stderr, "checksumBatch(): счётчик %zu вместо %zu\n", reported, invalid);
+    return reported == invalid;
+}
+
+// reclassify() должна дать те же типы, что и эталон, и верные отличия от
+// прежней классификации (эталон с искажённой каждой 97-й записью)
+bool verifyReclassify(const std::vector<uint8_t> &atrs, const std::vector<uint8_t> &lengths,
+                      std::size_t count)
+{
+    std::vector<atr::BatchRecord> reference(count);
+    atr::classifyBatchScalar(atrs.data(), kStride, lengths.data(), count, atr::CardDatabase::builtin(),
+                             atr::RuleSet::builtin(), reference.data());
+    std::vector<CardType> previous(count);
+    std::size_t expectedChanges = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const CardType type = reference[i].status == atr::Status::Ok ? reference[i].id.type : CardType::Unknown;
+        previous[i] = i % 97 == 0 ? static_cast<CardType>((static_cast<std::size_t>(type) + 1) % atr::kCardTypeCount)
+                                  : type;
+        if (previous[i] != type) ++expectedChanges;
+    }
+
+    const atr::Corpus corpus{atrs.data(), kStride, lengths.data(), count};
+    // Маленькие блоки и потоков больше ядер, чтобы кража работы действительно происходила
+    const atr::ReclassifyResult r = atr::reclassify(corpus, atr::CardDatabase::builtin(),
+                                                    atr::RuleSet::builtin(), previous, {8, 64});
+    std::size_t total = 0;
+    for (std::size_t n : r.histogram) total += n;
+    bool ok = total == count && r.changes.size() == expectedChanges;
+    for (std::size_t i = 0; ok && i < count; ++i) {
+        ok = r.types[i] == (reference[i].status == atr::Status::Ok ? reference[i].id.type : CardType::Unknown);
+    }
+    for (std::size_t i = 0; ok && i < r.changes.size(); ++i) {
+        const atr::TypeChange &c = r.changes[i];
+        ok = c.index % 97 == 0 && c.from == previous[c.index] && c.to == r.types[c.index]
+             && (i == 0 || r.changes[i - 1].index < c.index);
+    }
+    if (!ok) std::fprintf(stderr, "reclassify(): результат расходится с эталоном\n");
+    return ok;
+}
+
+template <typename F>
+double measureNs(int passes, std::size_t count, F &&f)
+{
+    double best = 1e300;
+    for (int run = 0; run < passes; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count());
+    }
+    return best / static_cast<double>(count);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::vector<uint8_t> atrs, lengths;
+    generate(count, atrs, lengths);
+
+    // Шаг слота: рабочий (SIMD) и меньше 16 байт (только скалярная проверка)
+    std::vector<uint8_t> narrow(count * 8), narrowLengths(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::memcpy(&narrow[i * 8], &atrs[i * kStride], 8);
+        narrowLengths[i] = std::min<uint8_t>(lengths[i], 8);
+    }
+    if (!verify(atrs, kStride, lengths, count) || !verify(narrow, 8, narrowLengths, count)
+        || !verifyChecksums(atrs, kStride, lengths, count) || !verifyChecksums(narrow, 8, narrowLengths, count)
+        || !verifyReclassify(atrs, lengths, count)) {
+        return 1;
+    }
+
+    const atr::CardDatabase &db = atr::CardDatabase::builtin();
+    const atr::RuleSet &rules = atr::RuleSet::builtin();
+    std::vector<atr::BatchRecord> out(count);
+    atr::BatchStats stats{};
+
+    const double scalar = measureNs(passes, count, [&] {
+        atr::classifyBatchScalar(atrs.data(), kStride, lengths.data(), count, db, rules, out.data());
+    });
+    // Пакеты по 4096 записей, как в ночной задаче
+    const double batch = measureNs(passes, count, [&] {
+        stats = atr::BatchStats{};
+        for (std::size_t i = 0; i < count; i += 4096) {
+            const std::size_t n = std::min<std::size_t>(4096, count - i);
+            const atr::BatchStats s = atr::classifyBatch(atrs.data() + i * kStride, kStride,
+                                                         lengths.data() + i, n, db, rules, out.data() + i);
+            stats.pcscPart3 += s.pcscPart3;
+            stats.contactless += s.contactless;
+            stats.irregular += s.irregular;
+        }
+    });
+
+    std::vector<uint8_t> checksums(count);
+    std::size_t badChecksums = 0;
+    const double xorScalar = measureNs(passes, count, [&] {
+        for (std::size_t i = 0; i < count; ++i) checksums[i] = tckOf(&atrs[i * kStride], lengths[i]);
+    });
+    const double xorBatch = measureNs(passes, count, [&] {
+        badChecksums = atr::checksumBatch(atrs.data(), kStride, lengths.data(), count, checksums.data());
+    });
+
+    const atr::Corpus corpus{atrs.data(), kStride, lengths.data(), count};
+    atr::ReclassifyResult reclassified;
+    const double parallel = measureNs(passes, count, [&] {
+        reclassified = atr::reclassify(corpus, db, rules);
+    });
+
+    std::printf("Записей: %zu, ядро: %s, результаты совпадают\n", count, atr::batchKernel());
+    std::printf("PC/SC Part 3: %zu, 3B 8n 80 01: %zu, прочие: %zu\n",
+                stats.pcscPart3, stats.contactless, stats.irregular);
+    std::printf("decode() + identify():  %8.1f нс/ATR\n", scalar);
+    std::printf("classifyBatch():        %8.1f нс/ATR\n", batch);
+    std::printf("ускорение: x%.1f\n", scalar / batch);
+    std::printf("XOR побайтно:           %8.1f нс/ATR\n", xorScalar);
+    std::printf("checksumBatch():        %8.1f нс/ATR (ненулевой XOR: %zu)\n", xorBatch, badChecksums);
+    std::printf("reclassify() (%u потоков): %8.1f нс/ATR\n",
+                std::max(1u, std::thread::hardware_concurrency()), parallel);
+    for (std::size_t t = 0; t < atr::kCardTypeCount; ++t) {
+        std::printf("  %-18s %zu\n", atr::cardTypeId(static_cast<CardType>(t)), reclassified.histogram[t]);
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Микро-бенчмарк декодирования interface bytes: тактов на ATR.
+//
+// "legacy" воспроизводит прежний алгоритм ATRParser (копия входа, два прохода
+// по цепочке TA/TB/TC/TD с дописыванием в векторы и линейным contains() по
+// списку протоколов) на std::vector вместо QVector, чтобы бенчмарк собирался
+// без Qt. "atr::decode" — однопроходное ядро из atrcore.h.
+//
+// Запуск: ./atrparser_decode_bench [итераций]
+
+#include "../atrcore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <x86intrin.h>
+#define ATR_BENCH_HAVE_RDTSC 1
+#endif
+
+namespace {
+
+const std::vector<std::vector<uint8_t>> kCorpus = {
+    // Mifare Classic 1K (PC/SC Part 3)
+    {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x6A},
+    // Mifare DESFire EV1
+    {0x3B, 0x81, 0x80, 0x01, 0x80, 0x80},
+    // EMV, T=0/T=1
+    {0x3B, 0xEF, 0x00, 0x00, 0x81, 0x31, 0xFE, 0x45, 0x65, 0x63, 0x11, 0x04, 0x50, 0x02, 0x80, 0x00, 0x08, 0x39, 0x00, 0x04, 0x02, 0x05, 0x02, 0xE7},
+    // EMV, T=0
+    {0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07},
+    // Смарт-карта с TA1..TA3 и T=15
+    {0x3B, 0xFF, 0x13, 0x00, 0xFF, 0x81, 0x31, 0xFE, 0x45, 0x65, 0x63, 0x0D, 0x0C, 0x76, 0x01, 0x56, 0x00, 0x0D, 0x00, 0x01, 0x22, 0x04, 0x03, 0x03, 0x5E},
+    // Обратная конвенция, длинная цепочка
+    {0x3F, 0xFF, 0x95, 0x00, 0xFF, 0x91, 0x81, 0x71, 0xFE, 0x47, 0x00, 0x44, 0x4E, 0x41, 0x53, 0x50, 0x31, 0x31, 0x30, 0x20, 0x52, 0x65, 0x76, 0x41, 0x30, 0x36},
+};
+
+struct LegacyResult {
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> interfaceBytes;
+    std::vector<uint8_t> historicalBytes;
+    std::vector<int> protocols;
+    std::vector<uint8_t> ta, tb, tc, td;
+    std::vector<int> tdProtocols;
+    int fi = 372, di = 1, baud = 9600;
+};
+
+bool legacyInterfaceBytes(LegacyResult &r)
+{
+    const std::vector<uint8_t> &atr = r.raw;
+    std::size_t idx = 2;
+    uint8_t td = atr[1];
+    while (idx < atr.size()) {
+        if (td & 0x10) { if (idx >= atr.size()) return false; r.interfaceBytes.push_back(atr[idx++]); }
+        if (td & 0x20) { if (idx >= atr.size()) return false; r.interfaceBytes.push_back(atr[idx++]); }
+        if (td & 0x40) { if (idx >= atr.size()) return false; r.interfaceBytes.push_back(atr[idx++]); }
+        if (!(td & 0x80)) break;
+        if (idx >= atr.size()) return false;
+        td = atr[idx];
+        r.interfaceBytes.push_back(atr[idx++]);
+        const int protocol = td & 0x0F;
+        if (std::find(r.protocols.begin(), r.protocols.end(), protocol) == r.protocols.end()) {
+            r.protocols.push_back(protocol);
+        }
+    }
+    return true;
+}
+
+void legacyInterfaceBytesDetailed(LegacyResult &r)
+{
+    static const int Fi_table[] = {372, 372, 558, 744, 1116, 1488, 1860, -1, -1, 512, 768, 1024, 1536, 2048, -1, -1};
+    static const int Di_table[] = {-1, 1, 2, 4, 8, 16, 32, 64, 12, 20, -1, -1, -1, -1, -1, -1};
+    const std::vector<uint8_t> &atr = r.raw;
+    std::size_t idx = 2;
+    uint8_t td = atr[1];
+    int group = 1;
+    while (idx < atr.size()) {
+        if (td & 0x10) {
+            if (idx >= atr.size()) break;
+            const uint8_t ta = atr[idx++];
+            r.ta.push_back(ta);
+            if (group == 1) {
+                if (Fi_table[ta >> 4] > 0) r.fi = Fi_table[ta >> 4];
+                if (Di_table[ta & 0x0F] > 0) r.di = Di_table[ta & 0x0F];
+                r.baud = (3750000 * r.di) / r.fi;
+            }
+        }
+        if (td & 0x20) { if (idx >= atr.size()) break; r.tb.push_back(atr[idx++]); }
+        if (td & 0x40) { if (idx >= atr.size()) break; r.tc.push_back(atr[idx++]); }
+        if (!(td & 0x80)) break;
+        if (idx >= atr.size()) break;
+        td = atr[idx];
+        r.td.push_back(atr[idx++]);
+        r.tdProtocols.push_back(td & 0x0F);
+        ++group;
+    }
+}
+
+bool legacyDecode(const std::vector<uint8_t> &in, LegacyResult &r)
+{
+    r = LegacyResult();
+    if (in.size() < 2) return false;
+    for (uint8_t b : in) r.raw.push_back(b);
+    if (r.raw[0] != 0x3B && r.raw[0] != 0x3F) return false;
+    if (!legacyInterfaceBytes(r)) return false;
+    legacyInterfaceBytesDetailed(r);
+    const std::size_t hist = r.raw[1] & 0x0F;
+    const std::size_t start = 2 + r.interfaceBytes.size();
+    if (start + hist <= r.raw.size()) {
+        for (std::size_t i = 0; i < hist; ++i) r.historicalBytes.push_back(r.raw[start + i]);
+    }
+    return true;
+}
+
+uint64_t now()
+{
+#ifdef ATR_BENCH_HAVE_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+template <typename F>
+double measure(long iterations, F &&f)
+{
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < 5; ++run) {
+        const uint64_t start = now();
+        for (long i = 0; i < iterations; ++i) {
+            for (const auto &atr : kCorpus) f(atr);
+        }
+        best = std::min(best, now() - start);
+    }
+    return static_cast<double>(best) / (static_cast<double>(iterations) * kCorpus.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+    volatile unsigned sink = 0;
+
+    const double legacy = measure(iterations, [&](const std::vector<uint8_t> &atr) {
+        LegacyResult r;
+        legacyDecode(atr, r);
+        sink = sink + static_cast<unsigned>(r.protocols.size() + r.ta.size());
+    });
+
+    atr::Atr decoded;
+    const double single = measure(iterations, [&](const std::vector<uint8_t> &atr) {
+        atr::decode(atr, decoded);
+        sink = sink + decoded.protocolMask + decoded.groupCount;
+    });
+
+#ifdef ATR_BENCH_HAVE_RDTSC
+    const char *unit = "тактов TSC";
+#else
+    const char *unit = "нс";
+#endif
+    std::printf("ATR в корпусе: %zu, итераций: %ld\n", kCorpus.size(), iterations);
+    std::printf("legacy (два прохода, векторы): %8.1f %s/ATR\n", legacy, unit);
+    std::printf("atr::decode (один проход):     %8.1f %s/ATR\n", single, unit);
+    std::printf("ускорение: x%.1f\n", legacy / single);
+    return 0;
+}
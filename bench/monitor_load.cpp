@@ -0,0 +1,169 @@
+// Нагрузочная проверка мониторинга на симуляторе PC/SC: CardReader с
+// PcscSimulator вместо winscard, N виртуальных ридеров и поток касаний с
+// заданной частотой по всем ридерам. Каждое касание — вставка карты и
+// извлечение через dwell; ATS читается APDU с заданной задержкой и долей
+// ошибок. Считаются сигналы cardInserted/cardRemoved; в событийном режиме
+// их число должно совпасть с числом касаний, иначе код возврата 1.
+// Ни pcscd, ни ридеры не нужны.
+//
+// Запуск: ./atrparser_monitor_load [ридеров] [касаний/с] [секунд]
+//                                  [задержка APDU, мкс] [доля ошибок APDU] [опрос, мс]
+//                                  [файл метрик]
+// Опрос 0 — событийный мониторинг (CardMonitor), иначе опрос SCardStatus воркерами.
+// С файлом метрик включаются замеры этапов (PipelineMetrics), по окончании
+// они записываются туда в формате Prometheus.
+
+#include "../cardreader.h"
+#include "../pcscsimulator.h"
+#include "../pipelinemetrics.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Bytes = PcscSimulator::Bytes;
+using Op = PcscSimulator::Operation;
+
+std::string readerName(int i)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "Virtual Reader %03d 00", i);
+    return name;
+}
+
+// Несколько разных карт, чтобы работал и промах, и попадание кэша разбора
+std::vector<PcscSimulator::Card> sampleCards()
+{
+    std::vector<PcscSimulator::Card> cards;
+    // PC/SC Part 3: Mifare Classic 1K и DESFire с ATS
+    cards.push_back(PcscSimulator::Card::contactless(
+        {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x6A},
+        {}));
+    cards.push_back(PcscSimulator::Card::contactless(
+        {0x3B, 0x81, 0x80, 0x01, 0x80, 0x80},
+        {0x06, 0x75, 0x77, 0x81, 0x02, 0x80}));
+    // Контактная EMV-карта, T=0
+    PcscSimulator::Card contact;
+    contact.atr = {0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07};
+    contact.protocols = SCARD_PROTOCOL_T0;
+    cards.push_back(contact);
+    return cards;
+}
+
+void printCalls(const PcscSimulator &sim)
+{
+    const struct {
+        Op op;
+        const char *name;
+    } ops[] = {
+        {Op::GetStatusChange, "GetStatusChange"},
+        {Op::Connect, "Connect"},
+        {Op::Status, "Status"},
+        {Op::Transmit, "Transmit"},
+        {Op::Disconnect, "Disconnect"},
+    };
+    for (const auto &o : ops) {
+        std::printf("  %-16s %10llu вызовов, %llu ошибок\n", o.name,
+                    static_cast<unsigned long long>(sim.calls(o.op)),
+                    static_cast<unsigned long long>(sim.injectedFailures(o.op)));
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int readers = std::max(1, argc > 1 ? std::atoi(argv[1]) : 200);
+    const int rate = std::max(1, argc > 2 ? std::atoi(argv[2]) : 2000);
+    const int seconds = std::max(1, argc > 3 ? std::atoi(argv[3]) : 5);
+    const int apduLatencyUs = argc > 4 ? std::atoi(argv[4]) : 200;
+    const double apduErrors = argc > 5 ? std::atof(argv[5]) : 0.0;
+    const int pollMs = argc > 6 ? std::atoi(argv[6]) : 0;
+    const QString metricsPath = argc > 7 ? QString::fromLocal8Bit(argv[7]) : QString();
+    PipelineMetrics::instance().setEnabled(!metricsPath.isEmpty());
+
+    PcscSimulator sim;
+    for (int i = 0; i < readers; ++i) sim.addReader(readerName(i));
+    sim.setLatency(Op::Transmit, std::chrono::microseconds(apduLatencyUs),
+                   std::chrono::microseconds(apduLatencyUs / 2));
+    if (apduErrors > 0) sim.setFailureRate(Op::Transmit, static_cast<LONG>(SCARD_F_COMM_ERROR), apduErrors);
+
+    // Касания по кругу; карта лежит половину интервала между касаниями
+    // одного ридера, но не дольше 50 мс
+    const std::vector<PcscSimulator::Card> cards = sampleCards();
+    const long taps = static_cast<long>(rate) * seconds;
+    const auto perReader = std::chrono::microseconds(1000000ll * readers / rate);
+    const auto dwell = std::min<std::chrono::microseconds>(perReader / 2, std::chrono::milliseconds(50));
+    const auto warmup = std::chrono::milliseconds(300);
+    for (long t = 0; t < taps; ++t) {
+        const std::string reader = readerName(static_cast<int>(t % readers));
+        const auto at = warmup + std::chrono::microseconds(t * 1000000ll / rate);
+        sim.schedule(at, {PcscSimulator::EventType::CardInserted, reader, cards[t % cards.size()]});
+        sim.schedule(at + dwell, {PcscSimulator::EventType::CardRemoved, reader, {}});
+    }
+
+    CardReader cardReader;
+    cardReader.setTransport(&sim);
+    long inserted = 0;
+    long removed = 0;
+    long errors = 0;
+    QObject::connect(&cardReader, &CardReader::cardInserted, [&](const ATRData &) { ++inserted; });
+    QObject::connect(&cardReader, &CardReader::cardRemoved, [&]() { ++removed; });
+    QObject::connect(&cardReader, &CardReader::readerError, [&](const QString &) { ++errors; });
+
+    if (!cardReader.initialize()) return 1;
+    if (pollMs > 0) {
+        cardReader.listReaders();
+        cardReader.startMonitoring(pollMs);
+    } else {
+        cardReader.startEventMonitoring();
+    }
+
+    std::printf("Ридеров: %d, касаний: %ld (%d/с, %d с), карта в ридере %lld мкс, APDU %d мкс, ошибки APDU %.1f%%, %s\n",
+                readers, taps, rate, seconds, static_cast<long long>(dwell.count()), apduLatencyUs,
+                apduErrors * 100.0, pollMs > 0 ? "опрос" : "события");
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const qint64 limitMs = (seconds + 10) * 1000ll;
+    QTimer check;
+    QObject::connect(&check, &QTimer::timeout, [&]() {
+        const bool drained = sim.pendingEvents() == 0 && inserted >= taps && removed >= taps;
+        if (!drained && elapsed.elapsed() < limitMs) return;
+        check.stop();
+        cardReader.stopMonitoring();
+        app.quit();
+    });
+    check.start(100);
+    app.exec();
+
+    const double wallSeconds = elapsed.elapsed() / 1000.0;
+    std::printf("За %.2f с: вставок %ld, извлечений %ld (%.0f событий/с), ошибок ридера %ld\n",
+                wallSeconds, inserted, removed, (inserted + removed) / wallSeconds, errors);
+    printCalls(sim);
+    if (!metricsPath.isEmpty()) {
+        if (!PipelineMetrics::instance().dumpPrometheus(metricsPath)) {
+            std::printf("Не удалось записать метрики в %s\n", qPrintable(metricsPath));
+            return 1;
+        }
+        std::printf("Метрики этапов: %s\n", qPrintable(metricsPath));
+    }
+
+    // При опросе короткие касания между двумя опросами не видны — это не ошибка
+    if (pollMs == 0 && (inserted != taps || removed != taps)) {
+        std::printf("РАСХОЖДЕНИЕ: ожидалось %ld вставок и извлечений\n", taps);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,342 @@
+// Google Benchmark: горячие пути ATRParser на корпусе реальных ATR/ATS.
+//
+// Кроме времени на операцию выводятся счётчики allocs/op и bytes/op.
+// На glibc перехватываются malloc/calloc/realloc (QVector/QString
+// выделяют память через malloc, а не через operator new), на остальных
+// платформах — только operator new.
+//
+// Запуск: ./atrparser_bench [--benchmark_filter=...]
+
+#include "../atrformatter.h"
+#include "../atrparser.h"
+#include "../atrresultcache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+std::atomic<std::size_t> g_allocatedBytes{0};
+
+inline void countAllocation(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+
+void *malloc(std::size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, std::size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+void *operator new(std::size_t size)
+{
+    countAllocation(size);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+#endif
+
+namespace {
+
+using Corpus = std::vector<QVector<uint8_t>>;
+
+// Контактные EMV-карты (T=0/T=1)
+const Corpus kEmvCorpus = {
+    {0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07},
+    {0x3B, 0xEF, 0x00, 0x00, 0x81, 0x31, 0xFE, 0x45, 0x65, 0x63, 0x11, 0x04, 0x50, 0x02, 0x80, 0x00, 0x08, 0x39, 0x00, 0x04, 0x02, 0x05, 0x02, 0xE7},
+    {0x3B, 0x8E, 0x80, 0x01, 0x80, 0x31, 0x80, 0x66, 0xB0, 0x84, 0x0C, 0x01, 0x6E, 0x01, 0x83, 0x00, 0x90, 0x00, 0x1C},
+    {0x3B, 0xFF, 0x13, 0x00, 0xFF, 0x81, 0x31, 0xFE, 0x45, 0x65, 0x63, 0x0D, 0x0C, 0x76, 0x01, 0x56, 0x00, 0x0D, 0x00, 0x01, 0x22, 0x04, 0x03, 0x03, 0x5E},
+};
+
+// Бесконтактные Mifare (ATR, сформированный ридером по PC/SC Part 3)
+const Corpus kMifareCorpus = {
+    {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x6A},
+    {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x68},
+    {0x3B, 0x81, 0x80, 0x01, 0x80, 0x80},
+    {0x3B, 0x86, 0x80, 0x01, 0x06, 0x75, 0x77, 0x81, 0x02, 0x80, 0x00},
+};
+
+// Некорректные входы: короткий, неверный TS, оборванная цепочка, слишком длинный, неверный TCK
+const Corpus kMalformedCorpus = {
+    {0x3B},
+    {0x42, 0x00},
+    {0x3B, 0xF0, 0x11},
+    QVector<uint8_t>(40, 0x3B),
+    {0x3B, 0x81, 0x80, 0x01, 0x80, 0x81},
+};
+
+// ATS (ISO 14443-4): DESFire, JCOP, только TL, TL больше буфера
+const Corpus kAtsCorpus = {
+    {0x06, 0x75, 0x77, 0x81, 0x02, 0x80},
+    {0x0C, 0x78, 0x77, 0xD4, 0x02, 0x00, 0x00, 0x90, 0x00, 0x12, 0x34, 0x56},
+    {0x01},
+    {0x10, 0x78, 0x80},
+};
+
+// Счётчики выделений памяти за время цикла, в пересчёте на итерацию
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+        : m_allocations(g_allocations.load(std::memory_order_relaxed))
+        , m_bytes(g_allocatedBytes.load(std::memory_order_relaxed))
+    {
+    }
+
+    void report(benchmark::State &state) const
+    {
+        const double allocations = static_cast<double>(g_allocations.load(std::memory_order_relaxed) - m_allocations);
+        const double bytes = static_cast<double>(g_allocatedBytes.load(std::memory_order_relaxed) - m_bytes);
+        state.counters["allocs/op"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+        state.counters["bytes/op"] = benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    std::size_t m_allocations;
+    std::size_t m_bytes;
+};
+
+// Парсеры с уже разобранными ATR — для бенчмарков форматирования
+std::vector<std::unique_ptr<ATRParser>> parsedCorpus(const Corpus &corpus)
+{
+    std::vector<std::unique_ptr<ATRParser>> parsers;
+    for (const QVector<uint8_t> &atr : corpus) {
+        auto parser = std::make_unique<ATRParser>();
+        parser->parseATR(atr);
+        parsers.push_back(std::move(parser));
+    }
+    return parsers;
+}
+
+void BM_ParseATR(benchmark::State &state, const Corpus *corpus)
+{
+    ATRParser parser;
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parseATR((*corpus)[i]));
+        if (++i == corpus->size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+// Режим наблюдателя: сигналы и текст ошибки на каждый вызов
+void BM_ParseATRObserver(benchmark::State &state, const Corpus *corpus)
+{
+    ATRParser parser;
+    parser.setObserverMode(true);
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parseATR((*corpus)[i]));
+        if (++i == corpus->size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+// Без QObject: ATRDecoder с кодом ошибки вместо сигнала
+void BM_DecodeATR(benchmark::State &state, const Corpus *corpus)
+{
+    ATRDecoder decoder;
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        const QVector<uint8_t> &bytes = (*corpus)[i];
+        benchmark::DoNotOptimize(decoder.parseATR({bytes.constData(), static_cast<std::size_t>(bytes.size())}));
+        if (++i == corpus->size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+void BM_ParseATS(benchmark::State &state, const Corpus *corpus)
+{
+    ATRParser parser;
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parseATS((*corpus)[i]));
+        if (++i == corpus->size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+// То же, что делает ATRDecoder::detectCardType() (закрытый метод):
+// поиск в базе и правила; строки результата уже интернированы
+void BM_DetectCardType(benchmark::State &state, const Corpus *corpus)
+{
+    std::vector<atr::Atr> decoded;
+    for (const QVector<uint8_t> &bytes : *corpus) {
+        atr::Atr a;
+        if (atr::decode({bytes.constData(), static_cast<std::size_t>(bytes.size())}, a) == atr::Status::Ok) {
+            decoded.push_back(a);
+        }
+    }
+    const atr::CardDatabase &database = atr::CardDatabase::builtin();
+    const atr::RuleSet &rules = atr::RuleSet::builtin();
+
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        const atr::Identification id = atr::identify(decoded[i], database, rules);
+        benchmark::DoNotOptimize(id.nameId);
+        benchmark::DoNotOptimize(id.manufacturerId);
+        if (++i == decoded.size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+void BM_AtrToString(benchmark::State &state, const Corpus *corpus)
+{
+    const auto parsers = parsedCorpus(*corpus);
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        QString text = parsers[i]->atrToString();
+        benchmark::DoNotOptimize(text);
+        if (++i == parsers.size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+void BM_GetDetailedInfo(benchmark::State &state, const Corpus *corpus)
+{
+    const auto parsers = parsedCorpus(*corpus);
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        QString text = parsers[i]->getDetailedInfo();
+        benchmark::DoNotOptimize(text);
+        if (++i == parsers.size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+void BM_GetFormattedOutput(benchmark::State &state, const Corpus *corpus)
+{
+    const auto parsers = parsedCorpus(*corpus);
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        QString text = parsers[i]->getFormattedOutput();
+        benchmark::DoNotOptimize(text);
+        if (++i == parsers.size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+// Повторное касание: поиск в ATRResultCache (все ATR корпуса уже в кэше)
+void BM_ResultCacheHit(benchmark::State &state, const Corpus *corpus)
+{
+    ATRResultCache cache;
+    for (const QVector<uint8_t> &bytes : *corpus) {
+        cache.parse({bytes.constData(), static_cast<std::size_t>(bytes.size())});
+    }
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        const QVector<uint8_t> &bytes = (*corpus)[i];
+        benchmark::DoNotOptimize(cache.find({bytes.constData(), static_cast<std::size_t>(bytes.size())}));
+        if (++i == corpus->size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+// Копия результата (как при передаче через queued-сигнал)
+void BM_CopyATRData(benchmark::State &state, const Corpus *corpus)
+{
+    std::vector<ATRData> snapshots;
+    for (const auto &parser : parsedCorpus(*corpus)) {
+        snapshots.push_back(parser->getATRData());
+    }
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        ATRData copy = snapshots[i];
+        benchmark::DoNotOptimize(copy);
+        if (++i == snapshots.size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+// Рендер в переиспользуемый буфер (как в main.cpp / console_example.cpp)
+void BM_RenderHtml(benchmark::State &state, const Corpus *corpus)
+{
+    std::vector<ATRData> snapshots;
+    for (const auto &parser : parsedCorpus(*corpus)) {
+        snapshots.push_back(parser->getATRData());
+    }
+    QString buffer;
+    std::size_t i = 0;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        ATRFormatter::renderHtml(snapshots[i], buffer);
+        benchmark::DoNotOptimize(buffer.constData());
+        if (++i == snapshots.size()) i = 0;
+    }
+    allocations.report(state);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_ParseATR, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_ParseATR, mifare, &kMifareCorpus);
+BENCHMARK_CAPTURE(BM_ParseATR, malformed, &kMalformedCorpus);
+BENCHMARK_CAPTURE(BM_ParseATRObserver, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_ParseATRObserver, malformed, &kMalformedCorpus);
+BENCHMARK_CAPTURE(BM_DecodeATR, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_DecodeATR, malformed, &kMalformedCorpus);
+BENCHMARK_CAPTURE(BM_ParseATS, ats, &kAtsCorpus);
+BENCHMARK_CAPTURE(BM_DetectCardType, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_DetectCardType, mifare, &kMifareCorpus);
+BENCHMARK_CAPTURE(BM_AtrToString, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_AtrToString, mifare, &kMifareCorpus);
+BENCHMARK_CAPTURE(BM_GetDetailedInfo, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_GetDetailedInfo, mifare, &kMifareCorpus);
+BENCHMARK_CAPTURE(BM_GetFormattedOutput, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_GetFormattedOutput, mifare, &kMifareCorpus);
+BENCHMARK_CAPTURE(BM_CopyATRData, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_ResultCacheHit, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_ResultCacheHit, mifare, &kMifareCorpus);
+BENCHMARK_CAPTURE(BM_RenderHtml, emv, &kEmvCorpus);
+BENCHMARK_CAPTURE(BM_RenderHtml, mifare, &kMifareCorpus);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,216 @@
+#include "cardmonitor.h"
+#include <QDebug>
+#include <QMap>
+#include <QMutexLocker>
+#include <cstring>
+
+namespace {
+
+// Псевдо-ридер, состояние которого меняется при подключении/отключении ридеров
+const char kPnPNotification[] = "\\\\?PnP?\\Notification";
+
+// Без поддержки PnP список ридеров перечитывается по таймауту
+const DWORD kRelistTimeoutMs = 1000;
+
+} // namespace
+
+CardMonitor::CardMonitor(PcscTransport &pcsc, QObject *parent)
+    : QThread(parent)
+    , m_pcsc(pcsc)
+    , m_context(0)
+    , m_hasContext(false)
+    , m_stopping(false)
+{
+    qRegisterMetaType<QVector<uint8_t>>("QVector<uint8_t>");
+}
+
+CardMonitor::~CardMonitor()
+{
+    stop();
+}
+
+void CardMonitor::stop()
+{
+    m_stopping = true;
+    // SCardCancel, отправленный до входа в SCardGetStatusChange, теряется,
+    // поэтому повторяем его, пока поток не завершится
+    while (isRunning() && !wait(50)) {
+        QMutexLocker lock(&m_contextMutex);
+        if (m_hasContext) {
+            m_pcsc.cancel(m_context);
+        }
+    }
+}
+
+QStringList CardMonitor::listReaders(SCARDCONTEXT context, LONG &result) const
+{
+    QStringList readers;
+    DWORD readersLen = 0;
+    result = m_pcsc.listReaders(context, nullptr, &readersLen);
+    if (result != SCARD_S_SUCCESS || readersLen == 0) {
+        return readers;
+    }
+
+    QVector<char> readersBuffer(readersLen);
+    result = m_pcsc.listReaders(context, readersBuffer.data(), &readersLen);
+    if (result != SCARD_S_SUCCESS) {
+        return readers;
+    }
+
+    // Парсинг multi-string буфера
+    const char *ptr = readersBuffer.constData();
+    while (*ptr != '\0') {
+        readers.append(QString::fromLocal8Bit(ptr));
+        ptr += strlen(ptr) + 1;
+    }
+    return readers;
+}
+
+void CardMonitor::run()
+{
+    // Ридеры и их последние состояния (со счётчиком событий) переживают
+    // переустановку контекста: первое ожидание в новом контексте сравнивает
+    // с ними, поэтому карта, извлечённая или заменённая во время сбоя,
+    // сообщается извлечением, а оставшаяся в ридере не вставляется повторно
+    QStringList readers;
+    QVector<QByteArray> names;               // владеют строками szReader
+    QVector<SCARD_READERSTATE> states;
+    QMap<QString, DWORD> knownStates;
+    bool pnpSupported = true;
+    DWORD pnpState = SCARD_STATE_UNAWARE;
+    bool relist = true;
+
+    while (!m_stopping) {
+        SCARDCONTEXT context = 0;
+        LONG result = m_pcsc.establishContext(SCARD_SCOPE_SYSTEM, &context);
+        if (result != SCARD_S_SUCCESS) {
+            emit monitorError(static_cast<quint32>(result));
+            // Служба может быть ещё не запущена — повторим позже
+            for (int i = 0; i < 10 && !m_stopping; ++i) {
+                msleep(100);
+            }
+            continue;
+        }
+        {
+            QMutexLocker lock(&m_contextMutex);
+            m_context = context;
+            m_hasContext = true;
+        }
+
+        // Список перечитывается в новом контексте, состояния ридеров — прежние
+        relist = true;
+
+        while (!m_stopping) {
+            if (relist) {
+                relist = false;
+                LONG listResult = SCARD_S_SUCCESS;
+                const QStringList current = listReaders(context, listResult);
+                if (listResult != SCARD_S_SUCCESS && listResult != static_cast<LONG>(SCARD_E_NO_READERS_AVAILABLE)) {
+                    result = listResult;
+                    break;
+                }
+
+                // Сохраняем состояние ридеров, которые остались в списке
+                for (int i = 0; i < readers.size(); ++i) {
+                    knownStates[readers[i]] = states[i].dwCurrentState;
+                }
+                for (const QString &r : readers) {
+                    if (!current.contains(r) && (knownStates.value(r) & SCARD_STATE_PRESENT)) {
+                        emit cardRemoved(r);
+                    }
+                }
+                if (current != readers) {
+                    emit readersChanged(current);
+                }
+                readers = current;
+
+                names.clear();
+                states.clear();
+                for (const QString &r : readers) {
+                    names.append(r.toLocal8Bit());
+                }
+                if (pnpSupported) {
+                    names.append(QByteArray(kPnPNotification));
+                }
+                states.resize(names.size());
+                for (int i = 0; i < names.size(); ++i) {
+                    SCARD_READERSTATE &s = states[i];
+                    memset(&s, 0, sizeof(s));
+                    s.szReader = names[i].constData();
+                    s.dwCurrentState = i < readers.size()
+                        ? knownStates.value(readers[i], SCARD_STATE_UNAWARE)
+                        : pnpState;
+                }
+                knownStates.clear();
+            }
+
+            if (states.isEmpty()) {
+                // Нет ни ридеров, ни PnP — ждём и перечитываем список
+                msleep(kRelistTimeoutMs);
+                relist = true;
+                continue;
+            }
+
+            result = m_pcsc.getStatusChange(context,
+                                            pnpSupported ? INFINITE : kRelistTimeoutMs,
+                                            states.data(),
+                                            static_cast<DWORD>(states.size()));
+            if (result == static_cast<LONG>(SCARD_E_TIMEOUT)) {
+                relist = true;
+                continue;
+            }
+            if (result == static_cast<LONG>(SCARD_E_CANCELLED)) {
+                continue;   // stop() — проверяется в условии цикла
+            }
+            if (result != SCARD_S_SUCCESS) {
+                break;      // переустанавливаем контекст
+            }
+
+            for (int i = 0; i < states.size(); ++i) {
+                SCARD_READERSTATE &s = states[i];
+                if (!(s.dwEventState & SCARD_STATE_CHANGED)) continue;
+
+                if (i >= readers.size()) {
+                    // Псевдо-ридер PnP: список ридеров изменился
+                    if (s.dwEventState & SCARD_STATE_UNKNOWN) {
+                        qDebug() << "PnP-уведомления не поддерживаются, список ридеров опрашивается";
+                        pnpSupported = false;
+                    }
+                    pnpState = s.dwEventState & ~SCARD_STATE_CHANGED;
+                    relist = true;
+                    continue;
+                }
+
+                const bool wasPresent = (s.dwCurrentState & SCARD_STATE_PRESENT) != 0;
+                const bool present = (s.dwEventState & SCARD_STATE_PRESENT) != 0;
+                // Старшее слово — счётчик событий: карту успели заменить между вызовами
+                const bool replaced = wasPresent && present &&
+                                      (s.dwCurrentState >> 16) != 0 &&
+                                      (s.dwCurrentState >> 16) != (s.dwEventState >> 16);
+                s.dwCurrentState = s.dwEventState & ~SCARD_STATE_CHANGED;
+
+                if (s.dwEventState & (SCARD_STATE_UNKNOWN | SCARD_STATE_IGNORE)) {
+                    relist = true;   // ридер отключен
+                }
+                if (wasPresent && (!present || replaced)) {
+                    emit cardRemoved(readers[i]);
+                }
+                if (present && (!wasPresent || replaced)) {
+                    const DWORD atrLen = qMin<DWORD>(s.cbAtr, sizeof(s.rgbAtr));
+                    emit cardInserted(readers[i], QVector<uint8_t>(s.rgbAtr, s.rgbAtr + atrLen));
+                }
+            }
+        }
+
+        {
+            QMutexLocker lock(&m_contextMutex);
+            m_hasContext = false;
+        }
+        m_pcsc.releaseContext(context);
+
+        if (!m_stopping && result != SCARD_S_SUCCESS) {
+            emit monitorError(static_cast<quint32>(result));
+            msleep(100);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef CARDMONITOR_H
+#define CARDMONITOR_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+
+#ifdef __APPLE__
+#include <PCSC/winscard.h>
+#include <PCSC/wintypes.h>
+#else
+#include <winscard.h>
+#endif
+
+#include "pcsctransport.h"
+
+// Событийный мониторинг карт: отдельный поток блокируется в
+// SCardGetStatusChange сразу по всем ридерам и псевдо-ридеру
+// \\?PnP?\Notification, поэтому вставка/извлечение обнаруживаются без
+// задержки опроса и без постоянных запросов к pcscd.
+// Сигналы испускаются из потока монитора (используйте queued-соединения).
+class CardMonitor : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit CardMonitor(PcscTransport &pcsc = PcscTransport::system(), QObject *parent = nullptr);
+    ~CardMonitor();
+
+    // Остановка: SCardCancel прерывает ожидание, затем поток завершается
+    void stop();
+
+signals:
+    // При старте о картах, уже находящихся в ридерах, сообщается как о вставке
+    void cardInserted(const QString &reader, const QVector<uint8_t> &atr);
+    void cardRemoved(const QString &reader);
+    void readersChanged(const QStringList &readers);
+    void monitorError(quint32 code);
+
+protected:
+    void run() override;
+
+private:
+    QStringList listReaders(SCARDCONTEXT context, LONG &result) const;
+
+    PcscTransport &m_pcsc;
+    QMutex m_contextMutex;
+    SCARDCONTEXT m_context;
+    bool m_hasContext;
+    std::atomic<bool> m_stopping;
+};
+
+#endif // CARDMONITOR_H
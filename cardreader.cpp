@@ -1,16 +1,19 @@
 #include "cardreader.h"
+#include "atrresultcache.h"
+#include "pipelinemetrics.h"
 #include <QDebug>
 #include <cstring>
 
 CardReader::CardReader(QObject *parent)
     : QObject(parent)
+    , m_pcsc(&PcscTransport::system())
     , m_context(0)
     , m_initialized(false)
     , m_connected(false)
-    , m_parser(this)
+    , m_negotiateLink(false)
+    , m_statusMonitor(nullptr)
 {
-    m_monitorTimer = new QTimer(this);
-    connect(m_monitorTimer, &QTimer::timeout, this, &CardReader::checkCardPresence);
+    qRegisterMetaType<ATRData>("ATRData");
 }
 
 CardReader::~CardReader()
@@ -18,13 +21,30 @@ CardReader::~CardReader()
     cleanup();
 }
 
+void CardReader::setTransport(PcscTransport *transport)
+{
+    m_pcsc = transport ? transport : &PcscTransport::system();
+}
+
+void CardReader::setLinkNegotiation(bool enabled, const LinkOptions &options)
+{
+    m_negotiateLink = enabled;
+    m_linkOptions = options;
+}
+
+LinkReport CardReader::linkReport() const
+{
+    auto it = m_readers.constFind(m_currentReader);
+    return it != m_readers.constEnd() ? it->link : LinkReport();
+}
+
 bool CardReader::initialize()
 {
     if (m_initialized) {
         return true;
     }
     
-    LONG result = SCardEstablishContext(SCARD_SCOPE_SYSTEM, nullptr, nullptr, &m_context);
+    LONG result = m_pcsc->establishContext(SCARD_SCOPE_SYSTEM, &m_context);
     
     if (result != SCARD_S_SUCCESS) {
         emit readerError(QString("Ошибка инициализации PC/SC: %1").arg(getErrorString(result)));
@@ -44,7 +64,7 @@ void CardReader::cleanup()
     // отключаем все ридеры
     for (auto &rs : m_readers) {
         if (rs.connected) {
-            SCardDisconnect(rs.handle, SCARD_LEAVE_CARD);
+            m_pcsc->disconnect(rs.handle, SCARD_LEAVE_CARD);
             rs.connected = false;
             rs.handle = 0;
         }
@@ -63,7 +83,7 @@ QStringList CardReader::listReaders()
     }
     
     DWORD readersLen = 0;
-    LONG result = SCardListReaders(m_context, nullptr, nullptr, &readersLen);
+    LONG result = m_pcsc->listReaders(m_context, nullptr, &readersLen);
     
     if (result != SCARD_S_SUCCESS) {
         emit readerError(QString("Ошибка получения списка ридеров: %1").arg(getErrorString(result)));
@@ -76,7 +96,7 @@ QStringList CardReader::listReaders()
     }
     
     QVector<char> readersBuffer(readersLen);
-    result = SCardListReaders(m_context, nullptr, readersBuffer.data(), &readersLen);
+    result = m_pcsc->listReaders(m_context, readersBuffer.data(), &readersLen);
     
     if (result != SCARD_S_SUCCESS) {
         emit readerError(QString("Ошибка чтения списка ридеров: %1").arg(getErrorString(result)));
@@ -116,7 +136,7 @@ bool CardReader::connectToReader(const QString &readerName)
     ReaderState &rs = m_readers[readerName];
 
     if (rs.connected) {
-        SCardDisconnect(rs.handle, SCARD_LEAVE_CARD);
+        m_pcsc->disconnect(rs.handle, SCARD_LEAVE_CARD);
         rs.connected = false;
         rs.handle = 0;
     }
@@ -124,7 +144,7 @@ bool CardReader::connectToReader(const QString &readerName)
     QByteArray readerNameBytes = readerName.toLocal8Bit();
     SCARDHANDLE handle = 0;
     DWORD protocol = 0;
-    LONG result = SCardConnect(
+    LONG result = m_pcsc->connect(
         m_context,
         readerNameBytes.constData(),
         SCARD_SHARE_SHARED,
@@ -140,6 +160,14 @@ bool CardReader::connectToReader(const QString &readerName)
         return false;
     }
 
+    rs.link = LinkReport();
+    if (m_negotiateLink) {
+        const QVector<uint8_t> atr = ReaderWorker::readATR(handle, *m_pcsc);
+        rs.link = negotiateLink(*m_pcsc, handle, protocol,
+                                std::span<const uint8_t>(atr.constData(), static_cast<size_t>(atr.size())),
+                                m_linkOptions);
+    }
+
     rs.handle = handle;
     rs.protocol = protocol;
     rs.connected = true;
@@ -151,6 +179,12 @@ bool CardReader::connectToReader(const QString &readerName)
 
     qDebug() << "Успешно подключено к ридеру:" << readerName;
     qDebug() << "Протокол:" << (protocol == SCARD_PROTOCOL_T0 ? "T=0" : "T=1");
+    if (rs.link.attempted) {
+        qDebug() << "Канал:" << rs.link.baud << "бит/с, Fi/Di" << rs.link.fi << "/" << int(rs.link.di)
+                 << (rs.link.measured ? "(атрибуты ридера)" : "(по результату PPS)")
+                 << "из возможных" << rs.link.requested.baud << "бит/с;"
+                 << "IFSC/IFSD" << rs.link.ifsc << "/" << rs.link.ifsd;
+    }
 
     return true;
 }
@@ -161,7 +195,7 @@ void CardReader::disconnect()
     if (!m_currentReader.isEmpty() && m_readers.contains(m_currentReader)) {
         ReaderState &rs = m_readers[m_currentReader];
         if (rs.connected) {
-            SCardDisconnect(rs.handle, SCARD_LEAVE_CARD);
+            m_pcsc->disconnect(rs.handle, SCARD_LEAVE_CARD);
             rs.connected = false;
             rs.handle = 0;
             qDebug() << "Отключено от ридера:" << rs.name;
@@ -172,33 +206,8 @@ void CardReader::disconnect()
 }
 QVector<uint8_t> CardReader::getATRFor(const ReaderState &rs)
 {
-    QVector<uint8_t> atr;
-    if (!rs.connected) return atr;
-
-    BYTE atrBuffer[MAX_ATR_SIZE];
-    DWORD atrLen = sizeof(atrBuffer);
-    DWORD state, protocol;
-    BYTE readerName[256];
-    DWORD readerLen = sizeof(readerName);
-
-    LONG result = SCardStatus(
-        rs.handle,
-        reinterpret_cast<LPSTR>(readerName),
-        &readerLen,
-        &state,
-        &protocol,
-        atrBuffer,
-        &atrLen
-    );
-
-    if (result != SCARD_S_SUCCESS) {
-        return atr;
-    }
-
-    for (DWORD i = 0; i < atrLen; i++) {
-        atr.append(atrBuffer[i]);
-    }
-    return atr;
+    if (!rs.connected) return {};
+    return ReaderWorker::readATR(rs.handle, *m_pcsc);
 }
 
 QVector<uint8_t> CardReader::getATR()
@@ -209,71 +218,16 @@ QVector<uint8_t> CardReader::getATR()
 }
 QVector<uint8_t> CardReader::getATS()
 {
-    QVector<uint8_t> ats;
-
     // Используем активный ридер
     if (m_currentReader.isEmpty() || !m_readers.contains(m_currentReader))
-        return ats;
-    const ReaderState &rs = m_readers[m_currentReader];
-    if (!rs.connected)
-        return ats;
-
-    // SCardTransmit требует корректный PCI по протоколу
-    const SCARD_IO_REQUEST* pci =
-        (rs.protocol == SCARD_PROTOCOL_T0) ? SCARD_PCI_T0 :
-        (rs.protocol == SCARD_PROTOCOL_T1) ? SCARD_PCI_T1 :
-        nullptr;
-
-    if (!pci) return ats;
-
-    // GET DATA (ATS) команда в PC/SC:
-    // Команда: FF CA 01 00 00 — НЕ правильная для ATS, это UID.
-    // Для ATS используем: FF CA 36 00 00? — тоже неверно.
-    // Корректно: команда ISO7816-4 GET DATA с P1P2=0x9F 0x7F, но через vendor escape не всегда доступна.
-    // На практике для 14443-4 (contactless) часто доступна команда:
-    //   FF CA 01 00 00 — UID; ATS может быть по: FF CA 36 00 00 (NXP) или команда 0xCA GET DATA P1=0x01(P2=0x00) не стандарт.
-    // Универсальный способ через PC/SC: SCardTransmit с APDU: 00 CA 01 00 00 — GET DATA (ATS) по P1=0x01?
-    // В большинстве ридеров ожидаемый тег ATS — 0x36 (proprietary). Надежнее запрос по GET DATA tag 0x36:
-    //   APDU: FF CA 36 00 00
-    // Реализации различаются, поэтому попробуем несколько известных вариантов по очереди.
-
-    const QByteArray apdus[] = {
-        QByteArray::fromHex("00CA017F00"), // GET DATA P1=0x01,P2=0x7F (некоторые стекы)
-        QByteArray::fromHex("00CA9F7F00"), // GET DATA P1P2=0x9F7F (ATS tag)
-        QByteArray::fromHex("FFCA360000"),  // Vendor GET DATA ATS (часто для ACR/NXP)
-        QByteArray::fromHex("FFCA010000")
-    };
-
-    BYTE recvBuf[512];
-    for (const QByteArray &apdu : apdus) {
-        DWORD recvLen = sizeof(recvBuf);
-        LONG r = SCardTransmit(rs.handle,
-                               pci,
-                               reinterpret_cast<const BYTE*>(apdu.constData()),
-                               static_cast<DWORD>(apdu.size()),
-                               nullptr,
-                               recvBuf,
-                               &recvLen);
-        if (r != SCARD_S_SUCCESS || recvLen < 2)
-            continue;
-
-        BYTE sw1 = recvBuf[recvLen - 2];
-        BYTE sw2 = recvBuf[recvLen - 1];
-        if (sw1 != 0x90 || sw2 != 0x00)
-            continue;
-
-        DWORD dataLen = recvLen - 2;
-        if (dataLen == 0)
-            continue;
-
-        ats.reserve(static_cast<int>(dataLen));
-        for (DWORD i = 0; i < dataLen; ++i)
-            ats.push_back(recvBuf[i]);
-
-        break; // успешно получили ATS
-    }
+        return {};
+    return getATSFor(m_readers[m_currentReader]);
+}
 
-    return ats;
+QVector<uint8_t> CardReader::getATSFor(const ReaderState &rs)
+{
+    if (!rs.connected) return {};
+    return ReaderWorker::readATS(rs.handle, rs.protocol, rs.name, *m_pcsc);
 }
 
 ATRData CardReader::readCardInfo()
@@ -284,16 +238,15 @@ ATRData CardReader::readCardInfo()
     QVector<uint8_t> atr = getATRFor(m_readers[m_currentReader]);
     if (atr.isEmpty()) return emptyData;
 
-    if (!m_parser.parseATR(atr)) {
+    QVector<uint8_t> ats = getATS();
+    const ATRResultCache::Entry result = ATRResultCache::instance().parse(
+        std::span<const uint8_t>(atr.constData(), static_cast<size_t>(atr.size())),
+        std::span<const uint8_t>(ats.constData(), static_cast<size_t>(ats.size())));
+    if (!result) {
         emit readerError("Ошибка парсинга ATR");
         return emptyData;
     }
-
-    QVector<uint8_t> ats = getATS();
-    if (!ats.isEmpty()) {
-        m_parser.parseATS(ats);
-    }
-    return m_parser.getATRData();
+    return *result;
 }
 
 void CardReader::startMonitoring(int intervalMs)
@@ -303,109 +256,188 @@ void CardReader::startMonitoring(int intervalMs)
         return;
     }
 
-    // Если в m_readers нет подключённых — пробуем подключить все доступные, не падая на ошибках
+    stopMonitoring();
+
     if (m_readers.isEmpty()) {
         listReaders();
     }
-    for (auto it = m_readers.begin(); it != m_readers.end(); ++it) {
-        ReaderState &rs = it.value();
-        if (!rs.connected) {
-            // тихо пробуем подключиться; ошибки не критичны для общего мониторинга
-            connectToReader(rs.name);
-        }
-        // Инициализируем начальное состояние
-        rs.cardPresent = checkCardStatusFor(rs);
-        rs.lastATR = rs.cardPresent ? getATRFor(rs) : QVector<uint8_t>{};
+    // Каждый ридер опрашивается своим воркером в своём потоке
+    for (const QString &reader : m_readers.keys()) {
+        startWorker(reader, intervalMs);
     }
 
-    m_monitorTimer->start(intervalMs);
-    qDebug() << "Мониторинг карт запущен для" << m_readers.size() << "ридеров, интервал" << intervalMs << "мс";
+    qDebug() << "Мониторинг карт запущен для" << m_workers.size() << "ридеров, интервал" << intervalMs << "мс";
+}
+
+void CardReader::startEventMonitoring()
+{
+    if (!m_initialized) {
+        emit readerError("Нельзя начать мониторинг без инициализации");
+        return;
+    }
+
+    stopMonitoring();
+
+    // Воркеры создаются по readersChanged от монитора
+    m_statusMonitor = new CardMonitor(*m_pcsc, this);
+    connect(m_statusMonitor, &CardMonitor::cardInserted, this, &CardReader::onMonitorCardInserted);
+    connect(m_statusMonitor, &CardMonitor::cardRemoved, this, &CardReader::onMonitorCardRemoved);
+    connect(m_statusMonitor, &CardMonitor::readersChanged, this, &CardReader::onMonitorReadersChanged);
+    connect(m_statusMonitor, &CardMonitor::monitorError, this, &CardReader::onMonitorError);
+    m_statusMonitor->start();
+
+    qDebug() << "Событийный мониторинг карт запущен (SCardGetStatusChange)";
 }
 
 void CardReader::stopMonitoring()
 {
-    m_monitorTimer->stop();
+    if (m_statusMonitor) {
+        m_statusMonitor->stop();
+        delete m_statusMonitor;
+        m_statusMonitor = nullptr;
+    }
+    for (const QString &reader : m_workers.keys()) {
+        stopWorker(reader);
+    }
     qDebug() << "Мониторинг карт остановлен";
 }
 
-bool CardReader::checkCardStatusFor(ReaderState &rs)
+ReaderWorker *CardReader::startWorker(const QString &reader, int intervalMs)
 {
-    if (!rs.connected) return false;
-
-    BYTE readerName[256];
-    DWORD readerLen = sizeof(readerName);
-    DWORD state, protocol;
-    BYTE atr[MAX_ATR_SIZE];
-    DWORD atrLen = sizeof(atr);
-
-    LONG result = SCardStatus(
-        rs.handle,
-        reinterpret_cast<LPSTR>(readerName),
-        &readerLen,
-        &state,
-        &protocol,
-        atr,
-        &atrLen
-    );
+    auto it = m_workers.find(reader);
+    if (it != m_workers.end()) {
+        return it->worker;
+    }
 
-    if (result != SCARD_S_SUCCESS) {
-        // Нет карты — не ошибка
-        if (result == SCARD_W_REMOVED_CARD || result == SCARD_E_NO_SMARTCARD) {
-            return false;
+    WorkerThread wt;
+    wt.thread = new QThread(this);
+    wt.thread->setObjectName(reader);
+    wt.worker = new ReaderWorker(reader, *m_pcsc);
+    wt.worker->moveToThread(wt.thread);
+
+    connect(wt.worker, &ReaderWorker::cardInserted, this, &CardReader::onWorkerCardInserted);
+    connect(wt.worker, &ReaderWorker::cardRemoved, this, &CardReader::onWorkerCardRemoved);
+    connect(wt.worker, &ReaderWorker::workerError, this, &CardReader::onWorkerError);
+
+    wt.thread->start();
+    QMetaObject::invokeMethod(wt.worker, [w = wt.worker, intervalMs]() { w->start(intervalMs); },
+                              Qt::QueuedConnection);
+
+    m_workers.insert(reader, wt);
+    return wt.worker;
+}
+
+void CardReader::stopWorker(const QString &reader)
+{
+    auto it = m_workers.find(reader);
+    if (it == m_workers.end()) return;
+
+    WorkerThread wt = it.value();
+    m_workers.erase(it);
+
+    // Дожидаемся текущей операции воркера и освобождаем его контекст в его потоке
+    QMetaObject::invokeMethod(wt.worker, [w = wt.worker]() { w->shutdown(); },
+                              Qt::BlockingQueuedConnection);
+    wt.thread->quit();
+    wt.thread->wait();
+    delete wt.worker;
+    delete wt.thread;
+}
+
+void CardReader::onMonitorCardInserted(const QString &reader, const QVector<uint8_t> &atr)
+{
+    if (!m_statusMonitor) return;   // событие пришло после остановки
+
+    // ATS и разбор — в потоке воркера этого ридера
+    ReaderWorker *worker = startWorker(reader, 0);
+    const quint64 detectedAt = metrics::enabled() ? metrics::now() : 0;
+    QMetaObject::invokeMethod(worker,
+                              [worker, atr, detectedAt]() { worker->processInsertion(atr, detectedAt); },
+                              Qt::QueuedConnection);
+}
+
+void CardReader::onMonitorCardRemoved(const QString &reader)
+{
+    if (!m_statusMonitor) return;
+
+    // Через очередь воркера, чтобы извлечение не обогнало обработку вставки
+    auto it = m_workers.find(reader);
+    if (it == m_workers.end()) return;
+    ReaderWorker *worker = it->worker;
+    QMetaObject::invokeMethod(worker, [worker]() { worker->processRemoval(); },
+                              Qt::QueuedConnection);
+}
+
+void CardReader::onMonitorReadersChanged(const QStringList &readers)
+{
+    int removedCards = 0;
+    for (auto it = m_readers.begin(); it != m_readers.end();) {
+        if (readers.contains(it.key())) {
+            ++it;
+            continue;
         }
-        // Пробуем переподключиться молча
-        QByteArray rn = rs.name.toLocal8Bit();
-        SCardDisconnect(rs.handle, SCARD_LEAVE_CARD);
-        rs.connected = false;
-        rs.handle = 0;
-        DWORD proto = 0;
-        SCARDHANDLE h = 0;
-        if (SCardConnect(m_context, rn.constData(), SCARD_SHARE_SHARED,
-                         SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1,
-                         &h, &proto) == SCARD_S_SUCCESS) {
-            rs.handle = h;
-            rs.protocol = proto;
-            rs.connected = true;
+        if (it->connected) {
+            m_pcsc->disconnect(it->handle, SCARD_LEAVE_CARD);
         }
-        return false;
+        if (it.key() == m_currentReader) {
+            m_connected = false;
+            m_currentReader.clear();
+        }
+        if (it->cardPresent) ++removedCards;
+        it = m_readers.erase(it);
     }
+    for (const QString &r : m_workers.keys()) {
+        if (!readers.contains(r)) stopWorker(r);
+    }
+    // Извлечение от воркера отключённого ридера придёт уже после его
+    // остановки и будет отброшено — сообщаем о нём здесь
+    for (int i = 0; i < removedCards; ++i) {
+        emit cardRemoved();
+    }
+    for (const QString &r : readers) {
+        if (!m_readers.contains(r)) {
+            ReaderState rs;
+            rs.name = r;
+            m_readers.insert(r, rs);
+        }
+        startWorker(r, 0);
+    }
+    emit readersListChanged(readers);
+}
+
+void CardReader::onMonitorError(quint32 code)
+{
+    emit readerError(QString("Ошибка мониторинга PC/SC: %1").arg(getErrorString(static_cast<LONG>(code))));
+}
+
+void CardReader::onWorkerCardInserted(const QString &reader, const ATRData &cardInfo)
+{
+    // Воркер уже остановлен — результат устарел
+    if (!m_workers.contains(reader)) return;
 
-    return (state & SCARD_PRESENT) != 0;
+    auto it = m_readers.find(reader);
+    if (it != m_readers.end()) {
+        it->cardPresent = true;
+        it->lastATR = QVector<uint8_t>(cardInfo.rawAtr, cardInfo.rawAtr + cardInfo.atrLength);
+    }
+    emit cardInserted(cardInfo);
 }
 
-void CardReader::checkCardPresence()
+void CardReader::onWorkerCardRemoved(const QString &reader)
 {
-    // Обходим все ридеры и детектим изменения состояния
-    for (auto it = m_readers.begin(); it != m_readers.end(); ++it) {
-        ReaderState &rs = it.value();
-
-        if (!rs.connected) continue;
-
-        bool nowPresent = checkCardStatusFor(rs);
-
-        // Вставка
-        if (nowPresent && !rs.cardPresent) {
-            rs.cardPresent = true;
-            rs.lastATR = getATRFor(rs);
-
-            // Локальный парсер для формирования ATRData
-            ATRParser parser;
-            if (!rs.lastATR.isEmpty() && parser.parseATR(rs.lastATR)) {
-                // Попытка ATS
-                QVector<uint8_t> ats = getATS(); // при необходимости адаптируйте под конкретный ридер
-                if (!ats.isEmpty()) parser.parseATS(ats);
-                emit cardInserted(parser.getATRData());
-            } else {
-                emit cardInserted(ATRData{});
-            }
-        }
-        // Извлечение
-        else if (!nowPresent && rs.cardPresent) {
-            rs.cardPresent = false;
-            rs.lastATR.clear();
-            emit cardRemoved();
-        }
+    if (!m_workers.contains(reader)) return;
+
+    auto it = m_readers.find(reader);
+    if (it != m_readers.end()) {
+        it->cardPresent = false;
+        it->lastATR.clear();
     }
+    emit cardRemoved();
+}
+
+void CardReader::onWorkerError(const QString &reader, const QString &error)
+{
+    emit readerError(QString("Ридер '%1': %2").arg(reader, error));
 }
 
 QString CardReader::getErrorString(LONG result) const
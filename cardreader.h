@@ -4,7 +4,8 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
-#include <QTimer>
+#include <QThread>
+#include <QMap>
 
 #ifdef __APPLE__
 #include <PCSC/winscard.h>
@@ -14,6 +15,10 @@
 #endif
 
 #include "atrparser.h"
+#include "cardmonitor.h"
+#include "linknegotiator.h"
+#include "pcsctransport.h"
+#include "readerworker.h"
 
 class CardReader : public QObject
 {
@@ -22,6 +27,11 @@ class CardReader : public QObject
 public:
     explicit CardReader(QObject *parent = nullptr);
     ~CardReader();
+
+    // Реализация PC/SC для подключения, обмена и мониторинга (по умолчанию —
+    // системная winscard, для проверки без ридеров — PcscSimulator).
+    // Задаётся до initialize(); объект должен пережить CardReader.
+    void setTransport(PcscTransport *transport);
     
     // Инициализация и управление
     bool initialize();
@@ -32,16 +42,26 @@ public:
     bool connectToReader(const QString &readerName);
     void disconnect();
     
+    // Согласование канала при connectToReader() (по умолчанию выключено):
+    // протокол и PPS по TA1 в пределах скорости ридера, IFSD для T=1.
+    // Карта при этом может быть сброшена, см. linknegotiator.h
+    void setLinkNegotiation(bool enabled, const LinkOptions &options = LinkOptions());
+
     // Информация о подключении
     bool isConnected() const { return m_connected; }
     QString currentReader() const { return m_currentReader; }
+    // Результат согласования для активного ридера; attempted = false, если
+    // согласование выключено или ATR не разобран
+    LinkReport linkReport() const;
     
     // Работа с картой
     QVector<uint8_t> getATR();
     ATRData readCardInfo();
     QVector<uint8_t> getATS(); // чтение ATS
-    // Автоматическое обнаружение карт
-    void startMonitoring(int intervalMs = 1000);
+    // Автоматическое обнаружение карт. Каждый ридер обслуживается своим
+    // ReaderWorker в отдельном потоке; события приходят в поток CardReader.
+    void startMonitoring(int intervalMs = 1000);   // опрос SCardStatus по таймеру
+    void startEventMonitoring();                   // SCardGetStatusChange в отдельном потоке
     void stopMonitoring();
     
 signals:
@@ -51,7 +71,13 @@ signals:
     void readersListChanged(const QStringList &readers);
 
 private slots:
-    void checkCardPresence();
+    void onMonitorCardInserted(const QString &reader, const QVector<uint8_t> &atr);
+    void onMonitorCardRemoved(const QString &reader);
+    void onMonitorReadersChanged(const QStringList &readers);
+    void onMonitorError(quint32 code);
+    void onWorkerCardInserted(const QString &reader, const ATRData &cardInfo);
+    void onWorkerCardRemoved(const QString &reader);
+    void onWorkerError(const QString &reader, const QString &error);
 
 private:
     struct ReaderState {
@@ -61,7 +87,13 @@ private:
         bool connected = false;
         bool cardPresent = false;
         QVector<uint8_t> lastATR;
+        LinkReport link;
+    };
+    struct WorkerThread {
+        QThread *thread = nullptr;
+        ReaderWorker *worker = nullptr;
     };
+    PcscTransport *m_pcsc;
     SCARDCONTEXT m_context;
 //    SCARDHANDLE m_card;
 //    DWORD m_protocol;
@@ -69,19 +101,23 @@ private:
     bool m_initialized;
     bool m_connected;
     QString m_currentReader;
+    bool m_negotiateLink;
+    LinkOptions m_linkOptions;
     
-    QTimer *m_monitorTimer;
+    CardMonitor *m_statusMonitor;
+    QMap<QString, WorkerThread> m_workers;
 //    bool m_cardPresent;
     QVector<uint8_t> m_lastATR;
     
-    ATRParser m_parser;
     // Новое: состояние по всем ридерам
     QMap<QString, ReaderState> m_readers;
 
     // Вспомогательные методы
     QString getErrorString(LONG result) const;
-    bool checkCardStatusFor(ReaderState &rs);
     QVector<uint8_t> getATRFor(const ReaderState &rs);
+    QVector<uint8_t> getATSFor(const ReaderState &rs);
+    ReaderWorker *startWorker(const QString &reader, int intervalMs);
+    void stopWorker(const QString &reader);
 
 };
 
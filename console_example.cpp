@@ -3,6 +3,7 @@
 #include <QTimer>
 #include "cardreader.h"
 #include "atrparser.h"
+#include "atrformatter.h"
 
 class ConsoleCardReader : public QObject
 {
@@ -66,7 +67,7 @@ public:
         out << "Попытка чтения карты..." << Qt::endl;
         ATRData cardInfo = m_cardReader->readCardInfo();
         
-        if (!cardInfo.rawAtr.isEmpty()) {
+        if (cardInfo.atrLength > 0) {
             displayCardInfo(cardInfo);
         } else {
             out << "Карта не обнаружена в ридере" << Qt::endl;
@@ -111,17 +112,14 @@ private:
     {
         QTextStream out(stdout);
 
-        // Получаем красиво отформатированный вывод из парсера
-        ATRParser parser;
-        parser.parseATR(cardInfo.rawAtr);
-        if (cardInfo.hasATS)
-            parser.parseATS(cardInfo.atsRaw);
-        QString formattedOutput = parser.getFormattedOutput();
+        // Вывод строится по уже разобранному ATRData, буфер переиспользуется
+        ATRFormatter::renderHtml(cardInfo, m_renderBuffer);
 
-        out << formattedOutput << Qt::endl;
+        out << m_renderBuffer << Qt::endl;
     }
     
     CardReader *m_cardReader;
+    QString m_renderBuffer;
 };
 
 int main(int argc, char *argv[])
@@ -0,0 +1,205 @@
+// Fuzz-цель для ATRDecoder::parseATR()/parseATS() и ядра atrcore.h.
+//
+// Вход: первый байт — длина ATR (не больше остатка), затем ATR, затем ATS.
+// Кроме ошибок памяти (ASan/UBSan) цель проверяет инварианты разбора:
+//   - decode() и validate() одинаково видят обрыв цепочки interface bytes
+//     и неверный TCK;
+//   - interface bytes, исторические байты, группы и TCK лежат внутри входа;
+//   - ATRDecoder принимает ATR тогда и только тогда, когда decode()
+//     возвращает Ok, а в строгом режиме — ещё и без ошибок validate();
+//   - исторические байты ATS лежат внутри TL и сохранённого буфера;
+//   - linkTiming() не выходит за таблицы при любых ATR/ATS и частотах.
+// Нарушение — abort(), который libFuzzer и AFL считают падением.
+//
+// libFuzzer (clang):
+//   cmake -DATRPARSER_BUILD_FUZZERS=ON -DCMAKE_CXX_COMPILER=clang++ ...
+//   ./atrparser_fuzz -max_len=300 corpus/
+// AFL++ и воспроизведение входов — автономный main (ATRPARSER_FUZZ_STANDALONE,
+// включается автоматически для не-clang компиляторов):
+//   afl-fuzz -i seeds -o findings -- ./atrparser_fuzz @@
+
+#include "../atrcore.h"
+#include "../atrhistorical.h"
+#include "../atrlink.h"
+#include "../atrparser.h"
+#include "../atrrules.h"
+#include "../atrvalidate.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+
+#if defined(ATRPARSER_FUZZ_STANDALONE)
+#include <cstdio>
+#include <vector>
+#endif
+
+namespace {
+
+void check(bool condition)
+{
+    if (!condition) std::abort();
+}
+
+bool inside(std::span<const uint8_t> part, std::span<const uint8_t> whole)
+{
+    return part.data() >= whole.data() && part.data() + part.size() <= whole.data() + whole.size();
+}
+
+void checkHistorical(std::span<const uint8_t> bytes)
+{
+    const atr::HistoricalBytes hb(bytes);
+    hb.wellFormed();
+    for (uint8_t tag = 1; tag < 16; ++tag) {
+        const std::span<const uint8_t> v = hb.object(static_cast<atr::HistoricalTag>(tag));
+        check(v.empty() || inside(v, bytes));
+    }
+    atr::CardServiceData service;
+    atr::CardCapabilities capabilities;
+    atr::StatusIndicator status;
+    atr::PcscCardInfo card;
+    hb.serviceData(service);
+    hb.capabilities(capabilities);
+    hb.status(status);
+    hb.pcscCard(card);
+}
+
+// Ядро: decode() против validate() и границы частей ATR
+atr::Status checkCore(std::span<const uint8_t> in)
+{
+    atr::Atr a;
+    const atr::Status status = atr::decode(in, a);
+    const atr::Diagnostics diagnostics = atr::validate(in);
+
+    bool truncated = false;
+    bool mismatch = false;
+    for (const atr::Diagnostic &d : diagnostics) {
+        check(d.offset <= in.size());
+        truncated |= d.issue == atr::Issue::TruncatedInterface;
+        mismatch |= d.issue == atr::Issue::TckMismatch;
+    }
+
+    if (in.size() < 2 || in.size() > atr::kMaxAtrLength) {
+        check(status == (in.size() < 2 ? atr::Status::TooShort : atr::Status::TooLong));
+        check(diagnostics.count == 1);
+        return status;
+    }
+    if (status == atr::Status::InvalidTS) return status;
+    // Список нарушений ограничен; если он переполнен, последние могли потеряться
+    if (!diagnostics.overflow) check((status == atr::Status::TruncatedInterface) == truncated);
+    if (status != atr::Status::Ok) return status;
+
+    check(a.raw == in.data() && a.length == in.size());
+    check(2u + a.interfaceLength == a.historicalOffset);
+    check(a.historicalOffset + a.historicalLength <= a.length);
+    check(a.groupCount <= atr::kMaxInterfaceGroups);
+    std::size_t grouped = 0;
+    for (uint8_t i = 0; i < a.groupCount; ++i) grouped += std::popcount(unsigned(a.groups[i].present));
+    check(grouped <= a.interfaceLength);
+
+    const std::size_t tckIdx = a.historicalOffset + (a.t0 & 0x0F);
+    if (a.hasTck && tckIdx < a.length) {
+        check(a.tck == in[tckIdx]);
+        if (!diagnostics.overflow) check(a.tckValid == !mismatch);
+    }
+
+    checkHistorical(a.historical());
+    atr::identify(a);
+    const atr::LinkTiming link = atr::linkTiming(a, in[0] * 100000u, in[1] * 1000u);
+    check(link.pps.length <= sizeof(link.pps.bytes) && link.pps.needed == (link.pps.length != 0));
+    return status;
+}
+
+void checkDecoder(std::span<const uint8_t> in, atr::Status status)
+{
+    ATRDecoder decoder;
+    const ParseResult result = decoder.parseATR(in);
+    check(result.ok() == (status == atr::Status::Ok));
+    if (result) {
+        const ATRData &d = decoder.data();
+        check(d.atrLength == in.size() && std::memcmp(d.rawAtr, in.data(), in.size()) == 0);
+        check(inside(d.historical(), d.atr()));
+        for (int i = 0; i < d.groupCount; ++i) {
+            check(inside(d.interfaceGroup(i), d.atr()));
+        }
+        for (const atr::InterfaceBit bit : {atr::TA, atr::TB, atr::TC, atr::TD}) {
+            for (int i = 0, n = d.interfaceByteCount(bit); i < n; ++i) d.interfaceByte(bit, i);
+        }
+        d.cardName();
+        d.manufacturer();
+    }
+
+    ATRDecoder strict;
+    strict.setStrict(true);
+    const ParseResult strictResult = strict.parseATR(in);
+    const bool errors = strict.diagnostics().hasErrors();
+    check(strictResult.ok() == (status == atr::Status::Ok && !errors));
+    check(strictResult.offset <= atr::kMaxAtrLength);
+}
+
+void checkAts(std::span<const uint8_t> in)
+{
+    atr::Ats s;
+    const atr::Status status = atr::decodeAts(in, s);
+    if (status == atr::Status::Ok) {
+        check(s.length >= 1 && s.length <= in.size());
+        check(s.historicalOffset + s.historicalLength <= s.length);
+        checkHistorical(in.subspan(s.historicalOffset, s.historicalLength));
+        const atr::ContactlessTiming link = atr::linkTiming(s, in[0]);
+        check(link.fsc >= 16 && link.maxInfLength < link.fsc);
+    }
+
+    ATRDecoder decoder;
+    const ParseResult result = decoder.parseATS(in);
+    check(result.ok() == (status == atr::Status::Ok));
+    const ATRData &d = decoder.data();
+    check(d.hasATS == result.ok());
+    check(d.atsLength <= kMaxStoredAtsLength);
+    check(inside(d.atsHistorical(), d.ats()));
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size == 0) return 0;
+    const std::span<const uint8_t> input(data + 1, size - 1);
+    const std::size_t split = std::min<std::size_t>(data[0], input.size());
+    const std::span<const uint8_t> atr = input.first(split);
+    const std::span<const uint8_t> ats = input.subspan(split);
+
+    checkDecoder(atr, checkCore(atr));
+    checkAts(ats);
+    return 0;
+}
+
+#if defined(ATRPARSER_FUZZ_STANDALONE)
+// Файлы из командной строки по одному, без аргументов — stdin
+int main(int argc, char *argv[])
+{
+    auto run = [](std::FILE *f) {
+        std::vector<uint8_t> buffer;
+        uint8_t chunk[4096];
+        for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), f)) > 0;) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
+        }
+        LLVMFuzzerTestOneInput(buffer.data(), buffer.size());
+    };
+    if (argc < 2) {
+        run(stdin);
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::FILE *f = std::fopen(argv[i], "rb");
+        if (!f) {
+            std::fprintf(stderr, "Не удалось открыть %s\n", argv[i]);
+            return 1;
+        }
+        run(f);
+        std::fclose(f);
+    }
+    return 0;
+}
+#endif
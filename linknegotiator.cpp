@@ -0,0 +1,154 @@
+#include "linknegotiator.h"
+
+#include <cstring>
+
+namespace {
+
+// IFSD до S(IFS request): ISO/IEC 7816-3, 11.4.2
+constexpr uint16_t kDefaultIfsd = 32;
+
+bool sendPps(PcscTransport &pcsc, SCARDHANDLE handle, DWORD controlCode, const atr::PpsRequest &pps)
+{
+    BYTE response[8];
+    DWORD length = 0;
+    if (pcsc.control(handle, controlCode, pps.bytes, pps.length, response, sizeof(response), &length)
+        != SCARD_S_SUCCESS) {
+        return false;
+    }
+    // Согласие карты — полное эхо запроса (ISO/IEC 7816-3, 9.3)
+    return length == pps.length && std::memcmp(response, pps.bytes, pps.length) == 0;
+}
+
+// EDC блока T=1 при TC3 = CRC: ISO/IEC 7816-3, 11.4.4 (x^16 + x^12 + x^5 + 1,
+// начальное значение FFFF), старший байт первым — как в драйвере CCID
+uint16_t t1Crc(const BYTE *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+// Дописывает EDC к первым length байтам блока; возвращает длину блока с EDC
+DWORD appendEdc(BYTE *block, DWORD length, bool crc)
+{
+    if (!crc) {
+        BYTE lrc = 0;
+        for (DWORD i = 0; i < length; ++i) lrc ^= block[i];
+        block[length] = lrc;
+        return length + 1;
+    }
+    const uint16_t value = t1Crc(block, length);
+    block[length] = static_cast<BYTE>(value >> 8);
+    block[length + 1] = static_cast<BYTE>(value);
+    return length + 2;
+}
+
+// delivered = false, если ридер escape-команду не выполнил и блок до карты не дошёл
+bool sendIfsRequest(PcscTransport &pcsc, SCARDHANDLE handle, DWORD controlCode, uint8_t ifsd, bool crc,
+                    bool &delivered)
+{
+    // NAD PCB LEN INF EDC (LRC или CRC по TC3); ответ — S(IFS response) с тем же INF
+    BYTE block[6] = {0x00, 0xC1, 0x01, ifsd};
+    const DWORD blockLength = appendEdc(block, 4, crc);
+    BYTE response[8];
+    DWORD length = 0;
+    delivered = pcsc.control(handle, controlCode, block, blockLength, response, sizeof(response), &length)
+        == SCARD_S_SUCCESS;
+    if (!delivered || length != blockLength) {
+        return false;
+    }
+    BYTE expected[6] = {response[0], 0xE1, 0x01, ifsd};
+    appendEdc(expected, 4, crc);
+    return std::memcmp(response, expected, blockLength) == 0;
+}
+
+bool setIfsdAttribute(PcscTransport &pcsc, SCARDHANDLE handle, uint8_t ifsd)
+{
+    const BYTE value[4] = {ifsd, 0, 0, 0};
+    return pcsc.setAttrib(handle, pcsc::kAttrCurrentIfsd, value, sizeof(value)) == SCARD_S_SUCCESS;
+}
+
+} // namespace
+
+LinkReport negotiateLink(PcscTransport &pcsc, SCARDHANDLE handle, DWORD &protocol,
+                         std::span<const uint8_t> atr, const LinkOptions &options)
+{
+    LinkReport report;
+    report.protocol = protocol;
+
+    atr::Atr a;
+    if (atr::decode(atr, a) != atr::Status::Ok) return report;
+    report.attempted = true;
+
+    // Частоты в атрибутах — в кГц
+    uint32_t clockHz = pcsc::readAttribute(pcsc, handle, pcsc::kAttrCurrentClk) * 1000u;
+    if (!clockHz) clockHz = pcsc::readAttribute(pcsc, handle, pcsc::kAttrDefaultClk) * 1000u;
+    const uint32_t maxBaud = options.maxBaud ? options.maxBaud
+                                             : pcsc::readAttribute(pcsc, handle, pcsc::kAttrMaxDataRate);
+    const atr::LinkTiming &link = report.requested = atr::linkTiming(a, clockHz, maxBaud);
+    const DWORD wanted = link.protocol == 1 ? SCARD_PROTOCOL_T1 : SCARD_PROTOCOL_T0;
+
+    // В specific mode карта уже работает на параметрах TA2. Сброс с выбором
+    // протокола подтверждает только протокол: Fi/Di драйвер выбирает сам
+    bool speedConfirmed = !link.pps.needed;
+    if (link.pps.needed) {
+        if (protocol != wanted) {
+            // Протокол дескриптора меняет только драйвер: сброс и PPS с его стороны
+            report.ppsSent = true;
+            DWORD active = 0;
+            if (pcsc.reconnect(handle, SCARD_SHARE_SHARED, wanted, SCARD_RESET_CARD, &active)
+                == SCARD_S_SUCCESS) {
+                protocol = active;
+                report.ppsAccepted = active == wanted;
+                speedConfirmed = report.ppsAccepted && link.pps.fidi == 0x11;
+            }
+        } else if (options.ppsControlCode) {
+            report.ppsSent = true;
+            report.ppsAccepted = sendPps(pcsc, handle, options.ppsControlCode, link.pps);
+            speedConfirmed = report.ppsAccepted;
+        }
+    }
+    report.protocol = protocol;
+
+    if (protocol == SCARD_PROTOCOL_T1) {
+        uint32_t ifsd = options.ifsd ? options.ifsd : 254u;
+        const uint32_t readerMax = pcsc::readAttribute(pcsc, handle, pcsc::kAttrMaxIfsd);
+        if (readerMax && readerMax < ifsd) ifsd = readerMax;
+        if (ifsd > kDefaultIfsd) {
+            report.ifsdSent = true;
+            bool delivered = false;
+            if (options.ifsControlCode) {
+                report.ifsdAccepted = sendIfsRequest(pcsc, handle, options.ifsControlCode,
+                                                     static_cast<uint8_t>(ifsd), a.edcCrc, delivered);
+            }
+            // Ридер escape не знает — IFSD через атрибут; отказ карты не обходится
+            if (!delivered) report.ifsdAccepted = setIfsdAttribute(pcsc, handle, static_cast<uint8_t>(ifsd));
+        }
+        const uint32_t ifsc = pcsc::readAttribute(pcsc, handle, pcsc::kAttrCurrentIfsc);
+        const uint32_t current = pcsc::readAttribute(pcsc, handle, pcsc::kAttrCurrentIfsd);
+        report.ifsc = static_cast<uint16_t>(ifsc ? ifsc : link.ifsc);
+        report.ifsd = static_cast<uint16_t>(current ? current : report.ifsdAccepted ? ifsd : kDefaultIfsd);
+    }
+
+    // Итоговая скорость: атрибуты ридера, иначе — по результату PPS
+    const uint32_t currentClk = pcsc::readAttribute(pcsc, handle, pcsc::kAttrCurrentClk) * 1000u;
+    const uint32_t f = pcsc::readAttribute(pcsc, handle, pcsc::kAttrCurrentF);
+    const uint32_t d = pcsc::readAttribute(pcsc, handle, pcsc::kAttrCurrentD);
+    report.clockHz = currentClk ? currentClk : link.clockHz;
+    if (f && d) {
+        report.measured = true;
+        report.fi = static_cast<uint16_t>(f);
+        report.di = static_cast<uint8_t>(d);
+    } else if (speedConfirmed) {
+        // Без PPS — Fi/Di из TA2 (specific mode) или Fd/Dd; иначе остаётся Fd/Dd
+        report.fi = link.fi;
+        report.di = link.di;
+    }
+    report.baud = static_cast<uint32_t>(uint64_t(report.clockHz) * report.di / report.fi);
+    return report;
+}
@@ -0,0 +1,62 @@
+#ifndef LINKNEGOTIATOR_H
+#define LINKNEGOTIATOR_H
+
+// Согласование скорости и размера блоков контактного канала через PC/SC.
+// SCardConnect с T0|T1 оставляет выбор драйверу, и многие карты так и
+// работают на Fd/Dd (9600 бит/с при 3.57 МГц), хотя TA1 допускает в
+// 8-32 раза больше. negotiateLink() по ATR выбирает протокол и Fi/Di
+// (atr::linkTiming() с частотой и пределом скорости ридера), добивается
+// их там, где это позволяет драйвер, и сообщает, что получилось на деле.
+//
+// Что зависит от драйвера:
+//  - PPS из приложения стандартным вызовом не отправить: его выполняет
+//    драйвер при сбросе карты. Если нужен другой протокол, карта
+//    сбрасывается SCardReconnect с единственным этим протоколом; драйверы
+//    CCID при этом сами запрашивают TA1 в пределах скоростей ридера. Если
+//    протокол уже нужный, а Fi/Di нет, байты PPS можно отправить
+//    escape-командой ридера (ppsControlCode); эхо означает согласие карты.
+//  - S(IFS request) для T=1 отправляется escape-командой ifsControlCode,
+//    EDC блока — LRC или CRC, как указано в TC3 карты. Без неё или если ридер escape не выполнил, IFSD задаётся атрибутом
+//    CURRENT_IFSD, если драйвер его принимает.
+//  - Итог читается атрибутами CURRENT_CLK/F/D/IFSC/IFSD; если драйвер их
+//    не отдаёт, он выводится из результата шагов выше (measured = false).
+
+#include "atrlink.h"
+#include "pcsctransport.h"
+
+#include <cstdint>
+#include <span>
+
+struct LinkOptions {
+    uint32_t maxBaud = 0;          // предел скорости; 0 — SCARD_ATTR_MAX_DATA_RATE ридера
+    uint8_t ifsd = 254;            // запрашиваемый IFSD для T=1 (1..254)
+    DWORD ppsControlCode = 0;      // escape ридера, принимающий PPS; 0 — PPS при сбросе
+    DWORD ifsControlCode = 0;      // escape для блока S(IFS request); 0 — сразу атрибут
+};
+
+struct LinkReport {
+    bool attempted = false;        // ATR разобран, согласование выполнялось
+    atr::LinkTiming requested{};   // цель по ATR и пределам ридера
+
+    DWORD protocol = 0;            // активный протокол после согласования
+    bool ppsSent = false;          // PPS отправлен escape-командой или сбросом карты
+    bool ppsAccepted = false;
+    bool ifsdSent = false;
+    bool ifsdAccepted = false;
+
+    bool measured = false;         // Fi/Di прочитаны атрибутами ридера
+    uint32_t clockHz = 0;
+    uint16_t fi = 372;
+    uint8_t di = 1;
+    uint32_t baud = 0;             // эффективная скорость, бит/с
+    uint16_t ifsc = 0;             // T=1; 0 — неизвестен или T=0
+    uint16_t ifsd = 0;
+};
+
+// Согласует канал уже подключённой карты. protocol — активный протокол
+// дескриптора; при переподключении обновляется. Без разбираемого ATR
+// возвращает отчёт с attempted = false и ничего не трогает.
+LinkReport negotiateLink(PcscTransport &pcsc, SCARDHANDLE handle, DWORD &protocol,
+                         std::span<const uint8_t> atr, const LinkOptions &options = LinkOptions());
+
+#endif // LINKNEGOTIATOR_H
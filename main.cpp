@@ -12,6 +12,7 @@
 
 #include "cardreader.h"
 #include "atrparser.h"
+#include "atrformatter.h"
 
 class CardReaderWindow : public QMainWindow
 {
@@ -185,15 +186,13 @@ private:
     
     void displayCardInfo(const ATRData &cardInfo)
     {
-        // Получаем красиво отформатированный вывод из парсера
-        ATRParser parser;
-        parser.parseATR(cardInfo.rawAtr);
-        if (cardInfo.hasATS)
-            parser.parseATS(cardInfo.atsRaw);
-        QString formattedOutput = parser.getFormattedOutput();
+        // HTML строится по уже разобранному ATRData, буфер переиспользуется
+        ATRFormatter::renderHtml(cardInfo, m_renderBuffer);
+        m_renderBuffer.prepend(QLatin1String("<pre>"));
+        m_renderBuffer += QLatin1String("</pre>");
 
         // Выводим в текстовое поле с моноширинным шрифтом
-        m_infoText->append("<pre>" + formattedOutput + "</pre>");
+        m_infoText->append(m_renderBuffer);
     }
     
     QComboBox *m_readerCombo;
@@ -202,6 +201,7 @@ private:
     QPushButton *m_disconnectBtn;
     QPushButton *m_monitorBtn;
     QTextEdit *m_infoText;
+    QString m_renderBuffer;
     
     CardReader *m_cardReader;
 };
@@ -0,0 +1,509 @@
+#include "pcscsimulator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+// Псевдо-ридер, состояние которого меняется при подключении/отключении ридеров
+const char kPnPNotification[] = "\\\\?PnP?\\Notification";
+
+// Биты состояния, изменение которых считается событием
+const DWORD kSignificantState = 0xFFFF0000 | SCARD_STATE_EMPTY | SCARD_STATE_PRESENT;
+
+const PcscSimulator::Bytes kGetAtsCommand = {0xFF, 0xCA, 0x36, 0x00, 0x00};
+const PcscSimulator::Bytes kUnknownCommand = {0x6D, 0x00};
+
+} // namespace
+
+PcscSimulator::Card PcscSimulator::Card::contactless(const Bytes &atr, const Bytes &ats)
+{
+    Card card;
+    card.atr = atr;
+    card.protocols = SCARD_PROTOCOL_T1;
+    Bytes response = ats;
+    response.push_back(0x90);
+    response.push_back(0x00);
+    card.responses[kGetAtsCommand] = response;
+    return card;
+}
+
+PcscSimulator::PcscSimulator(uint32_t seed)
+    : m_random(seed)
+{
+}
+
+void PcscSimulator::addReader(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    apply(Event{EventType::ReaderAttached, name, {}});
+    m_changed.notify_all();
+}
+
+void PcscSimulator::removeReader(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    apply(Event{EventType::ReaderDetached, name, {}});
+    m_changed.notify_all();
+}
+
+void PcscSimulator::insertCard(const std::string &reader, const Card &card)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    apply(Event{EventType::CardInserted, reader, card});
+    m_changed.notify_all();
+}
+
+void PcscSimulator::removeCard(const std::string &reader)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    apply(Event{EventType::CardRemoved, reader, {}});
+    m_changed.notify_all();
+}
+
+void PcscSimulator::setAttribute(const std::string &reader, DWORD attrId, uint32_t value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_readers.find(reader);
+    if (it != m_readers.end()) it->second.attributes[attrId] = value;
+}
+
+void PcscSimulator::setControlResponse(const std::string &reader, DWORD controlCode, const Bytes &command,
+                                       const Bytes &response)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_readers.find(reader);
+    if (it != m_readers.end()) it->second.escapes[{controlCode, command}] = response;
+}
+
+void PcscSimulator::schedule(Clock::duration delay, const Event &event)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_schedule.emplace(Clock::now() + delay, event);
+    // Ожидающий getStatusChange() должен пересчитать срок пробуждения
+    m_changed.notify_all();
+}
+
+std::size_t PcscSimulator::pendingEvents() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_schedule.size();
+}
+
+void PcscSimulator::setLatency(Operation op, std::chrono::microseconds base, std::chrono::microseconds jitter)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latency[static_cast<std::size_t>(op)] = Latency{base, jitter};
+}
+
+void PcscSimulator::setFailureRate(Operation op, LONG code, double probability)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Fault &fault = m_faults[static_cast<std::size_t>(op)];
+    fault.code = code;
+    fault.probability = probability;
+}
+
+void PcscSimulator::failNext(Operation op, LONG code, unsigned count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Fault &fault = m_faults[static_cast<std::size_t>(op)];
+    fault.forcedCode = code;
+    fault.forced = count;
+}
+
+uint64_t PcscSimulator::calls(Operation op) const
+{
+    return m_calls[static_cast<std::size_t>(op)].load(std::memory_order_relaxed);
+}
+
+uint64_t PcscSimulator::injectedFailures(Operation op) const
+{
+    return m_failures[static_cast<std::size_t>(op)].load(std::memory_order_relaxed);
+}
+
+LONG PcscSimulator::enter(Operation op)
+{
+    const std::size_t i = static_cast<std::size_t>(op);
+    m_calls[i].fetch_add(1, std::memory_order_relaxed);
+
+    LONG result = SCARD_S_SUCCESS;
+    std::chrono::microseconds delay(0);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Fault &fault = m_faults[i];
+        if (fault.forced > 0) {
+            --fault.forced;
+            result = fault.forcedCode;
+        } else if (fault.probability > 0.0
+                   && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < fault.probability) {
+            result = fault.code;
+        }
+        const Latency &latency = m_latency[i];
+        delay = latency.base;
+        if (latency.jitter.count() > 0) {
+            delay += std::chrono::microseconds(
+                std::uniform_int_distribution<long long>(0, latency.jitter.count())(m_random));
+        }
+    }
+    if (result != SCARD_S_SUCCESS) {
+        m_failures[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+    return result;
+}
+
+void PcscSimulator::applyDue(Clock::time_point now)
+{
+    bool applied = false;
+    while (!m_schedule.empty() && m_schedule.begin()->first <= now) {
+        apply(m_schedule.begin()->second);
+        m_schedule.erase(m_schedule.begin());
+        applied = true;
+    }
+    if (applied) m_changed.notify_all();
+}
+
+void PcscSimulator::apply(const Event &event)
+{
+    switch (event.type) {
+        case EventType::ReaderAttached:
+            if (m_readers.emplace(event.reader, Reader()).second) {
+                m_order.push_back(event.reader);
+                ++m_readerListVersion;
+            }
+            break;
+        case EventType::ReaderDetached:
+            if (m_readers.erase(event.reader)) {
+                m_order.erase(std::find(m_order.begin(), m_order.end(), event.reader));
+                ++m_readerListVersion;
+            }
+            break;
+        case EventType::CardInserted: {
+            auto it = m_readers.find(event.reader);
+            if (it == m_readers.end()) break;
+            Reader &reader = it->second;
+            // Замена без извлечения — два события, как у pcscd
+            reader.events = static_cast<uint16_t>(reader.events + (reader.present ? 2 : 1));
+            reader.present = true;
+            reader.card = event.card;
+            ++reader.insertion;
+            break;
+        }
+        case EventType::CardRemoved: {
+            auto it = m_readers.find(event.reader);
+            if (it == m_readers.end() || !it->second.present) break;
+            Reader &reader = it->second;
+            ++reader.events;
+            reader.present = false;
+            reader.card = Card();
+            break;
+        }
+    }
+}
+
+PcscSimulator::Reader *PcscSimulator::cardFor(SCARDHANDLE handle, LONG &result)
+{
+    auto h = m_handles.find(handle);
+    if (h == m_handles.end()) {
+        result = static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+        return nullptr;
+    }
+    auto it = m_readers.find(h->second.reader);
+    if (it == m_readers.end()) {
+        result = static_cast<LONG>(SCARD_E_READER_UNAVAILABLE);
+        return nullptr;
+    }
+    if (!it->second.present || it->second.insertion != h->second.insertion) {
+        result = static_cast<LONG>(SCARD_W_REMOVED_CARD);
+        return nullptr;
+    }
+    result = SCARD_S_SUCCESS;
+    return &it->second;
+}
+
+DWORD PcscSimulator::readerState(const Reader &reader) const
+{
+    return (DWORD(reader.events) << 16) | (reader.present ? SCARD_STATE_PRESENT : SCARD_STATE_EMPTY);
+}
+
+DWORD PcscSimulator::chooseProtocol(DWORD preferred, DWORD offered)
+{
+    // Как pcsc-lite без PPS: первый протокол карты, если ридер его допускает
+    const DWORD common = preferred & offered;
+    if (common & SCARD_PROTOCOL_T0) return SCARD_PROTOCOL_T0;
+    if (common & SCARD_PROTOCOL_T1) return SCARD_PROTOCOL_T1;
+    return 0;
+}
+
+LONG PcscSimulator::establishContext(DWORD, SCARDCONTEXT *context)
+{
+    if (LONG fault = enter(Operation::EstablishContext)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *context = m_nextContext++;
+    m_contexts[*context] = false;
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::releaseContext(SCARDCONTEXT context)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_contexts.erase(context) ? SCARD_S_SUCCESS : static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+}
+
+LONG PcscSimulator::listReaders(SCARDCONTEXT context, char *buffer, DWORD *length)
+{
+    if (LONG fault = enter(Operation::ListReaders)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_contexts.count(context)) return static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+    applyDue(Clock::now());
+    if (m_order.empty()) return static_cast<LONG>(SCARD_E_NO_READERS_AVAILABLE);
+
+    DWORD needed = 1;
+    for (const std::string &name : m_order) needed += static_cast<DWORD>(name.size() + 1);
+    if (!buffer) {
+        *length = needed;
+        return SCARD_S_SUCCESS;
+    }
+    if (*length < needed) {
+        *length = needed;
+        return static_cast<LONG>(SCARD_E_INSUFFICIENT_BUFFER);
+    }
+    char *p = buffer;
+    for (const std::string &name : m_order) {
+        std::memcpy(p, name.c_str(), name.size() + 1);
+        p += name.size() + 1;
+    }
+    *p = '\0';
+    *length = needed;
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::getStatusChange(SCARDCONTEXT context, DWORD timeoutMs,
+                                    SCARD_READERSTATE *states, DWORD count)
+{
+    if (LONG fault = enter(Operation::GetStatusChange)) return fault;
+
+    const Clock::time_point deadline = timeoutMs == INFINITE
+        ? Clock::time_point::max()
+        : Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        auto ctx = m_contexts.find(context);
+        if (ctx == m_contexts.end()) return static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+        if (ctx->second) {
+            ctx->second = false;
+            return static_cast<LONG>(SCARD_E_CANCELLED);
+        }
+
+        const Clock::time_point now = Clock::now();
+        applyDue(now);
+
+        bool changed = false;
+        for (DWORD i = 0; i < count; ++i) {
+            SCARD_READERSTATE &s = states[i];
+            DWORD event;
+            bool differs;
+            if (std::strcmp(s.szReader, kPnPNotification) == 0) {
+                event = DWORD(m_readerListVersion) << 16;
+                differs = (s.dwCurrentState >> 16) != m_readerListVersion;
+            } else {
+                auto it = m_readers.find(s.szReader);
+                if (it == m_readers.end()) {
+                    s.dwEventState = SCARD_STATE_UNKNOWN | SCARD_STATE_CHANGED | SCARD_STATE_IGNORE;
+                    s.cbAtr = 0;
+                    changed = true;
+                    continue;
+                }
+                const Reader &reader = it->second;
+                event = readerState(reader);
+                differs = s.dwCurrentState == SCARD_STATE_UNAWARE
+                       || (s.dwCurrentState & kSignificantState) != (event & kSignificantState);
+                const std::size_t atrLength = reader.present ? std::min(reader.card.atr.size(), sizeof(s.rgbAtr)) : 0;
+                if (atrLength) std::memcpy(s.rgbAtr, reader.card.atr.data(), atrLength);
+                s.cbAtr = static_cast<DWORD>(atrLength);
+            }
+            s.dwEventState = differs ? (event | SCARD_STATE_CHANGED) : event;
+            changed |= differs;
+        }
+        if (changed) return SCARD_S_SUCCESS;
+        if (now >= deadline) return static_cast<LONG>(SCARD_E_TIMEOUT);
+
+        const Clock::time_point wake = m_schedule.empty() ? deadline : std::min(deadline, m_schedule.begin()->first);
+        if (wake == Clock::time_point::max()) {
+            m_changed.wait(lock);
+        } else {
+            m_changed.wait_until(lock, wake);
+        }
+    }
+}
+
+LONG PcscSimulator::cancel(SCARDCONTEXT context)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_contexts.find(context);
+    if (it == m_contexts.end()) return static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+    it->second = true;
+    m_changed.notify_all();
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::connect(SCARDCONTEXT context, const char *reader, DWORD,
+                            DWORD preferredProtocols, SCARDHANDLE *handle, DWORD *activeProtocol)
+{
+    if (LONG fault = enter(Operation::Connect)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_contexts.count(context)) return static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+    applyDue(Clock::now());
+
+    auto it = m_readers.find(reader);
+    if (it == m_readers.end()) return static_cast<LONG>(SCARD_E_UNKNOWN_READER);
+    if (!it->second.present) return static_cast<LONG>(SCARD_E_NO_SMARTCARD);
+    const DWORD protocol = chooseProtocol(preferredProtocols, it->second.card.protocols);
+    if (!protocol) return static_cast<LONG>(SCARD_E_PROTO_MISMATCH);
+
+    *handle = m_nextHandle++;
+    *activeProtocol = protocol;
+    m_handles[*handle] = Handle{reader, it->second.insertion, protocol};
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::reconnect(SCARDHANDLE handle, DWORD, DWORD preferredProtocols,
+                              DWORD, DWORD *activeProtocol)
+{
+    if (LONG fault = enter(Operation::Reconnect)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    applyDue(Clock::now());
+
+    auto h = m_handles.find(handle);
+    if (h == m_handles.end()) return static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+    auto it = m_readers.find(h->second.reader);
+    if (it == m_readers.end()) return static_cast<LONG>(SCARD_E_READER_UNAVAILABLE);
+    if (!it->second.present) return static_cast<LONG>(SCARD_E_NO_SMARTCARD);
+    const DWORD protocol = chooseProtocol(preferredProtocols, it->second.card.protocols);
+    if (!protocol) return static_cast<LONG>(SCARD_E_PROTO_MISMATCH);
+
+    // После сброса дескриптор относится к текущей карте
+    h->second.insertion = it->second.insertion;
+    h->second.protocol = protocol;
+    *activeProtocol = protocol;
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::disconnect(SCARDHANDLE handle, DWORD)
+{
+    if (LONG fault = enter(Operation::Disconnect)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_handles.erase(handle) ? SCARD_S_SUCCESS : static_cast<LONG>(SCARD_E_INVALID_HANDLE);
+}
+
+LONG PcscSimulator::status(SCARDHANDLE handle, DWORD *state, DWORD *protocol, BYTE *atr, DWORD *atrLength)
+{
+    if (LONG fault = enter(Operation::Status)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    applyDue(Clock::now());
+
+    LONG result;
+    const Reader *reader = cardFor(handle, result);
+    if (!reader) return result;
+
+    if (state) *state = SCARD_PRESENT | SCARD_POWERED | SCARD_SPECIFIC;
+    if (protocol) *protocol = m_handles[handle].protocol;
+    const DWORD needed = static_cast<DWORD>(reader->card.atr.size());
+    if (atr) {
+        if (*atrLength < needed) {
+            *atrLength = needed;
+            return static_cast<LONG>(SCARD_E_INSUFFICIENT_BUFFER);
+        }
+        std::memcpy(atr, reader->card.atr.data(), needed);
+    }
+    *atrLength = needed;
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::transmit(SCARDHANDLE handle, DWORD, const BYTE *send, DWORD sendLength,
+                             BYTE *recv, DWORD *recvLength)
+{
+    if (LONG fault = enter(Operation::Transmit)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    applyDue(Clock::now());
+
+    LONG result;
+    const Reader *reader = cardFor(handle, result);
+    if (!reader) return result;
+
+    const auto it = reader->card.responses.find(Bytes(send, send + sendLength));
+    const Bytes &response = it != reader->card.responses.end() ? it->second : kUnknownCommand;
+    if (*recvLength < response.size()) {
+        *recvLength = static_cast<DWORD>(response.size());
+        return static_cast<LONG>(SCARD_E_INSUFFICIENT_BUFFER);
+    }
+    std::memcpy(recv, response.data(), response.size());
+    *recvLength = static_cast<DWORD>(response.size());
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::control(SCARDHANDLE handle, DWORD controlCode, const BYTE *in, DWORD inLength,
+                            BYTE *out, DWORD outSize, DWORD *outLength)
+{
+    if (LONG fault = enter(Operation::Control)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    applyDue(Clock::now());
+
+    if (outLength) *outLength = 0;
+    LONG result;
+    const Reader *reader = cardFor(handle, result);
+    if (!reader) return result;
+
+    // Незаданная escape-команда — как у драйвера, который её не знает
+    const auto it = reader->escapes.find({controlCode, Bytes(in, in + inLength)});
+    if (it == reader->escapes.end()) return static_cast<LONG>(SCARD_E_UNSUPPORTED_FEATURE);
+    const Bytes &response = it->second;
+    if (outSize < response.size()) return static_cast<LONG>(SCARD_E_INSUFFICIENT_BUFFER);
+    if (!response.empty()) std::memcpy(out, response.data(), response.size());
+    if (outLength) *outLength = static_cast<DWORD>(response.size());
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::getAttrib(SCARDHANDLE handle, DWORD attrId, BYTE *value, DWORD *length)
+{
+    if (LONG fault = enter(Operation::GetAttrib)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LONG result;
+    const Reader *reader = cardFor(handle, result);
+    if (!reader) return result;
+
+    const auto it = reader->attributes.find(attrId);
+    if (it == reader->attributes.end()) return static_cast<LONG>(SCARD_E_UNSUPPORTED_FEATURE);
+    if (value) {
+        if (*length < 4) {
+            *length = 4;
+            return static_cast<LONG>(SCARD_E_INSUFFICIENT_BUFFER);
+        }
+        for (int i = 0; i < 4; ++i) value[i] = static_cast<BYTE>(it->second >> (8 * i));
+    }
+    *length = 4;
+    return SCARD_S_SUCCESS;
+}
+
+LONG PcscSimulator::setAttrib(SCARDHANDLE handle, DWORD attrId, const BYTE *value, DWORD length)
+{
+    if (LONG fault = enter(Operation::SetAttrib)) return fault;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LONG result;
+    Reader *reader = cardFor(handle, result);
+    if (!reader) return result;
+
+    const auto it = reader->attributes.find(attrId);
+    if (it == reader->attributes.end() || length == 0 || length > 4) {
+        return static_cast<LONG>(SCARD_E_UNSUPPORTED_FEATURE);
+    }
+    uint32_t v = 0;
+    for (DWORD i = length; i > 0; --i) v = (v << 8) | value[i - 1];
+    it->second = v;
+    return SCARD_S_SUCCESS;
+}
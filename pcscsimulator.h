@@ -0,0 +1,182 @@
+#ifndef PCSCSIMULATOR_H
+#define PCSCSIMULATOR_H
+
+// Симулятор PC/SC в процессе: N ридеров, расписание вставок и извлечений
+// карт, подключения и отключения ридеров, задержки операций и инъекция
+// ошибок. Подставляется в CardReader через setTransport(), после чего
+// мониторинг (CardMonitor, ReaderWorker), чтение ATS и согласование
+// канала работают без pcscd и оборудования — например, для нагрузочной
+// проверки с сотнями ридеров (bench/monitor_load.cpp).
+//
+// Потокобезопасен: состояние защищено одним мьютексом, задержки
+// выдерживаются вне его. События расписания применяются при ближайшем
+// вызове любого метода, а getStatusChange() просыпается к сроку
+// следующего события. Поведение повторяет pcsc-lite: счётчик событий в
+// старшем слове состояния ридера (и у псевдо-ридера \\?PnP?\Notification —
+// при изменении списка), SCARD_W_REMOVED_CARD у дескриптора после смены карты.
+
+#include "pcsctransport.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+class PcscSimulator : public PcscTransport
+{
+public:
+    using Bytes = std::vector<uint8_t>;
+    using Clock = std::chrono::steady_clock;
+
+    // Карта: ATR, протоколы и ответы на APDU (по полному совпадению
+    // команды; на остальные — 6D 00)
+    struct Card {
+        Bytes atr;
+        DWORD protocols = SCARD_PROTOCOL_T1;
+        std::map<Bytes, Bytes> responses;
+
+        // Бесконтактная карта: ATS отдаётся на FF CA 36 00 00, как у ACR/NXP
+        static Card contactless(const Bytes &atr, const Bytes &ats);
+    };
+
+    enum class EventType {
+        CardInserted,
+        CardRemoved,
+        ReaderAttached,
+        ReaderDetached
+    };
+
+    struct Event {
+        EventType type;
+        std::string reader;
+        Card card;           // для CardInserted
+    };
+
+    // Операции для задержек, ошибок и счётчиков вызовов
+    enum class Operation {
+        EstablishContext,
+        ListReaders,
+        GetStatusChange,
+        Connect,
+        Reconnect,
+        Disconnect,
+        Status,
+        Transmit,
+        Control,
+        GetAttrib,
+        SetAttrib,
+        Count
+    };
+
+    // seed — для джиттера задержек и вероятностных ошибок
+    explicit PcscSimulator(uint32_t seed = 1);
+
+    // Немедленные изменения
+    void addReader(const std::string &name);
+    void removeReader(const std::string &name);
+    void insertCard(const std::string &reader, const Card &card);
+    void removeCard(const std::string &reader);
+    // Атрибут ридера для getAttrib(); setAttrib() меняет только заданные
+    void setAttribute(const std::string &reader, DWORD attrId, uint32_t value);
+    // Ответ на escape-команду controlCode с данными command (по полному
+    // совпадению); на незаданные control() отвечает SCARD_E_UNSUPPORTED_FEATURE
+    void setControlResponse(const std::string &reader, DWORD controlCode, const Bytes &command,
+                            const Bytes &response);
+
+    // Событие через delay от текущего момента
+    void schedule(Clock::duration delay, const Event &event);
+    std::size_t pendingEvents() const;
+
+    // Задержка каждого вызова op: base плюс равномерный джиттер [0, jitter]
+    void setLatency(Operation op, std::chrono::microseconds base,
+                    std::chrono::microseconds jitter = std::chrono::microseconds(0));
+    // Доля probability вызовов op завершается ошибкой code
+    void setFailureRate(Operation op, LONG code, double probability);
+    // Следующие count вызовов op завершатся ошибкой code
+    void failNext(Operation op, LONG code, unsigned count = 1);
+
+    uint64_t calls(Operation op) const;
+    uint64_t injectedFailures(Operation op) const;
+
+    // PcscTransport
+    LONG establishContext(DWORD scope, SCARDCONTEXT *context) override;
+    LONG releaseContext(SCARDCONTEXT context) override;
+    LONG listReaders(SCARDCONTEXT context, char *buffer, DWORD *length) override;
+    LONG getStatusChange(SCARDCONTEXT context, DWORD timeoutMs,
+                         SCARD_READERSTATE *states, DWORD count) override;
+    LONG cancel(SCARDCONTEXT context) override;
+    LONG connect(SCARDCONTEXT context, const char *reader, DWORD shareMode,
+                 DWORD preferredProtocols, SCARDHANDLE *handle, DWORD *activeProtocol) override;
+    LONG reconnect(SCARDHANDLE handle, DWORD shareMode, DWORD preferredProtocols,
+                   DWORD initialization, DWORD *activeProtocol) override;
+    LONG disconnect(SCARDHANDLE handle, DWORD disposition) override;
+    LONG status(SCARDHANDLE handle, DWORD *state, DWORD *protocol, BYTE *atr, DWORD *atrLength) override;
+    LONG transmit(SCARDHANDLE handle, DWORD protocol, const BYTE *send, DWORD sendLength,
+                  BYTE *recv, DWORD *recvLength) override;
+    LONG control(SCARDHANDLE handle, DWORD controlCode, const BYTE *in, DWORD inLength,
+                 BYTE *out, DWORD outSize, DWORD *outLength) override;
+    LONG getAttrib(SCARDHANDLE handle, DWORD attrId, BYTE *value, DWORD *length) override;
+    LONG setAttrib(SCARDHANDLE handle, DWORD attrId, const BYTE *value, DWORD length) override;
+
+private:
+    struct Reader {
+        bool present = false;
+        Card card;
+        uint32_t insertion = 0;    // номер вставленной карты, для дескрипторов
+        uint16_t events = 0;       // счётчик событий в старшем слове состояния
+        std::map<DWORD, uint32_t> attributes;
+        std::map<std::pair<DWORD, Bytes>, Bytes> escapes;
+    };
+    struct Handle {
+        std::string reader;
+        uint32_t insertion;
+        DWORD protocol;
+    };
+    struct Fault {
+        LONG code = SCARD_S_SUCCESS;
+        double probability = 0.0;
+        unsigned forced = 0;
+        LONG forcedCode = SCARD_S_SUCCESS;
+    };
+    struct Latency {
+        std::chrono::microseconds base{0};
+        std::chrono::microseconds jitter{0};
+    };
+
+    static constexpr std::size_t kOperations = static_cast<std::size_t>(Operation::Count);
+
+    // Счётчик, ошибка и задержка операции; задержка — вне мьютекса
+    LONG enter(Operation op);
+    void applyDue(Clock::time_point now);
+    void apply(const Event &event);
+    // Карта по дескриптору; nullptr и код ошибки, если дескриптор устарел
+    Reader *cardFor(SCARDHANDLE handle, LONG &result);
+    DWORD readerState(const Reader &reader) const;
+    static DWORD chooseProtocol(DWORD preferred, DWORD offered);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::mt19937 m_random;
+
+    std::map<std::string, Reader> m_readers;
+    std::vector<std::string> m_order;          // порядок для listReaders()
+    std::multimap<Clock::time_point, Event> m_schedule;
+    std::map<SCARDCONTEXT, bool> m_contexts;   // значение — ожидающий cancel()
+    std::map<SCARDHANDLE, Handle> m_handles;
+    uint16_t m_readerListVersion = 0;          // старшее слово состояния PnP
+    SCARDCONTEXT m_nextContext = 1;
+    SCARDHANDLE m_nextHandle = 1;
+
+    Fault m_faults[kOperations];
+    Latency m_latency[kOperations];
+    std::atomic<uint64_t> m_calls[kOperations] = {};
+    std::atomic<uint64_t> m_failures[kOperations] = {};
+};
+
+#endif // PCSCSIMULATOR_H
@@ -0,0 +1,104 @@
+#include "pcsctransport.h"
+
+namespace {
+
+class WinscardTransport : public PcscTransport
+{
+public:
+    LONG establishContext(DWORD scope, SCARDCONTEXT *context) override
+    {
+        return SCardEstablishContext(scope, nullptr, nullptr, context);
+    }
+
+    LONG releaseContext(SCARDCONTEXT context) override
+    {
+        return SCardReleaseContext(context);
+    }
+
+    LONG listReaders(SCARDCONTEXT context, char *buffer, DWORD *length) override
+    {
+        return SCardListReaders(context, nullptr, buffer, length);
+    }
+
+    LONG getStatusChange(SCARDCONTEXT context, DWORD timeoutMs,
+                         SCARD_READERSTATE *states, DWORD count) override
+    {
+        return SCardGetStatusChange(context, timeoutMs, states, count);
+    }
+
+    LONG cancel(SCARDCONTEXT context) override
+    {
+        return SCardCancel(context);
+    }
+
+    LONG connect(SCARDCONTEXT context, const char *reader, DWORD shareMode,
+                 DWORD preferredProtocols, SCARDHANDLE *handle, DWORD *activeProtocol) override
+    {
+        return SCardConnect(context, reader, shareMode, preferredProtocols, handle, activeProtocol);
+    }
+
+    LONG reconnect(SCARDHANDLE handle, DWORD shareMode, DWORD preferredProtocols,
+                   DWORD initialization, DWORD *activeProtocol) override
+    {
+        return SCardReconnect(handle, shareMode, preferredProtocols, initialization, activeProtocol);
+    }
+
+    LONG disconnect(SCARDHANDLE handle, DWORD disposition) override
+    {
+        return SCardDisconnect(handle, disposition);
+    }
+
+    LONG status(SCARDHANDLE handle, DWORD *state, DWORD *protocol, BYTE *atr, DWORD *atrLength) override
+    {
+        char readerName[256];
+        DWORD readerLen = sizeof(readerName);
+        return SCardStatus(handle, readerName, &readerLen, state, protocol, atr, atrLength);
+    }
+
+    LONG transmit(SCARDHANDLE handle, DWORD protocol, const BYTE *send, DWORD sendLength,
+                  BYTE *recv, DWORD *recvLength) override
+    {
+        const SCARD_IO_REQUEST *pci =
+            (protocol == SCARD_PROTOCOL_T0) ? SCARD_PCI_T0 :
+            (protocol == SCARD_PROTOCOL_T1) ? SCARD_PCI_T1 :
+            nullptr;
+        if (!pci) return static_cast<LONG>(SCARD_E_INVALID_PARAMETER);
+        return SCardTransmit(handle, pci, send, sendLength, nullptr, recv, recvLength);
+    }
+
+    LONG control(SCARDHANDLE handle, DWORD controlCode, const BYTE *in, DWORD inLength,
+                 BYTE *out, DWORD outSize, DWORD *outLength) override
+    {
+        return SCardControl(handle, controlCode, in, inLength, out, outSize, outLength);
+    }
+
+    LONG getAttrib(SCARDHANDLE handle, DWORD attrId, BYTE *value, DWORD *length) override
+    {
+        return SCardGetAttrib(handle, attrId, value, length);
+    }
+
+    LONG setAttrib(SCARDHANDLE handle, DWORD attrId, const BYTE *value, DWORD length) override
+    {
+        return SCardSetAttrib(handle, attrId, value, length);
+    }
+};
+
+} // namespace
+
+PcscTransport &PcscTransport::system()
+{
+    static WinscardTransport transport;
+    return transport;
+}
+
+uint32_t pcsc::readAttribute(PcscTransport &pcsc, SCARDHANDLE handle, DWORD attrId)
+{
+    BYTE value[8];
+    DWORD length = sizeof(value);
+    if (pcsc.getAttrib(handle, attrId, value, &length) != SCARD_S_SUCCESS || length == 0 || length > 4) {
+        return 0;
+    }
+    uint32_t v = 0;
+    for (DWORD i = length; i > 0; --i) v = (v << 8) | value[i - 1];
+    return v;
+}
@@ -0,0 +1,79 @@
+#ifndef PCSCTRANSPORT_H
+#define PCSCTRANSPORT_H
+
+// Точка подмены PC/SC. Все вызовы winscard (CardReader, CardMonitor,
+// ReaderWorker) идут через PcscTransport: по умолчанию это системная
+// библиотека (system()), а PcscSimulator (pcscsimulator.h) или своя
+// реализация позволяют проверять мониторинг, чтение ATS и согласование
+// канала без ридера. Методы повторяют SCard* и возвращают их коды.
+
+#ifdef __APPLE__
+#include <PCSC/winscard.h>
+#include <PCSC/wintypes.h>
+#else
+#include <winscard.h>
+#endif
+
+#include <cstdint>
+
+class PcscTransport
+{
+public:
+    virtual ~PcscTransport() = default;
+
+    // Системная winscard; объект живёт до конца процесса
+    static PcscTransport &system();
+
+    virtual LONG establishContext(DWORD scope, SCARDCONTEXT *context) = 0;
+    virtual LONG releaseContext(SCARDCONTEXT context) = 0;
+    // Multi-string, как у SCardListReaders; buffer == nullptr — только длина
+    virtual LONG listReaders(SCARDCONTEXT context, char *buffer, DWORD *length) = 0;
+    // Ожидание событий ридеров; timeoutMs = INFINITE — без таймаута
+    virtual LONG getStatusChange(SCARDCONTEXT context, DWORD timeoutMs,
+                                 SCARD_READERSTATE *states, DWORD count) = 0;
+    // Прерывает getStatusChange() в другом потоке
+    virtual LONG cancel(SCARDCONTEXT context) = 0;
+
+    virtual LONG connect(SCARDCONTEXT context, const char *reader, DWORD shareMode,
+                         DWORD preferredProtocols, SCARDHANDLE *handle, DWORD *activeProtocol) = 0;
+    virtual LONG reconnect(SCARDHANDLE handle, DWORD shareMode, DWORD preferredProtocols,
+                           DWORD initialization, DWORD *activeProtocol) = 0;
+    virtual LONG disconnect(SCARDHANDLE handle, DWORD disposition) = 0;
+
+    // ATR карты; atr == nullptr — только длина
+    virtual LONG status(SCARDHANDLE handle, DWORD *state, DWORD *protocol,
+                        BYTE *atr, DWORD *atrLength) = 0;
+    // PCI выбирается по protocol (SCARD_PROTOCOL_T0 / T1)
+    virtual LONG transmit(SCARDHANDLE handle, DWORD protocol, const BYTE *send, DWORD sendLength,
+                          BYTE *recv, DWORD *recvLength) = 0;
+    virtual LONG control(SCARDHANDLE handle, DWORD controlCode, const BYTE *in, DWORD inLength,
+                         BYTE *out, DWORD outSize, DWORD *outLength) = 0;
+
+    virtual LONG getAttrib(SCARDHANDLE handle, DWORD attrId, BYTE *value, DWORD *length) = 0;
+    virtual LONG setAttrib(SCARDHANDLE handle, DWORD attrId, const BYTE *value, DWORD length) = 0;
+};
+
+namespace pcsc {
+
+// Атрибуты ридера (PC/SC Part 3, 3.1.2): класс << 16 | тег. Свои константы
+// вместо SCARD_ATTR_*: у pcsc-lite они в reader.h, в Windows — в winsmcrd.h
+constexpr DWORD attr(DWORD cls, DWORD tag) { return (cls << 16) | tag; }
+
+inline constexpr DWORD kAttrDefaultClk = attr(3, 0x0121);       // кГц
+inline constexpr DWORD kAttrMaxClk = attr(3, 0x0122);           // кГц
+inline constexpr DWORD kAttrDefaultDataRate = attr(3, 0x0123);  // бит/с
+inline constexpr DWORD kAttrMaxDataRate = attr(3, 0x0124);      // бит/с
+inline constexpr DWORD kAttrMaxIfsd = attr(3, 0x0125);
+inline constexpr DWORD kAttrCurrentProtocolType = attr(8, 0x0201);
+inline constexpr DWORD kAttrCurrentClk = attr(8, 0x0202);       // кГц
+inline constexpr DWORD kAttrCurrentF = attr(8, 0x0203);
+inline constexpr DWORD kAttrCurrentD = attr(8, 0x0204);
+inline constexpr DWORD kAttrCurrentIfsc = attr(8, 0x0207);
+inline constexpr DWORD kAttrCurrentIfsd = attr(8, 0x0208);
+
+// Числовой атрибут (1-4 байта, little-endian); 0 — драйвер его не отдаёт
+uint32_t readAttribute(PcscTransport &pcsc, SCARDHANDLE handle, DWORD attrId);
+
+} // namespace pcsc
+
+#endif // PCSCTRANSPORT_H
@@ -0,0 +1,219 @@
+#include "pipelinemetrics.h"
+
+#include <QIODevice>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+uint64_t Histogram::quantileNs(double q) const
+{
+    // Снимок без блокировки: корзины и count читаются не одновременно,
+    // поэтому ранг считается по сумме корзин
+    std::array<uint64_t, kBuckets> buckets;
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += buckets[i];
+    }
+    if (total == 0) return 0;
+
+    const double clamped = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+    uint64_t rank = static_cast<uint64_t>(std::ceil(clamped * static_cast<double>(total)));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(upperBound(i), maxNs());
+    }
+    return maxNs();
+}
+
+void Histogram::reset()
+{
+    for (auto &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+ReaderScope::ReaderScope(ReaderMetrics *&cache, const QString &reader)
+    : m_previous(detail::current)
+{
+    if (!enabled()) return;
+    if (!cache) cache = PipelineMetrics::instance().reader(reader);
+    detail::current = cache;
+}
+
+} // namespace metrics
+
+namespace {
+
+// Экранирование значения метки: \ " и перевод строки
+QByteArray labelValue(const QString &value)
+{
+    QByteArray out;
+    const QByteArray utf8 = value.toUtf8();
+    out.reserve(utf8.size());
+    for (char c : utf8) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+QByteArray seconds(uint64_t ns)
+{
+    return QByteArray::number(static_cast<double>(ns) / 1e9, 'g', 9);
+}
+
+} // namespace
+
+PipelineMetrics &PipelineMetrics::instance()
+{
+    static PipelineMetrics registry;
+    return registry;
+}
+
+void PipelineMetrics::setEnabled(bool enabled)
+{
+    metrics::detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+metrics::ReaderMetrics *PipelineMetrics::reader(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    std::unique_ptr<metrics::ReaderMetrics> &entry = m_readers[name];
+    if (!entry) entry = std::make_unique<metrics::ReaderMetrics>();
+    return entry.get();
+}
+
+QStringList PipelineMetrics::readers() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList names;
+    names.reserve(static_cast<int>(m_readers.size()));
+    for (const auto &entry : m_readers) names.append(entry.first);
+    return names;
+}
+
+const metrics::ReaderMetrics *PipelineMetrics::find(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_readers.find(name);
+    return it == m_readers.end() ? nullptr : it->second.get();
+}
+
+PipelineMetrics::StageSummary PipelineMetrics::stage(const QString &reader, metrics::Stage stage) const
+{
+    StageSummary summary{};
+    const metrics::ReaderMetrics *entry = find(reader);
+    if (!entry) return summary;
+    const metrics::Histogram &h = entry->stages[static_cast<std::size_t>(stage)];
+    summary.count = h.count();
+    summary.sumNs = h.sumNs();
+    summary.maxNs = h.maxNs();
+    summary.p50Ns = h.quantileNs(0.5);
+    summary.p90Ns = h.quantileNs(0.9);
+    summary.p99Ns = h.quantileNs(0.99);
+    summary.p999Ns = h.quantileNs(0.999);
+    return summary;
+}
+
+uint64_t PipelineMetrics::counter(const QString &reader, metrics::Counter counter) const
+{
+    const metrics::ReaderMetrics *entry = find(reader);
+    return entry ? entry->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed) : 0;
+}
+
+void PipelineMetrics::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto &entry : m_readers) {
+        for (auto &h : entry.second->stages) h.reset();
+        for (auto &c : entry.second->counters) c.store(0, std::memory_order_relaxed);
+    }
+}
+
+QByteArray PipelineMetrics::prometheusText() const
+{
+    static const struct {
+        double q;
+        const char *label;
+    } quantiles[] = {{0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}};
+
+    // Записи не удаляются, поэтому указатели можно читать без мьютекса
+    std::vector<std::pair<QByteArray, const metrics::ReaderMetrics *>> entries;
+    {
+        QMutexLocker locker(&m_mutex);
+        entries.reserve(m_readers.size());
+        for (const auto &entry : m_readers) entries.emplace_back(labelValue(entry.first), entry.second.get());
+    }
+
+    QByteArray out;
+    out += "# HELP atrparser_stage_latency_seconds Card read pipeline stage latency.\n"
+           "# TYPE atrparser_stage_latency_seconds summary\n";
+    for (const auto &[reader, entry] : entries) {
+        for (std::size_t s = 0; s < metrics::kStageCount; ++s) {
+            const metrics::Histogram &h = entry->stages[s];
+            const uint64_t count = h.count();
+            if (count == 0) continue;
+            const QByteArray labels = "reader=\"" + reader + "\",stage=\""
+                + metrics::stageId(static_cast<metrics::Stage>(s)) + "\"";
+            for (const auto &q : quantiles) {
+                out += "atrparser_stage_latency_seconds{" + labels + ",quantile=\"" + q.label + "\"} "
+                    + seconds(h.quantileNs(q.q)) + "\n";
+            }
+            out += "atrparser_stage_latency_seconds_sum{" + labels + "} " + seconds(h.sumNs()) + "\n";
+            out += "atrparser_stage_latency_seconds_count{" + labels + "} "
+                + QByteArray::number(static_cast<qulonglong>(count)) + "\n";
+        }
+    }
+
+    out += "# HELP atrparser_stage_latency_max_seconds Slowest observation per stage.\n"
+           "# TYPE atrparser_stage_latency_max_seconds gauge\n";
+    for (const auto &[reader, entry] : entries) {
+        for (std::size_t s = 0; s < metrics::kStageCount; ++s) {
+            const metrics::Histogram &h = entry->stages[s];
+            if (h.count() == 0) continue;
+            out += "atrparser_stage_latency_max_seconds{reader=\"" + reader + "\",stage=\""
+                + metrics::stageId(static_cast<metrics::Stage>(s)) + "\"} " + seconds(h.maxNs()) + "\n";
+        }
+    }
+
+    for (std::size_t c = 0; c < metrics::kCounterCount; ++c) {
+        const QByteArray name = QByteArray("atrparser_")
+            + metrics::counterId(static_cast<metrics::Counter>(c)) + "_total";
+        out += "# TYPE " + name + " counter\n";
+        for (const auto &[reader, entry] : entries) {
+            out += name + "{reader=\"" + reader + "\"} "
+                + QByteArray::number(static_cast<qulonglong>(entry->counters[c].load(std::memory_order_relaxed)))
+                + "\n";
+        }
+    }
+    return out;
+}
+
+bool PipelineMetrics::writePrometheus(QIODevice &device) const
+{
+    const QByteArray text = prometheusText();
+    return device.write(text) == text.size();
+}
+
+bool PipelineMetrics::dumpPrometheus(const QString &path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    if (!writePrometheus(file)) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
@@ -0,0 +1,275 @@
+#ifndef PIPELINEMETRICS_H
+#define PIPELINEMETRICS_H
+
+// Задержки по этапам чтения карты — от опроса SCardStatus или события
+// монитора до испускания cardInserted — и счётчики повторов APDU и
+// переподключений, по каждому ридеру. Гистограммы в стиле HDR:
+// логарифмические корзины по 16 линейных подкорзин, квантили с
+// погрешностью не больше 1/16, запись без блокировок.
+//
+// По умолчанию выключено: точка замера тогда стоит одну relaxed-загрузку
+// флага, часы не читаются. Замеры относятся к ридеру, выбранному
+// ReaderScope в потоке воркера; код вне воркера (ATRDecoder в пакетных
+// утилитах, бенчмарки) ничего не записывает. Заголовочная часть не
+// требует pipelinemetrics.cpp — он нужен только для PipelineMetrics.
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+class QIODevice;
+
+namespace metrics {
+
+enum class Stage : uint8_t {
+    StatusPoll,     // SCardStatus в опросе воркера
+    Connect,        // SCardConnect воркера
+    ReadAtr,        // чтение ATR
+    AtsApdu,        // одна попытка GET DATA (ATS)
+    ReadAts,        // все попытки чтения ATS
+    ParseAtr,       // ATRDecoder::parseATR, включая Classify
+    Classify,       // определение типа по базе и правилам
+    ParseAts,
+    Dispatch,       // событие монитора в CardReader -> начало обработки в воркере
+    Insertion,      // обнаружение карты (опрос или событие) -> cardInserted
+    Count
+};
+
+enum class Counter : uint8_t {
+    Polls,              // опросы SCardStatus
+    Reconnects,         // переподключения воркера после потери дескриптора
+    ReconnectFailures,
+    ApduAttempts,       // APDU GET DATA (ATS)
+    ApduRetries,        // попытки после первой
+    Insertions,
+    Removals,
+    Count
+};
+
+inline constexpr std::size_t kStageCount = static_cast<std::size_t>(Stage::Count);
+inline constexpr std::size_t kCounterCount = static_cast<std::size_t>(Counter::Count);
+
+// Идентификаторы для меток Prometheus
+inline const char *stageId(Stage stage)
+{
+    switch (stage) {
+        case Stage::StatusPoll: return "status_poll";
+        case Stage::Connect: return "connect";
+        case Stage::ReadAtr: return "read_atr";
+        case Stage::AtsApdu: return "ats_apdu";
+        case Stage::ReadAts: return "read_ats";
+        case Stage::ParseAtr: return "parse_atr";
+        case Stage::Classify: return "classify";
+        case Stage::ParseAts: return "parse_ats";
+        case Stage::Dispatch: return "dispatch";
+        case Stage::Insertion: return "insertion";
+        case Stage::Count: break;
+    }
+    return "unknown";
+}
+
+inline const char *counterId(Counter counter)
+{
+    switch (counter) {
+        case Counter::Polls: return "polls";
+        case Counter::Reconnects: return "reconnects";
+        case Counter::ReconnectFailures: return "reconnect_failures";
+        case Counter::ApduAttempts: return "apdu_attempts";
+        case Counter::ApduRetries: return "apdu_retries";
+        case Counter::Insertions: return "insertions";
+        case Counter::Removals: return "removals";
+        case Counter::Count: break;
+    }
+    return "unknown";
+}
+
+// Монотонное время, нс
+inline uint64_t now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Гистограмма задержек в наносекундах: значения меньше 16 — точно, дальше
+// на каждую степень двойки 16 корзин. До 2^37 нс (137 с); больше — в
+// последнюю корзину. 4.3 КБ.
+class Histogram
+{
+public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr unsigned kSub = 1u << kSubBits;
+    static constexpr unsigned kMaxBits = 37;
+    static constexpr std::size_t kBuckets = (kMaxBits - kSubBits + 1) * kSub;
+
+    static constexpr std::size_t bucketOf(uint64_t ns)
+    {
+        if (ns < kSub) return static_cast<std::size_t>(ns);
+        if (ns >> kMaxBits) ns = (uint64_t(1) << kMaxBits) - 1;
+        const unsigned shift = static_cast<unsigned>(std::bit_width(ns)) - 1 - kSubBits;
+        return (shift + 1) * kSub + static_cast<std::size_t>((ns >> shift) - kSub);
+    }
+
+    // Наибольшее значение, попадающее в корзину
+    static constexpr uint64_t upperBound(std::size_t bucket)
+    {
+        if (bucket < kSub) return bucket;
+        const unsigned shift = static_cast<unsigned>(bucket / kSub) - 1;
+        return ((uint64_t(bucket % kSub + kSub) + 1) << shift) - 1;
+    }
+
+    void record(uint64_t ns)
+    {
+        m_buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t sumNs() const { return m_sum.load(std::memory_order_relaxed); }
+    uint64_t maxNs() const { return m_max.load(std::memory_order_relaxed); }
+    // Верхняя граница корзины, в которую попадает квантиль q; 0 — нет замеров
+    uint64_t quantileNs(double q) const;
+    void reset();
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+static_assert(Histogram::bucketOf(15) == 15 && Histogram::bucketOf(16) == 16);
+static_assert(Histogram::upperBound(Histogram::bucketOf(1000)) >= 1000);
+static_assert(Histogram::bucketOf(~uint64_t(0)) == Histogram::kBuckets - 1);
+
+struct ReaderMetrics {
+    std::array<Histogram, kStageCount> stages;
+    std::array<std::atomic<uint64_t>, kCounterCount> counters{};
+};
+
+namespace detail {
+inline std::atomic<bool> enabled{false};
+inline thread_local ReaderMetrics *current = nullptr;
+} // namespace detail
+
+inline bool enabled()
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Метрики ридера текущего потока; nullptr — замеры выключены или потока нет в ReaderScope
+inline ReaderMetrics *current()
+{
+    return enabled() ? detail::current : nullptr;
+}
+
+inline void count(Counter counter, uint64_t n = 1)
+{
+    if (ReaderMetrics *m = current()) {
+        m->counters[static_cast<std::size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+inline void record(Stage stage, uint64_t ns)
+{
+    if (ReaderMetrics *m = current()) m->stages[static_cast<std::size_t>(stage)].record(ns);
+}
+
+// Замер этапа от конструктора до деструктора
+class StageTimer
+{
+public:
+    explicit StageTimer(Stage stage)
+        : m_metrics(current())
+        , m_stage(stage)
+        , m_start(m_metrics ? now() : 0)
+    {
+    }
+    ~StageTimer()
+    {
+        if (m_metrics) m_metrics->stages[static_cast<std::size_t>(m_stage)].record(now() - m_start);
+    }
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+    ReaderMetrics *m_metrics;
+    Stage m_stage;
+    uint64_t m_start;
+};
+
+// Привязка замеров потока к ридеру на время области видимости. cache —
+// поле воркера: запись ридера ищется в PipelineMetrics один раз, и только
+// если замеры включены.
+class ReaderScope
+{
+public:
+    ReaderScope(ReaderMetrics *&cache, const QString &reader);
+    ~ReaderScope() { detail::current = m_previous; }
+    ReaderScope(const ReaderScope &) = delete;
+    ReaderScope &operator=(const ReaderScope &) = delete;
+
+private:
+    ReaderMetrics *m_previous;
+};
+
+} // namespace metrics
+
+// Реестр метрик по ридерам: включение, запросы и экспорт в текстовом
+// формате Prometheus (summary с квантилями 0.5/0.9/0.99/0.999 и счётчики)
+class PipelineMetrics
+{
+public:
+    static PipelineMetrics &instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return metrics::enabled(); }
+
+    // Запись ридера; создаётся при первом обращении и живёт до конца процесса
+    metrics::ReaderMetrics *reader(const QString &name);
+    QStringList readers() const;
+
+    struct StageSummary {
+        uint64_t count;
+        uint64_t sumNs;
+        uint64_t maxNs;
+        uint64_t p50Ns;
+        uint64_t p90Ns;
+        uint64_t p99Ns;
+        uint64_t p999Ns;
+    };
+    StageSummary stage(const QString &reader, metrics::Stage stage) const;
+    uint64_t counter(const QString &reader, metrics::Counter counter) const;
+
+    // Обнуляет значения; записи ридеров остаются
+    void reset();
+
+    QByteArray prometheusText() const;
+    // Для сокета (QLocalSocket, QTcpSocket) или любого открытого устройства
+    bool writePrometheus(QIODevice &device) const;
+    // Атомарная запись файла, например для textfile collector node_exporter
+    bool dumpPrometheus(const QString &path) const;
+
+private:
+    PipelineMetrics() = default;
+
+    const metrics::ReaderMetrics *find(const QString &name) const;
+
+    mutable QMutex m_mutex;
+    std::map<QString, std::unique_ptr<metrics::ReaderMetrics>> m_readers;
+};
+
+#endif // PIPELINEMETRICS_H
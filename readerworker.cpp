@@ -0,0 +1,302 @@
+#include "readerworker.h"
+#include "atrcore.h"
+#include "atrresultcache.h"
+#include "atsprobecache.h"
+#include <QDebug>
+
+ReaderWorker::ReaderWorker(const QString &readerName, PcscTransport &pcsc, QObject *parent)
+    : QObject(parent)
+    , m_readerName(readerName)
+    , m_pcsc(pcsc)
+    , m_context(0)
+    , m_hasContext(false)
+    , m_handle(0)
+    , m_protocol(0)
+    , m_connected(false)
+    , m_cardPresent(false)
+    , m_metrics(nullptr)
+    , m_detectedAt(0)
+{
+    // Дочерний таймер переезжает в поток воркера вместе с ним
+    m_pollTimer = new QTimer(this);
+    connect(m_pollTimer, &QTimer::timeout, this, &ReaderWorker::poll);
+}
+
+ReaderWorker::~ReaderWorker()
+{
+    shutdown();
+}
+
+void ReaderWorker::start(int intervalMs)
+{
+    metrics::ReaderScope scope(m_metrics, m_readerName);
+    if (!m_hasContext) {
+        LONG result = m_pcsc.establishContext(SCARD_SCOPE_SYSTEM, &m_context);
+        if (result != SCARD_S_SUCCESS) {
+            emit workerError(m_readerName, QString("Ошибка инициализации PC/SC: 0x%1")
+                .arg(QString::number(static_cast<DWORD>(result), 16)));
+            return;
+        }
+        m_hasContext = true;
+    }
+
+    // Ошибка подключения не критична: карты может не быть, повторим при опросе
+    reconnect();
+
+    if (intervalMs > 0) {
+        // Начальное состояние: карта, уже лежащая в ридере, не считается вставкой
+        m_cardPresent = checkCardStatus();
+        m_lastATR = m_cardPresent ? readATR(m_handle, m_pcsc) : QVector<uint8_t>{};
+        m_pollTimer->start(intervalMs);
+    }
+}
+
+void ReaderWorker::shutdown()
+{
+    m_pollTimer->stop();
+    if (m_connected) {
+        m_pcsc.disconnect(m_handle, SCARD_LEAVE_CARD);
+        m_connected = false;
+        m_handle = 0;
+    }
+    if (m_hasContext) {
+        m_pcsc.releaseContext(m_context);
+        m_hasContext = false;
+    }
+}
+
+bool ReaderWorker::reconnect()
+{
+    if (m_connected) {
+        m_pcsc.disconnect(m_handle, SCARD_LEAVE_CARD);
+        m_connected = false;
+        m_handle = 0;
+    }
+    if (!m_hasContext) return false;
+
+    QByteArray rn = m_readerName.toLocal8Bit();
+    DWORD proto = 0;
+    SCARDHANDLE h = 0;
+    LONG result;
+    {
+        metrics::StageTimer timer(metrics::Stage::Connect);
+        result = m_pcsc.connect(m_context, rn.constData(), SCARD_SHARE_SHARED,
+                                SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1,
+                                &h, &proto);
+    }
+    if (result != SCARD_S_SUCCESS) {
+        return false;
+    }
+    m_handle = h;
+    m_protocol = proto;
+    m_connected = true;
+    return true;
+}
+
+bool ReaderWorker::checkCardStatus()
+{
+    if (!m_connected) {
+        // Без карты SCardConnect не проходит — пробуем на каждом опросе
+        if (!reconnect()) return false;
+    }
+
+    DWORD state, protocol;
+    DWORD atrLen = 0;
+    metrics::count(metrics::Counter::Polls);
+    LONG result;
+    {
+        metrics::StageTimer timer(metrics::Stage::StatusPoll);
+        result = m_pcsc.status(m_handle, &state, &protocol, nullptr, &atrLen);
+    }
+
+    if (result != SCARD_S_SUCCESS) {
+        // Нет карты — не ошибка
+        if (result == SCARD_W_REMOVED_CARD || result == SCARD_E_NO_SMARTCARD) {
+            // Дескриптор извлечённой карты остаётся недействительным и после
+            // вставки новой — закрываем его, следующий опрос подключится заново
+            if (result == SCARD_W_REMOVED_CARD) {
+                m_pcsc.disconnect(m_handle, SCARD_LEAVE_CARD);
+                m_connected = false;
+                m_handle = 0;
+            }
+            return false;
+        }
+        // Дескриптор потерян (сброс карты, перезапуск pcscd) — пробуем
+        // переподключиться молча. Считаются только такие переподключения,
+        // а не попытки подключиться к пустому ридеру
+        metrics::count(metrics::Counter::Reconnects);
+        if (!reconnect()) metrics::count(metrics::Counter::ReconnectFailures);
+        return false;
+    }
+
+    return (state & SCARD_PRESENT) != 0;
+}
+
+void ReaderWorker::poll()
+{
+    metrics::ReaderScope scope(m_metrics, m_readerName);
+    // Вставка, замеченная опросом, отсчитывается от его начала
+    m_detectedAt = metrics::current() ? metrics::now() : 0;
+    bool nowPresent = checkCardStatus();
+
+    // Вставка
+    if (nowPresent && !m_cardPresent) {
+        m_cardPresent = true;
+        m_lastATR = readATR(m_handle, m_pcsc);
+        reportCard();
+    }
+    // Извлечение
+    else if (!nowPresent && m_cardPresent) {
+        m_cardPresent = false;
+        m_lastATR.clear();
+        metrics::count(metrics::Counter::Removals);
+        emit cardRemoved(m_readerName);
+    }
+}
+
+void ReaderWorker::processInsertion(const QVector<uint8_t> &atr, quint64 detectedAt)
+{
+    metrics::ReaderScope scope(m_metrics, m_readerName);
+    m_detectedAt = metrics::current() ? detectedAt : 0;
+    if (m_detectedAt) metrics::record(metrics::Stage::Dispatch, metrics::now() - m_detectedAt);
+
+    m_cardPresent = true;
+    m_lastATR = atr;
+
+    // Новая карта — нужен свежий дескриптор для APDU (ATR уже известен из события)
+    reconnect();
+    reportCard();
+}
+
+void ReaderWorker::processRemoval()
+{
+    if (!m_cardPresent) return;
+
+    metrics::ReaderScope scope(m_metrics, m_readerName);
+    m_cardPresent = false;
+    m_lastATR.clear();
+    metrics::count(metrics::Counter::Removals);
+    emit cardRemoved(m_readerName);
+}
+
+void ReaderWorker::reportCard()
+{
+    metrics::count(metrics::Counter::Insertions);
+    if (m_lastATR.isEmpty()) {
+        emit cardInserted(m_readerName, ATRData{});
+        return;
+    }
+
+    // Повторное касание известной карты — хэш и копия указателя из общего
+    // кэша; разбор (ATRDecoder в потоке воркера) только при промахе
+    const QVector<uint8_t> ats = m_connected ? readATS(m_handle, m_protocol, m_readerName, m_pcsc)
+                                             : QVector<uint8_t>{};
+    const ATRResultCache::Entry result = ATRResultCache::instance().parse(
+        std::span<const uint8_t>(m_lastATR.constData(), static_cast<size_t>(m_lastATR.size())),
+        std::span<const uint8_t>(ats.constData(), static_cast<size_t>(ats.size())));
+    if (m_detectedAt) metrics::record(metrics::Stage::Insertion, metrics::now() - m_detectedAt);
+    emit cardInserted(m_readerName, result ? *result : ATRData{});
+}
+
+QVector<uint8_t> ReaderWorker::readATR(SCARDHANDLE handle, PcscTransport &pcsc)
+{
+    QVector<uint8_t> atr;
+
+    BYTE atrBuffer[MAX_ATR_SIZE];
+    DWORD atrLen = sizeof(atrBuffer);
+    DWORD state, protocol;
+
+    metrics::StageTimer timer(metrics::Stage::ReadAtr);
+    LONG result = pcsc.status(handle, &state, &protocol, atrBuffer, &atrLen);
+
+    if (result != SCARD_S_SUCCESS) {
+        return atr;
+    }
+
+    return QVector<uint8_t>(atrBuffer, atrBuffer + atrLen);
+}
+
+QVector<uint8_t> ReaderWorker::readATS(SCARDHANDLE handle, DWORD protocol, const QString &readerName,
+                                       PcscTransport &pcsc)
+{
+    QVector<uint8_t> ats;
+
+    // SCardTransmit требует корректный PCI по протоколу
+    if (protocol != SCARD_PROTOCOL_T0 && protocol != SCARD_PROTOCOL_T1) return ats;
+    metrics::StageTimer total(metrics::Stage::ReadAts);
+
+    // GET DATA (ATS) команда в PC/SC:
+    // Команда: FF CA 01 00 00 — НЕ правильная для ATS, это UID.
+    // Для ATS используем: FF CA 36 00 00? — тоже неверно.
+    // Корректно: команда ISO7816-4 GET DATA с P1P2=0x9F 0x7F, но через vendor escape не всегда доступна.
+    // На практике для 14443-4 (contactless) часто доступна команда:
+    //   FF CA 01 00 00 — UID; ATS может быть по: FF CA 36 00 00 (NXP) или команда 0xCA GET DATA P1=0x01(P2=0x00) не стандарт.
+    // Универсальный способ через PC/SC: SCardTransmit с APDU: 00 CA 01 00 00 — GET DATA (ATS) по P1=0x01?
+    // В большинстве ридеров ожидаемый тег ATS — 0x36 (proprietary). Надежнее запрос по GET DATA tag 0x36:
+    //   APDU: FF CA 36 00 00
+    // Реализации различаются, поэтому попробуем несколько известных вариантов по очереди.
+
+    // UID-команда FF CA 00 00 00 / FF CA 01 00 00 сюда не входит: её ответ —
+    // не ATS. Номер APDU сохраняется в AtsProbeCache, поэтому при любом
+    // изменении списка увеличивается AtsProbeCache::kProbeListVersion
+    static const QByteArray apdus[] = {
+        QByteArray::fromHex("00CA017F00"), // GET DATA P1=0x01,P2=0x7F (некоторые стекы)
+        QByteArray::fromHex("00CA9F7F00"), // GET DATA P1P2=0x9F7F (ATS tag)
+        QByteArray::fromHex("FFCA360000")  // Vendor GET DATA ATS (часто для ACR/NXP)
+    };
+    const int probeCount = static_cast<int>(sizeof(apdus) / sizeof(apdus[0]));
+
+    // Сначала вариант, который уже срабатывал на этой модели ридера
+    AtsProbeCache &cache = AtsProbeCache::instance();
+    const int preferred = readerName.isEmpty() ? -1 : cache.preferredProbe(readerName);
+
+    BYTE recvBuf[512];
+    int attempts = 0;
+    for (int n = -1; n < probeCount; ++n) {
+        int probe = n;
+        if (n < 0) {
+            if (preferred < 0 || preferred >= probeCount) continue;
+            probe = preferred;
+        } else if (n == preferred) {
+            continue;   // уже пробовали
+        }
+        const QByteArray &apdu = apdus[probe];
+
+        DWORD recvLen = sizeof(recvBuf);
+        metrics::count(metrics::Counter::ApduAttempts);
+        if (attempts++ > 0) metrics::count(metrics::Counter::ApduRetries);
+        LONG r;
+        {
+            metrics::StageTimer timer(metrics::Stage::AtsApdu);
+            r = pcsc.transmit(handle,
+                              protocol,
+                              reinterpret_cast<const BYTE*>(apdu.constData()),
+                              static_cast<DWORD>(apdu.size()),
+                              recvBuf,
+                              &recvLen);
+        }
+        if (r != SCARD_S_SUCCESS || recvLen < 2)
+            continue;
+
+        BYTE sw1 = recvBuf[recvLen - 2];
+        BYTE sw2 = recvBuf[recvLen - 1];
+        if (sw1 != 0x90 || sw2 != 0x00)
+            continue;
+
+        DWORD dataLen = recvLen - 2;
+        // 90 00 с данными — ещё не ATS: принимается только ответ, который
+        // разбирается как ATS и у которого TL равен длине
+        atr::Ats parsed;
+        if (dataLen == 0 || recvBuf[0] != dataLen
+            || atr::decodeAts(std::span<const uint8_t>(recvBuf, dataLen), parsed) != atr::Status::Ok)
+            continue;
+
+        ats = QVector<uint8_t>(recvBuf, recvBuf + dataLen);
+
+        if (!readerName.isEmpty())
+            cache.recordSuccess(readerName, probe);
+        break; // успешно получили ATS
+    }
+
+    return ats;
+}
@@ -0,0 +1,83 @@
+#ifndef READERWORKER_H
+#define READERWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QTimer>
+
+#ifdef __APPLE__
+#include <PCSC/winscard.h>
+#include <PCSC/wintypes.h>
+#else
+#include <winscard.h>
+#endif
+
+#include "atrparser.h"
+#include "pcsctransport.h"
+#include "pipelinemetrics.h"
+
+// Обслуживание одного ридера в отдельном потоке.
+// У каждого воркера свой SCARDCONTEXT и свой дескриптор карты, поэтому
+// медленный ридер (ATS-пробы, таймауты бесконтактного интерфейса) не
+// задерживает остальные ридеры и GUI. Объект переносится в свой QThread
+// через moveToThread(), все слоты вызываются queued-соединениями,
+// результаты возвращаются сигналами.
+class ReaderWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReaderWorker(const QString &readerName, PcscTransport &pcsc = PcscTransport::system(),
+                          QObject *parent = nullptr);
+    ~ReaderWorker();
+
+    QString readerName() const { return m_readerName; }
+
+    // Низкоуровневые операции над дескриптором (используются и CardReader)
+    static QVector<uint8_t> readATR(SCARDHANDLE handle, PcscTransport &pcsc = PcscTransport::system());
+    // readerName — для кэша успешных APDU (AtsProbeCache); пустое имя отключает кэш
+    static QVector<uint8_t> readATS(SCARDHANDLE handle, DWORD protocol,
+                                    const QString &readerName = QString(),
+                                    PcscTransport &pcsc = PcscTransport::system());
+
+public slots:
+    // intervalMs > 0 — опрос SCardStatus по таймеру в потоке воркера;
+    // 0 — события приходят извне (CardMonitor) через processInsertion/processRemoval
+    void start(int intervalMs);
+    void shutdown();
+
+    void poll();
+    // detectedAt — metrics::now() при обнаружении карты монитором, 0 — неизвестно
+    void processInsertion(const QVector<uint8_t> &atr, quint64 detectedAt = 0);
+    void processRemoval();
+
+signals:
+    void cardInserted(const QString &reader, const ATRData &cardInfo);
+    void cardRemoved(const QString &reader);
+    void workerError(const QString &reader, const QString &error);
+
+private:
+    bool reconnect();
+    bool checkCardStatus();
+    void reportCard();
+
+    QString m_readerName;
+    PcscTransport &m_pcsc;
+    QTimer *m_pollTimer;
+
+    SCARDCONTEXT m_context;
+    bool m_hasContext;
+    SCARDHANDLE m_handle;
+    DWORD m_protocol;
+    bool m_connected;
+    bool m_cardPresent;
+    QVector<uint8_t> m_lastATR;
+
+    // Замеры задержек (PipelineMetrics): запись ридера, пока замеры не
+    // включены, не создаётся; m_detectedAt — начало вставки для Stage::Insertion
+    metrics::ReaderMetrics *m_metrics;
+    quint64 m_detectedAt;
+};
+
+#endif // READERWORKER_H
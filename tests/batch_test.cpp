@@ -0,0 +1,188 @@
+// Пакетная классификация: atr::classifyBatch() (SIMD-ядро) против эталона
+// classifyBatchScalar() и atr::checksumBatch() против побайтового XOR.
+//
+// Набор записей фиксированный: все имена карт PC/SC Part 3, короткая форма
+// 3B 8n 80 01 для каждого n, контактные карты и неправильные записи (битый
+// TCK, ненулевой RFU, совпадение шаблона при другой длине, обрезанные и
+// пустые). Он раскладывается по слотам разного шага: меньше 16 (только
+// скалярная проверка шаблонов), 16-31 (SIMD-сравнение, скалярный XOR),
+// 32 и больше (SIMD-свёртка XOR). Хвост каждого слота — мусор, буфер
+// выделяется точно по размеру, чтобы чтение за концом ловили санитайзеры.
+
+#include "../atrbatch.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+const Bytes kPcscPrefix = {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06};
+
+uint8_t xorOf(const uint8_t *p, std::size_t length)
+{
+    uint8_t x = 0;
+    for (std::size_t i = 1; i < length; ++i) x ^= p[i];
+    return x;
+}
+
+void appendTck(Bytes &atr)
+{
+    atr.push_back(xorOf(atr.data(), atr.size()));
+}
+
+Bytes pcscPart3(uint8_t standard, uint16_t name)
+{
+    Bytes atr = kPcscPrefix;
+    atr.insert(atr.end(), {standard, static_cast<uint8_t>(name >> 8), static_cast<uint8_t>(name), 0, 0, 0, 0});
+    appendTck(atr);
+    return atr;
+}
+
+Bytes shortForm(std::size_t historical)
+{
+    Bytes atr = {0x3B, static_cast<uint8_t>(0x80 | historical), 0x80, 0x01};
+    for (std::size_t i = 0; i < historical; ++i) atr.push_back(static_cast<uint8_t>(0x41 + i));
+    appendTck(atr);
+    return atr;
+}
+
+// Записи и длины в слотах; length может расходиться с размером записи
+struct Record {
+    Bytes bytes;
+    std::size_t length;
+};
+
+std::vector<Record> records()
+{
+    std::vector<Record> out;
+    auto add = [&out](const Bytes &bytes) { out.push_back({bytes, bytes.size()}); };
+
+    // PC/SC Part 3: известные и неизвестные имена, ISO 14443-A и FeliCa;
+    // повторы проверяют переиспользование результата внутри пакета
+    for (uint16_t name : {0x0001, 0x0002, 0x0003, 0x0026, 0x0036, 0x0037, 0x0038, 0x0039, 0x003A, 0x00FF}) {
+        add(pcscPart3(0x03, name));
+        add(pcscPart3(0x11, name));
+    }
+    add(pcscPart3(0x03, 0x0001));
+    Bytes badTck = pcscPart3(0x03, 0x0002);
+    badTck.back() ^= 0x5A;
+    add(badTck);
+    Bytes rfu = pcscPart3(0x03, 0x0003);
+    rfu[16] = 0x42;
+    rfu.back() = xorOf(rfu.data(), rfu.size() - 1);
+    add(rfu);
+    // Шаблон PC/SC Part 3 совпадает, длина — нет
+    for (std::size_t length : {12, 16, 19, 21, 32}) {
+        Bytes p = pcscPart3(0x03, 0x0001);
+        p.resize(std::max<std::size_t>(length, p.size()), 0x00);
+        out.push_back({p, length});
+    }
+
+    // Короткая форма для каждого числа исторических байтов, с битым TCK
+    // и с длиной, не совпадающей с T0
+    for (std::size_t n = 0; n < 16; ++n) add(shortForm(n));
+    Bytes shortBad = shortForm(4);
+    shortBad.back() ^= 0x01;
+    add(shortBad);
+    out.push_back({shortForm(3), shortForm(3).size() - 1});
+    out.push_back({shortForm(3), shortForm(3).size() + 1});
+
+    // Контактные карты (T=1 EMV, T=0, TS = 3F)
+    add({0x3B, 0xEF, 0x00, 0x00, 0x81, 0x31, 0xFE, 0x45, 0x65, 0x63, 0x11, 0x04, 0x50, 0x02, 0x80, 0x00, 0x08,
+         0x39, 0x00, 0x04, 0x02, 0x05, 0x02, 0xE7});
+    add({0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07});
+    add({0x3F, 0xFF, 0x95, 0x00, 0xFF, 0x91, 0x81, 0x71, 0xFE, 0x47, 0x00, 0x44, 0x4E, 0x41, 0x53, 0x50, 0x31,
+         0x31, 0x30, 0x20, 0x52, 0x65, 0x76, 0x41, 0x30, 0x36});
+
+    // Неправильные: пустая, один байт, неверный TS, обрезанная группа,
+    // 33 байта мусора
+    out.push_back({{}, 0});
+    add({0x3B});
+    add({0x00, 0x80, 0x80, 0x01, 0x00});
+    add({0x3B, 0xF0, 0x11});
+    Bytes noise(33);
+    std::mt19937 rng(3);
+    for (uint8_t &b : noise) b = static_cast<uint8_t>(rng());
+    add(noise);
+    return out;
+}
+
+bool sameString(const char *a, const char *b)
+{
+    return a == b || (a && b && std::strcmp(a, b) == 0);
+}
+
+void checkStride(const std::vector<Record> &set, std::size_t stride)
+{
+    // Нечётное число записей: у AVX2-ядра остаётся хвост по одной записи
+    const std::size_t count = set.size() | 1;
+    std::vector<uint8_t> atrs(count * stride);
+    std::vector<uint8_t> lengths(count);
+    std::mt19937 rng(static_cast<uint32_t>(stride));
+    for (uint8_t &b : atrs) b = static_cast<uint8_t>(rng());
+    for (std::size_t i = 0; i < count; ++i) {
+        const Record &r = set[i % set.size()];
+        if (!r.bytes.empty()) std::memcpy(&atrs[i * stride], r.bytes.data(), std::min(r.bytes.size(), stride));
+        lengths[i] = static_cast<uint8_t>(r.length);
+    }
+
+    const atr::CardDatabase &db = atr::CardDatabase::builtin();
+    const atr::RuleSet &rules = atr::RuleSet::builtin();
+    std::vector<atr::BatchRecord> fast(count), reference(count);
+    const atr::BatchStats stats = atr::classifyBatch(atrs.data(), stride, lengths.data(), count, db, rules, fast.data());
+    atr::classifyBatchScalar(atrs.data(), stride, lengths.data(), count, db, rules, reference.data());
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const atr::BatchRecord &a = fast[i];
+        const atr::BatchRecord &b = reference[i];
+        const bool equal = a.status == b.status
+            && (a.status != atr::Status::Ok
+                || (a.id.type == b.id.type && sameString(a.id.name, b.id.name)
+                    && sameString(a.id.manufacturer, b.id.manufacturer)
+                    && a.id.nameId == b.id.nameId && a.id.manufacturerId == b.id.manufacturerId));
+        if (!CHECK(equal)) {
+            std::fprintf(stderr, "  stride %zu, запись %zu: %s/%s против %s/%s\n", stride, i,
+                         atr::statusId(a.status), atr::cardTypeId(a.id.type),
+                         atr::statusId(b.status), atr::cardTypeId(b.id.type));
+        }
+    }
+
+    CHECK(stats.pcscPart3 + stats.contactless + stats.irregular == count);
+    if (stride < 16) {
+        // Шаблон не помещается в слот: всё через decode()
+        CHECK(stats.pcscPart3 == 0 && stats.contactless == 0);
+    } else {
+        CHECK(stats.contactless > 0);
+        if (stride >= 20) CHECK(stats.pcscPart3 > 0);
+    }
+
+    std::vector<uint8_t> x(count);
+    std::size_t invalid = 0;
+    const std::size_t reported = atr::checksumBatch(atrs.data(), stride, lengths.data(), count, x.data());
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint8_t expected = xorOf(&atrs[i * stride], std::min<std::size_t>(lengths[i], stride));
+        if (!CHECK(x[i] == expected)) {
+            std::fprintf(stderr, "  stride %zu, запись %zu: XOR %02X вместо %02X\n", stride, i, x[i], expected);
+        }
+        invalid += expected != 0;
+    }
+    CHECK(reported == invalid);
+    CHECK(atr::checksumBatch(atrs.data(), stride, lengths.data(), count, nullptr) == invalid);
+}
+
+} // namespace
+
+int main()
+{
+    const std::vector<Record> set = records();
+    for (std::size_t stride : {5, 8, 15, 16, 17, 20, 24, 31, 32, 33, 34, 40, 64}) {
+        checkStride(set, stride);
+    }
+    std::printf("Ядро: %s\n", atr::batchKernel());
+    return tests::exitCode();
+}
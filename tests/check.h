@@ -0,0 +1,36 @@
+#ifndef ATRPARSER_TESTS_CHECK_H
+#define ATRPARSER_TESTS_CHECK_H
+
+// Проверки для тестов ctest без внешних фреймворков: CHECK печатает место
+// и условие провала и продолжает тест; main возвращает tests::exitCode().
+
+#include <cstdio>
+
+namespace tests {
+
+inline int &failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool ok, const char *expression, const char *file, int line)
+{
+    if (!ok) {
+        std::fprintf(stderr, "%s:%d: не выполнено: %s\n", file, line, expression);
+        ++failures();
+    }
+    return ok;
+}
+
+inline int exitCode()
+{
+    if (failures()) std::fprintf(stderr, "Провалено проверок: %d\n", failures());
+    return failures() ? 1 : 0;
+}
+
+} // namespace tests
+
+#define CHECK(condition) ::tests::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+#endif // ATRPARSER_TESTS_CHECK_H
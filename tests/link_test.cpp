@@ -0,0 +1,249 @@
+// Согласование канала: negotiateLink() на PcscSimulator. Проверяются смена
+// протокола сбросом карты, PPS и S(IFS request) escape-командами ридера
+// (S-блок с LRC и с CRC), переход на атрибут CURRENT_IFSD, когда ридер
+// escape не знает, карты, которым PPS не нужен, и WT по Fi из TA1.
+
+#include "../linknegotiator.h"
+#include "../pcscsimulator.h"
+#include "check.h"
+
+namespace {
+
+using Bytes = PcscSimulator::Bytes;
+using Operation = PcscSimulator::Operation;
+
+const char kReader[] = "Sim Reader 0";
+
+// TA1 = 13 (Fi = 372, Di = 4), первым T=0, затем T=1: нужен PPS с T=1
+const Bytes kNegotiableAtr = {0x3B, 0x90, 0x13, 0x80, 0x01, 0x02};
+// Только T=1, без TA1: PPS не нужен
+const Bytes kT1Atr = {0x3B, 0x80, 0x01, 0x81};
+// Только T=1, TC3 = 01: EDC блоков — CRC
+const Bytes kT1CrcAtr = {0x3B, 0x80, 0x81, 0x41, 0x01, 0x41};
+// Только T=0, без TA1
+const Bytes kT0Atr = {0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07};
+// T=0, TA1 = 91 (Fi = 512, Di = 1: PPS не нужен), TC2 = 10 (WI)
+const Bytes kWaitingTimeAtr = {0x3B, 0x90, 0x91, 0x40, 0x0A};
+
+// PPSS PPS0 PPS1 PCK для kNegotiableAtr
+const Bytes kPps = {0xFF, 0x11, 0x13, 0xFD};
+// S(IFS request) и S(IFS response) с IFSD = 254: NAD PCB LEN INF LRC
+const Bytes kIfsRequest = {0x00, 0xC1, 0x01, 0xFE, 0x3E};
+const Bytes kIfsResponse = {0x00, 0xE1, 0x01, 0xFE, 0x1E};
+// Те же блоки с CRC (старший байт первым)
+const Bytes kIfsCrcRequest = {0x00, 0xC1, 0x01, 0xFE, 0x54, 0x4E};
+const Bytes kIfsCrcResponse = {0x00, 0xE1, 0x01, 0xFE, 0x57, 0x75};
+
+constexpr DWORD kPpsEscape = 0x42000C01;
+constexpr DWORD kIfsEscape = 0x42000C02;
+
+// Ридер с картой и дескриптор, подключённый с T0|T1, как у CardReader
+struct Connection {
+    PcscSimulator sim;
+    Bytes atr;
+    SCARDCONTEXT context = 0;
+    SCARDHANDLE handle = 0;
+    DWORD protocol = 0;
+
+    Connection(const Bytes &cardAtr, DWORD protocols)
+        : atr(cardAtr)
+    {
+        PcscSimulator::Card card;
+        card.atr = atr;
+        card.protocols = protocols;
+        sim.addReader(kReader);
+        sim.insertCard(kReader, card);
+        sim.establishContext(SCARD_SCOPE_SYSTEM, &context);
+        CHECK(sim.connect(context, kReader, SCARD_SHARE_SHARED, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1,
+                          &handle, &protocol) == SCARD_S_SUCCESS);
+    }
+
+    LinkReport negotiate(const LinkOptions &options = LinkOptions())
+    {
+        return negotiateLink(sim, handle, protocol, atr, options);
+    }
+};
+
+void reconnectOnProtocolMismatch()
+{
+    // Драйвер выбрал первый протокол карты (T=0), по ATR нужен T=1
+    Connection c(kNegotiableAtr, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1);
+    CHECK(c.protocol == SCARD_PROTOCOL_T0);
+    const LinkReport r = c.negotiate();
+    CHECK(r.attempted);
+    CHECK(r.requested.pps.needed && r.requested.protocol == 1);
+    CHECK(c.sim.calls(Operation::Reconnect) == 1);
+    CHECK(c.sim.calls(Operation::Control) == 0);
+    CHECK(r.ppsSent && r.ppsAccepted);
+    CHECK(c.protocol == SCARD_PROTOCOL_T1 && r.protocol == SCARD_PROTOCOL_T1);
+    // Fi/Di после сброса выбирает драйвер; без атрибутов остаётся Fd/Dd
+    CHECK(!r.measured && r.fi == 372 && r.di == 1);
+    // IFSD: escape не задан, атрибута нет
+    CHECK(r.ifsdSent && !r.ifsdAccepted && r.ifsd == 32);
+
+    // С атрибутами ридера итог читается из них
+    Connection m(kNegotiableAtr, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1);
+    m.sim.setAttribute(kReader, pcsc::kAttrCurrentF, 372);
+    m.sim.setAttribute(kReader, pcsc::kAttrCurrentD, 4);
+    const LinkReport measured = m.negotiate();
+    CHECK(measured.ppsAccepted && measured.measured && measured.fi == 372 && measured.di == 4);
+}
+
+void reconnectRejected()
+{
+    // Карта T=1 не принимает: сброс с единственным T=1 не проходит,
+    // дескриптор остаётся на T=0
+    Connection c(kNegotiableAtr, SCARD_PROTOCOL_T0);
+    const LinkReport r = c.negotiate();
+    CHECK(c.sim.calls(Operation::Reconnect) == 1);
+    CHECK(r.ppsSent && !r.ppsAccepted);
+    CHECK(c.protocol == SCARD_PROTOCOL_T0 && r.protocol == SCARD_PROTOCOL_T0);
+    CHECK(!r.ifsdSent && r.ifsd == 0);
+    CHECK(r.fi == 372 && r.di == 1);
+}
+
+void ppsByEscape()
+{
+    // Протокол уже T=1, Fi/Di меняются PPS через escape ридера
+    Connection c(kNegotiableAtr, SCARD_PROTOCOL_T1);
+    CHECK(c.protocol == SCARD_PROTOCOL_T1);
+    c.sim.setControlResponse(kReader, kPpsEscape, kPps, kPps);
+    LinkOptions options;
+    options.ppsControlCode = kPpsEscape;
+    const LinkReport r = c.negotiate(options);
+    CHECK(c.sim.calls(Operation::Reconnect) == 0);
+    CHECK(r.ppsSent && r.ppsAccepted);
+    CHECK(!r.measured && r.fi == 372 && r.di == 4);
+    CHECK(r.baud == r.clockHz * 4 / 372);
+
+    // Ридер escape не знает: PPS не принят, скорость Fd/Dd
+    Connection u(kNegotiableAtr, SCARD_PROTOCOL_T1);
+    const LinkReport unsupported = u.negotiate(options);
+    CHECK(u.sim.calls(Operation::Control) == 1);
+    CHECK(unsupported.ppsSent && !unsupported.ppsAccepted);
+    CHECK(unsupported.fi == 372 && unsupported.di == 1);
+
+    // Карта отвечает не эхом: отказ
+    Connection n(kNegotiableAtr, SCARD_PROTOCOL_T1);
+    n.sim.setControlResponse(kReader, kPpsEscape, kPps, {0xFF, 0x01, 0xFE});
+    const LinkReport refused = n.negotiate(options);
+    CHECK(refused.ppsSent && !refused.ppsAccepted && refused.di == 1);
+}
+
+void ifsdByEscape()
+{
+    LinkOptions options;
+    options.ifsControlCode = kIfsEscape;
+
+    // Карта подтверждает IFSD; атрибут не трогается
+    Connection c(kT1Atr, SCARD_PROTOCOL_T1);
+    c.sim.setControlResponse(kReader, kIfsEscape, kIfsRequest, kIfsResponse);
+    c.sim.setAttribute(kReader, pcsc::kAttrCurrentIfsd, 32);
+    const LinkReport r = c.negotiate(options);
+    CHECK(r.ifsdSent && r.ifsdAccepted);
+    CHECK(c.sim.calls(Operation::SetAttrib) == 0);
+    // Драйвер о S(IFS) через escape не знает: атрибут прежний
+    CHECK(r.ifsd == 32);
+
+    // Escape выполнен, карта ответила не S(IFS response): на атрибут не переходим
+    Connection n(kT1Atr, SCARD_PROTOCOL_T1);
+    n.sim.setControlResponse(kReader, kIfsEscape, kIfsRequest, {0x00, 0xE1, 0x01, 0x20, 0xC0});
+    n.sim.setAttribute(kReader, pcsc::kAttrCurrentIfsd, 32);
+    const LinkReport refused = n.negotiate(options);
+    CHECK(refused.ifsdSent && !refused.ifsdAccepted);
+    CHECK(n.sim.calls(Operation::SetAttrib) == 0);
+
+    // TC3 = CRC: блок с CRC-16; тот же блок с LRC ридер бы не узнал
+    Connection crc(kT1CrcAtr, SCARD_PROTOCOL_T1);
+    crc.sim.setControlResponse(kReader, kIfsEscape, kIfsCrcRequest, kIfsCrcResponse);
+    const LinkReport crcReport = crc.negotiate(options);
+    CHECK(crcReport.requested.edcCrc);
+    CHECK(crc.sim.calls(Operation::Control) == 1);
+    CHECK(crcReport.ifsdSent && crcReport.ifsdAccepted);
+
+    // Ответ с LRC при TC3 = CRC — не S(IFS response)
+    Connection lrc(kT1CrcAtr, SCARD_PROTOCOL_T1);
+    lrc.sim.setControlResponse(kReader, kIfsEscape, kIfsCrcRequest, {0x00, 0xE1, 0x01, 0xFE, 0x1E, 0x00});
+    const LinkReport lrcReport = lrc.negotiate(options);
+    CHECK(lrcReport.ifsdSent && !lrcReport.ifsdAccepted);
+}
+
+void ifsdAttributeFallback()
+{
+    LinkOptions options;
+    options.ifsControlCode = kIfsEscape;
+
+    // Ридер escape не знает: IFSD задаётся атрибутом CURRENT_IFSD
+    Connection c(kT1Atr, SCARD_PROTOCOL_T1);
+    c.sim.setAttribute(kReader, pcsc::kAttrCurrentIfsd, 32);
+    const LinkReport r = c.negotiate(options);
+    CHECK(c.sim.calls(Operation::Control) == 1);
+    CHECK(c.sim.calls(Operation::SetAttrib) == 1);
+    CHECK(r.ifsdSent && r.ifsdAccepted);
+    CHECK(r.ifsd == 254);
+
+    // Предел ридера MAX_IFSD ограничивает запрос
+    Connection l(kT1Atr, SCARD_PROTOCOL_T1);
+    l.sim.setAttribute(kReader, pcsc::kAttrCurrentIfsd, 32);
+    l.sim.setAttribute(kReader, pcsc::kAttrMaxIfsd, 128);
+    const LinkReport limited = l.negotiate(options);
+    CHECK(limited.ifsdAccepted && limited.ifsd == 128);
+
+    // Ни escape, ни атрибута: IFSD по умолчанию
+    Connection d(kT1Atr, SCARD_PROTOCOL_T1);
+    const LinkReport none = d.negotiate(options);
+    CHECK(none.ifsdSent && !none.ifsdAccepted && none.ifsd == 32);
+}
+
+void noPpsNeeded()
+{
+    LinkOptions options;
+    options.ppsControlCode = kPpsEscape;
+
+    // T=1 без TA1: канал уже на Fd/Dd с первым протоколом
+    Connection c(kT1Atr, SCARD_PROTOCOL_T1);
+    const LinkReport r = c.negotiate(options);
+    CHECK(r.attempted && !r.requested.pps.needed);
+    CHECK(!r.ppsSent && !r.ppsAccepted);
+    CHECK(c.sim.calls(Operation::Reconnect) == 0);
+    CHECK(c.protocol == SCARD_PROTOCOL_T1);
+    CHECK(r.fi == 372 && r.di == 1 && r.baud == r.clockHz / 372);
+
+    // T=0: ни PPS, ни IFSD
+    Connection t0(kT0Atr, SCARD_PROTOCOL_T0);
+    const LinkReport r0 = t0.negotiate(options);
+    CHECK(r0.attempted && !r0.ppsSent && !r0.ifsdSent);
+    CHECK(t0.sim.calls(Operation::Reconnect) == 0 && t0.sim.calls(Operation::Control) == 0);
+    CHECK(r0.protocol == SCARD_PROTOCOL_T0 && r0.ifsd == 0);
+
+    // Неразбираемый ATR: дескриптор не трогается
+    Connection bad({0x3B, 0xF0, 0x11}, SCARD_PROTOCOL_T1);
+    const LinkReport rb = bad.negotiate(options);
+    CHECK(!rb.attempted);
+    CHECK(bad.sim.calls(Operation::GetAttrib) == 0 && bad.sim.calls(Operation::Control) == 0);
+}
+
+void waitingTimeFromCardFi()
+{
+    // Канал остаётся на Fd = 372, WT считается по Fi = 512 из TA1:
+    // 10 * 960 * 512 тактов на 3.75 МГц
+    Connection c(kWaitingTimeAtr, SCARD_PROTOCOL_T0);
+    const LinkReport r = c.negotiate();
+    CHECK(!r.requested.pps.needed && r.requested.fi == 372);
+    CHECK(r.requested.clockHz == 3750000);
+    CHECK(r.requested.waitingTimeUs == 1310720);
+}
+
+} // namespace
+
+int main()
+{
+    reconnectOnProtocolMismatch();
+    reconnectRejected();
+    ppsByEscape();
+    ifsdByEscape();
+    ifsdAttributeFallback();
+    noPpsNeeded();
+    waitingTimeFromCardFi();
+    return tests::exitCode();
+}
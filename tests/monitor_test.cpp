@@ -0,0 +1,262 @@
+// Мониторинг карт: CardReader на PcscSimulator. Проверяется
+// последовательность сигналов readersListChanged / cardInserted /
+// cardRemoved при вставке, замене карты без события извлечения,
+// извлечении, подключении ридера и отключении ридера с картой — в
+// событийном режиме (CardMonitor) и при опросе SCardStatus воркерами,
+// а также после переустановки контекста монитором из-за ошибки PC/SC.
+
+#include "../cardreader.h"
+#include "../pcscsimulator.h"
+#include "check.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include <cstdio>
+
+namespace {
+
+using Bytes = PcscSimulator::Bytes;
+using Operation = PcscSimulator::Operation;
+
+const char kFirst[] = "Sim Reader 0";
+const char kSecond[] = "Sim Reader 1";
+const char kThird[] = "Sim Reader 2";
+
+// Время ожидания очередного сигнала и тишины после последнего шага
+const int kTimeoutMs = 5000;
+const int kSettleMs = 300;
+const int kPollMs = 20;
+
+PcscSimulator::Card mifare()
+{
+    return PcscSimulator::Card::contactless(
+        {0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0, 0x00, 0x00, 0x03, 0x06, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x6A},
+        {});
+}
+
+PcscSimulator::Card desfire()
+{
+    return PcscSimulator::Card::contactless({0x3B, 0x81, 0x80, 0x01, 0x80, 0x80}, {0x06, 0x75, 0x77, 0x81, 0x02, 0x80});
+}
+
+PcscSimulator::Card emv()
+{
+    PcscSimulator::Card card;
+    card.atr = {0x3B, 0x68, 0x00, 0x00, 0x80, 0x66, 0xB0, 0x07, 0x01, 0x01, 0x07, 0x07};
+    card.protocols = SCARD_PROTOCOL_T0;
+    return card;
+}
+
+QString hex(const Bytes &atr)
+{
+    return QString::fromLatin1(QByteArray(reinterpret_cast<const char *>(atr.data()), static_cast<int>(atr.size())).toHex());
+}
+
+QString inserted(const PcscSimulator::Card &card)
+{
+    return "inserted " + hex(card.atr);
+}
+
+// Сигналы CardReader строками в порядке прихода; соединения рвутся
+// вместе с журналом (m_context)
+class SignalLog
+{
+public:
+    explicit SignalLog(CardReader &reader)
+    {
+        QObject::connect(&reader, &CardReader::cardInserted, &m_context, [this](const ATRData &info) {
+            add("inserted " + hex(Bytes(info.rawAtr, info.rawAtr + info.atrLength)));
+        });
+        QObject::connect(&reader, &CardReader::cardRemoved, &m_context, [this]() { add("removed"); });
+        QObject::connect(&reader, &CardReader::readersListChanged, &m_context, [this](const QStringList &readers) {
+            add("readers " + readers.join(','));
+        });
+        QObject::connect(&reader, &CardReader::readerError, &m_context, [](const QString &error) {
+            std::fprintf(stderr, "  readerError: %s\n", qPrintable(error));
+        });
+    }
+
+    // Ждёт, пока не придут ещё expected.size() сигналов, и сверяет их
+    void expect(const QStringList &expected)
+    {
+        const int count = m_seen + expected.size();
+        wait(count, kTimeoutMs);
+        const QStringList got = m_events.mid(m_seen, expected.size());
+        m_seen += got.size();
+        if (!CHECK(got == expected)) {
+            std::fprintf(stderr, "  ожидалось: [%s]\n  получено:  [%s]\n",
+                         qPrintable(expected.join("; ")), qPrintable(got.join("; ")));
+        }
+    }
+
+    // Лишних сигналов после последнего шага нет
+    void expectQuiet()
+    {
+        wait(m_seen + 1, kSettleMs);
+        if (!CHECK(m_events.size() == m_seen)) {
+            std::fprintf(stderr, "  лишние сигналы: [%s]\n", qPrintable(m_events.mid(m_seen).join("; ")));
+        }
+        m_seen = m_events.size();
+    }
+
+private:
+    void add(const QString &event)
+    {
+        m_events.append(event);
+        if (m_loop && m_events.size() >= m_expected) m_loop->quit();
+    }
+
+    void wait(int count, int timeoutMs)
+    {
+        if (m_events.size() >= count) return;
+        QEventLoop loop;
+        QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+        m_loop = &loop;
+        m_expected = count;
+        loop.exec();
+        m_loop = nullptr;
+    }
+
+    QObject m_context;
+    QStringList m_events;
+    int m_seen = 0;
+    int m_expected = 0;
+    QEventLoop *m_loop = nullptr;
+};
+
+void eventMonitoring()
+{
+    PcscSimulator sim;
+    sim.addReader(kFirst);
+
+    CardReader reader;
+    reader.setTransport(&sim);
+    SignalLog log(reader);
+    CHECK(reader.initialize());
+    reader.startEventMonitoring();
+    log.expect({QString("readers ") + kFirst});
+
+    sim.insertCard(kFirst, mifare());
+    log.expect({inserted(mifare())});
+
+    // Замена без извлечения: счётчик событий ридера, а не EMPTY/PRESENT
+    sim.insertCard(kFirst, desfire());
+    log.expect({"removed", inserted(desfire())});
+
+    sim.removeCard(kFirst);
+    log.expect({"removed"});
+
+    sim.addReader(kSecond);
+    log.expect({QString("readers ") + kFirst + "," + kSecond});
+
+    sim.insertCard(kSecond, emv());
+    log.expect({inserted(emv())});
+
+    // Ридер отключён вместе с картой
+    sim.removeReader(kSecond);
+    log.expect({"removed", QString("readers ") + kFirst});
+
+    sim.insertCard(kFirst, emv());
+    log.expect({inserted(emv())});
+    reader.stopMonitoring();
+    log.expectQuiet();
+
+    // После перезапуска карта, оставшаяся в ридере, сообщается как вставка
+    sim.addReader(kSecond);
+    reader.startEventMonitoring();
+    log.expect({QString("readers ") + kFirst + "," + kSecond, inserted(emv())});
+    reader.stopMonitoring();
+    log.expectQuiet();
+}
+
+void pollMonitoring()
+{
+    PcscSimulator sim;
+    sim.addReader(kFirst);
+
+    CardReader reader;
+    reader.setTransport(&sim);
+    SignalLog log(reader);
+    CHECK(reader.initialize());
+    reader.listReaders();
+    log.expect({QString("readers ") + kFirst});
+    reader.startMonitoring(kPollMs);
+    // Воркер запоминает начальное состояние в своём потоке; карта,
+    // вставленная раньше, считалась бы уже лежавшей в ридере
+    log.expectQuiet();
+
+    sim.insertCard(kFirst, mifare());
+    log.expect({inserted(mifare())});
+
+    // Опрос видит замену по SCARD_W_REMOVED_CARD у старого дескриптора
+    sim.insertCard(kFirst, desfire());
+    log.expect({"removed", inserted(desfire())});
+
+    sim.removeCard(kFirst);
+    log.expect({"removed"});
+
+    // Повторная вставка после извлечения: воркер подключается заново
+    sim.insertCard(kFirst, emv());
+    log.expect({inserted(emv())});
+
+    // Ридер отключён с картой: опрос теряет дескриптор
+    sim.removeReader(kFirst);
+    log.expect({"removed"});
+    reader.stopMonitoring();
+    log.expectQuiet();
+}
+
+void contextLoss()
+{
+    PcscSimulator sim;
+    sim.addReader(kFirst);
+    sim.addReader(kSecond);
+
+    CardReader reader;
+    reader.setTransport(&sim);
+    SignalLog log(reader);
+    CHECK(reader.initialize());
+    reader.startEventMonitoring();
+    log.expect({QString("readers ") + kFirst + "," + kSecond});
+    sim.insertCard(kFirst, mifare());
+    log.expect({inserted(mifare())});
+    sim.insertCard(kSecond, emv());
+    log.expect({inserted(emv())});
+
+    // Подключение ридера будит монитор, следующее ожидание обрывается
+    // ошибкой; новый контекст не устанавливается, пока сбой не снят
+    sim.failNext(Operation::GetStatusChange, SCARD_F_COMM_ERROR);
+    sim.failNext(Operation::EstablishContext, SCARD_E_NO_SERVICE, 1000);
+    const uint64_t established = sim.calls(Operation::EstablishContext);
+    sim.addReader(kThird);
+    log.expect({QString("readers ") + kFirst + "," + kSecond + "," + kThird});
+    for (int waited = 0; sim.calls(Operation::EstablishContext) == established && waited < kTimeoutMs; waited += 10) {
+        QThread::msleep(10);
+    }
+    CHECK(sim.calls(Operation::EstablishContext) > established);
+
+    // Замена карты во время сбоя видна по счётчику событий сохранённого
+    // состояния; карта во втором ридере не сообщается повторно, список
+    // ридеров не изменился
+    sim.insertCard(kFirst, desfire());
+    sim.failNext(Operation::EstablishContext, SCARD_S_SUCCESS, 0);
+    log.expect({"removed", inserted(desfire())});
+    log.expectQuiet();
+    reader.stopMonitoring();
+    log.expectQuiet();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    eventMonitoring();
+    pollMonitoring();
+    contextLoss();
+    return tests::exitCode();
+}